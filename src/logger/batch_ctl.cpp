@@ -0,0 +1,65 @@
+#include "batch_ctl.h"
+
+#include <algorithm>
+
+#define EWMA_WEIGHT         0.25
+#define BACKLOG_ON_PCT      25      // queue fill that switches to full-buffer batches
+#define BACKLOG_OFF_PCT     5
+
+static void plan(BatchCtl* ctl)
+{
+    const BatchConfig& cfg = ctl->cfg;
+    BatchPlan& p = ctl->plan;
+    if (!cfg.adaptive)
+    {
+        p.target_bytes = cfg.buffer_bytes;
+        p.flush_ms = cfg.fixed_flush_ms;
+        p.stop_when_idle = true;
+        return;
+    }
+
+    p.stop_when_idle = false;
+    if (ctl->backlog)
+    {
+        // Lines are already waiting, so collecting costs nothing; only the write count matters
+        p.target_bytes = cfg.buffer_bytes;
+        p.flush_ms = cfg.max_latency_ms;
+        return;
+    }
+
+    // Leave room for the write itself (twice the typical write time) within the latency budget
+    double budget = cfg.max_latency_ms - 2 * ctl->write_ms;
+    p.flush_ms = (uint32_t)std::max<double>(cfg.min_flush_ms, budget);
+
+    size_t unit = std::max<size_t>(1, std::min(cfg.unit_bytes, cfg.buffer_bytes));
+    size_t want = (size_t)(ctl->in_bytes_per_s * p.flush_ms / 1000.0);
+    size_t target = (want + unit - 1) / unit * unit;
+    p.target_bytes = std::min(std::max(target, unit), cfg.buffer_bytes);
+}
+
+void batch_ctl_init(BatchCtl* ctl, const BatchConfig* cfg)
+{
+    *ctl = BatchCtl{};
+    ctl->cfg = *cfg;
+    plan(ctl);
+}
+
+void batch_ctl_update(BatchCtl* ctl, const BatchSample* s)
+{
+    if (s->cycle_us > 0)
+    {
+        double rate = s->bytes * 1000000.0 / s->cycle_us;
+        ctl->in_bytes_per_s = ctl->batches ? ctl->in_bytes_per_s + EWMA_WEIGHT * (rate - ctl->in_bytes_per_s) : rate;
+    }
+    double w = s->write_us / 1000.0;
+    ctl->write_ms = ctl->batches ? ctl->write_ms + EWMA_WEIGHT * (w - ctl->write_ms) : w;
+    ctl->batches++;
+
+    if (s->queue_len)
+    {
+        unsigned pct = s->queue_used * 100 / s->queue_len;
+        if (pct >= BACKLOG_ON_PCT) ctl->backlog = true;
+        else if (pct <= BACKLOG_OFF_PCT) ctl->backlog = false;
+    }
+    plan(ctl);
+}
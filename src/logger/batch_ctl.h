@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Batch size and flush interval of the SD writer, adapted from what the writer observes.
+//
+// The writer collects lines until the plan's target size or its flush deadline, whichever comes
+// first. The deadline keeps a frame from waiting longer than max_latency_ms (minus the expected write
+// time) at low load, where a full batch would take seconds; the target is the input rate times the
+// deadline, rounded up to the card's write unit, so batches grow with the load up to the buffer.
+// Once a backlog builds up in the queue, every batch is as large as the buffer, since per-write
+// overhead is what limits the card then.
+typedef struct
+{
+    size_t buffer_bytes;        // batch buffer size, upper bound of a batch
+    size_t unit_bytes;          // card write unit (cluster); targets are multiples of it
+    uint32_t max_latency_ms;    // queue-to-card latency to stay within at low load
+    uint32_t min_flush_ms;      // never flush more often than this at low load
+    bool adaptive;              // false: fixed plan, flush when the queue runs empty (old behavior)
+    uint32_t fixed_flush_ms;    // fixed plan: max collection time
+} BatchConfig;
+
+typedef struct
+{
+    size_t target_bytes;        // write once this much is collected
+    uint32_t flush_ms;          // or this long after the first line of the batch
+    bool stop_when_idle;        // write as soon as the queue is empty
+} BatchPlan;
+
+// What the writer saw for the batch it just wrote
+typedef struct
+{
+    size_t bytes;
+    uint32_t cycle_us;          // first line of this batch until the first line of the next could be taken
+    uint32_t write_us;          // time in storage_write
+    unsigned queue_used;        // sdQueue fill after the write, in bytes
+    unsigned queue_len;         // sdQueue size in bytes
+} BatchSample;
+
+typedef struct
+{
+    BatchConfig cfg;
+    BatchPlan plan;
+    double in_bytes_per_s;      // EWMA of the input rate
+    double write_ms;            // EWMA of the write time
+    bool backlog;
+    unsigned long batches;
+} BatchCtl;
+
+void batch_ctl_init(BatchCtl* ctl, const BatchConfig* cfg);
+void batch_ctl_update(BatchCtl* ctl, const BatchSample* sample);
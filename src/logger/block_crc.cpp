@@ -0,0 +1,213 @@
+#include "block_crc.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "mem_budget.h"
+#include "record_ring.h"
+#include "storage.h"
+
+static const char* TAG = "BLOCK_CRC";
+
+#define WRITE_CHUNK     32          // records per fwrite, on the supervisor stack
+#define FINALIZE_CHUNK  4096        // read buffer of block_crc_finalize, from the heap
+
+static_assert(sizeof(BlockCrcRecord) == 12, "BlockCrcRecord must stay 12 bytes");
+
+// -----------------------------
+// State (SD_Writer, except the file)
+// -----------------------------
+static bool g_active = false;           // companion file open; set before SD_Writer starts
+static uint32_t g_block_crc = 0;
+static uint32_t g_block_used = 0;
+static uint32_t g_file_crc = 0;
+static RecordRing g_ring;
+static uint8_t* g_ring_buf = nullptr;
+static unsigned long g_dropped = 0;     // records that found the ring full
+
+static FILE* g_file = nullptr;          // supervisor
+
+// -----------------------------
+// Helpers
+// -----------------------------
+// Header checked; record count, torn trailing bytes ignored
+static bool read_header(FILE* f, uint32_t* records)
+{
+    BlockCrcHeader h;
+    if (fseek(f, 0, SEEK_SET) != 0 || fread(&h, sizeof(h), 1, f) != 1) return false;
+    if (memcmp(h.magic, BLOCK_CRC_MAGIC, sizeof(h.magic)) != 0 || h.version != BLOCK_CRC_VERSION ||
+        h.block_bytes != BLOCK_CRC_BYTES)
+    {
+        return false;
+    }
+    uint64_t size;
+    if (!storage_file_size(f, &size)) return false;
+    *records = size > sizeof(h) ? (uint32_t)((size - sizeof(h)) / sizeof(BlockCrcRecord)) : 0;
+    return true;
+}
+
+static bool read_record(FILE* f, uint32_t index, BlockCrcRecord* rec)
+{
+    return storage_seek(f, sizeof(BlockCrcHeader) + (uint64_t)index * sizeof(BlockCrcRecord)) &&
+           fread(rec, sizeof(*rec), 1, f) == 1;
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool block_crc_open(const char* path)
+{
+    if (!g_ring_buf)
+    {
+        g_ring_buf = (uint8_t*)mem_budget_alloc("block crc: record ring", BLOCK_CRC_RING_BYTES, MEM_PREFER_PSRAM);
+        if (!g_ring_buf || !record_ring_init(&g_ring, g_ring_buf, BLOCK_CRC_RING_BYTES))
+        {
+            g_ring_buf = nullptr;
+            return false;
+        }
+    }
+    g_active = false;
+    if (g_file) fclose(g_file);
+    g_file = fopen(path, "wb");
+    if (!g_file)
+    {
+        ESP_LOGW(TAG, "fopen failed: %s", path);
+        return false;
+    }
+    BlockCrcHeader h;
+    memcpy(h.magic, BLOCK_CRC_MAGIC, sizeof(h.magic));
+    h.version = BLOCK_CRC_VERSION;
+    h.block_bytes = BLOCK_CRC_BYTES;
+    fwrite(&h, sizeof(h), 1, g_file);
+    // FATFS stores the file size on the card only on sync: without it the file is empty after power-off
+    storage_sync(g_file);
+    g_block_crc = g_block_used = g_file_crc = 0;
+    g_active = true;
+    return true;
+}
+
+void block_crc_update(const void* data, size_t len)
+{
+    if (!g_active) return;
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0)
+    {
+        uint32_t n = BLOCK_CRC_BYTES - g_block_used;
+        if (n > len) n = (uint32_t)len;
+        g_block_crc = esp_rom_crc32_le(g_block_crc, p, n);
+        g_file_crc = esp_rom_crc32_le(g_file_crc, p, n);
+        g_block_used += n;
+        p += n;
+        len -= n;
+        if (g_block_used == BLOCK_CRC_BYTES)
+        {
+            BlockCrcRecord rec = {BLOCK_CRC_BYTES, g_block_crc, g_file_crc};
+            if (!record_ring_push(&g_ring, &rec, sizeof(rec), nullptr)) g_dropped++;
+            g_block_crc = 0;
+            g_block_used = 0;
+        }
+    }
+}
+
+void block_crc_write()
+{
+    if (!g_file) return;
+    BlockCrcRecord recs[WRITE_CHUNK];
+    size_t n;
+    bool wrote = false;
+    while ((n = record_ring_take(&g_ring, (uint8_t*)recs, sizeof(recs), nullptr)) > 0)
+    {
+        fwrite(recs, 1, n, g_file);
+        wrote = true;
+    }
+    if (wrote) storage_sync(g_file);
+    static unsigned long reported = 0;
+    if (g_dropped != reported)
+    {
+        // A gap would shift every later block; the file stays as it is and clients fall back to sizes
+        ESP_LOGW(TAG, "%lu block records dropped (ring full), companion file is out of step", g_dropped);
+        reported = g_dropped;
+    }
+}
+
+bool block_crc_finalize(const char* log_path, const char* crc_path)
+{
+    FILE* crc = fopen(crc_path, "r+b");
+    if (!crc) return false;
+    uint32_t records;
+    BlockCrcRecord last = {0, 0, 0};
+    if (!read_header(crc, &records) || (records > 0 && !read_record(crc, records - 1, &last)) ||
+        (records > 0 && last.bytes != BLOCK_CRC_BYTES))
+    {
+        fclose(crc);
+        return false;   // not ours, or finalized already
+    }
+    FILE* log = fopen(log_path, "rb");
+    uint64_t log_size = 0;
+    const bool sized = log && storage_file_size(log, &log_size);
+    const uint64_t hashed = (uint64_t)records * BLOCK_CRC_BYTES;
+    std::unique_ptr<uint8_t[]> buf(new(std::nothrow) uint8_t[FINALIZE_CHUNK]);
+    if (!sized || log_size <= hashed || log_size - hashed > BLOCK_CRC_FINALIZE_MAX || !buf ||
+        !storage_seek(log, hashed))
+    {
+        if (sized && log_size > hashed && log_size - hashed > BLOCK_CRC_FINALIZE_MAX)
+        {
+            ESP_LOGW(TAG, "%s: %llu bytes not hashed, left open", log_path,
+                     (unsigned long long)(log_size - hashed));
+        }
+        if (log) fclose(log);
+        fclose(crc);
+        return false;
+    }
+
+    // Overwrites torn bytes of a record cut short by the power loss
+    storage_seek(crc, sizeof(BlockCrcHeader) + (uint64_t)records * sizeof(BlockCrcRecord));
+    uint32_t file_crc = last.file_crc;
+    uint64_t left = log_size - hashed;
+    bool ok = true;
+    while (left > 0 && ok)
+    {
+        BlockCrcRecord rec = {0, 0, 0};
+        while (rec.bytes < BLOCK_CRC_BYTES && left > 0)
+        {
+            size_t want = BLOCK_CRC_BYTES - rec.bytes;
+            if (want > FINALIZE_CHUNK) want = FINALIZE_CHUNK;
+            if (want > left) want = (size_t)left;
+            size_t n = fread(buf.get(), 1, want, log);
+            if (n == 0)
+            {
+                ok = false;
+                break;
+            }
+            rec.crc = esp_rom_crc32_le(rec.crc, buf.get(), n);
+            file_crc = esp_rom_crc32_le(file_crc, buf.get(), n);
+            rec.bytes += n;
+            left -= n;
+        }
+        rec.file_crc = file_crc;
+        if (rec.bytes > 0 && fwrite(&rec, sizeof(rec), 1, crc) != 1) ok = false;
+    }
+    fclose(log);
+    fclose(crc);
+    ESP_LOGI(TAG, "%s: last %llu bytes hashed", log_path, (unsigned long long)(log_size - hashed));
+    return ok;
+}
+
+bool block_crc_summary(const char* crc_path, uint64_t* hashed, uint32_t* file_crc, uint32_t* blocks)
+{
+    FILE* f = fopen(crc_path, "rb");
+    if (!f) return false;
+    uint32_t records;
+    BlockCrcRecord last = {0, 0, 0};
+    bool ok = read_header(f, &records) && (records == 0 || read_record(f, records - 1, &last));
+    fclose(f);
+    if (!ok) return false;
+    *hashed = records ? (uint64_t)(records - 1) * BLOCK_CRC_BYTES + last.bytes : 0;
+    *file_crc = last.file_crc;
+    *blocks = records;
+    return true;
+}
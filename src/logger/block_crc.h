@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Running CRC32 of the log per BLOCK_CRC_BYTES block and from the start of the file, computed by
+// SD_Writer over the bytes it writes (ROM CRC routine) and kept in a companion file (CANxxxxx.CRC next
+// to CANxxxxx.LOG). /api/manifest publishes it, so an offload client can tell which files and which
+// blocks of the growing log it already has and fetch only the rest (test/src/canlog-sync.sh).
+//
+// Completed blocks wait in a small ring until the supervisor appends them to the file once per second.
+// There is no explicit close (power is simply cut), so the last, partial block of a log is hashed from
+// the card when the next log is opened (block_crc_finalize).
+#define BLOCK_CRC_BYTES         (64 * 1024)
+#define BLOCK_CRC_RING_BYTES    (4 * 1024)
+#define BLOCK_CRC_FINALIZE_MAX  (4 * BLOCK_CRC_BYTES)   // unhashed tail read back at most
+#define BLOCK_CRC_MAGIC         "CANBCRC"
+#define BLOCK_CRC_VERSION       1
+
+// File: header, then one record per block in file order; all little endian
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t block_bytes;
+} BlockCrcHeader;
+
+typedef struct
+{
+    uint32_t bytes;         // block_bytes, except for the last block of a finalized log
+    uint32_t crc;           // CRC32 (zlib) of the block
+    uint32_t file_crc;      // CRC32 of the log from its start through the end of this block
+} BlockCrcRecord;
+
+// Start the companion file of a new log (allocates the ring on first use, writes the header)
+bool block_crc_open(const char* path);
+
+// SD_Writer (and the log header before it starts): bytes that reached the log
+void block_crc_update(const void* data, size_t len);
+
+// Supervisor: append completed blocks to the file
+void block_crc_write();
+
+// Hash the tail of a previous log that its companion file does not cover yet (up to
+// BLOCK_CRC_FINALIZE_MAX), closing it with a short last block; false if there was nothing to do
+bool block_crc_finalize(const char* log_path, const char* crc_path);
+
+// Readers: bytes covered, the file CRC through them and the block count of a companion file
+bool block_crc_summary(const char* crc_path, uint64_t* hashed, uint32_t* file_crc, uint32_t* blocks);
@@ -0,0 +1,160 @@
+#include "bus_health.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "logging.h"
+
+// linux/can/error.h
+#define CAN_ERR_CRTL                0x00000004u
+#define CAN_ERR_BUSOFF              0x00000040u
+#define CAN_ERR_BUSERROR            0x00000080u
+#define CAN_ERR_RESTARTED           0x00000100u
+#define CAN_ERR_CNT                 0x00000200u
+#define CAN_ERR_CRTL_RX_OVERFLOW    0x01
+#define CAN_ERR_CRTL_RX_WARNING     0x04
+#define CAN_ERR_CRTL_TX_WARNING     0x08
+#define CAN_ERR_CRTL_RX_PASSIVE     0x10
+#define CAN_ERR_CRTL_TX_PASSIVE     0x20
+#define CAN_ERR_CRTL_ACTIVE         0x40
+
+// Error counter levels (ISO 11898-1)
+#define ERR_WARNING_LEVEL   96
+#define ERR_PASSIVE_LEVEL   128
+
+static const char* TAG = "BUS_HEALTH";
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static BusHealth g_health = {};
+
+// Previous sample (supervisor task only); all counters start at zero with logging
+static SourceStatus g_prev = {};
+static LoggingStats g_prev_stats = {};
+static int64_t g_prev_us = 0;
+
+// Losses of a "* LOSS" line that found sdQueue full, repeated in the next one
+typedef struct
+{
+    unsigned long overrun, missed, can_q, sd_q, wr;
+} LossCounts;
+static LossCounts g_unreported = {};
+
+static uint8_t counter_flags(uint32_t rec, uint32_t tec)
+{
+    uint8_t f = 0;
+    if (rec >= ERR_PASSIVE_LEVEL) f |= CAN_ERR_CRTL_RX_PASSIVE;
+    else if (rec >= ERR_WARNING_LEVEL) f |= CAN_ERR_CRTL_RX_WARNING;
+    if (tec >= ERR_PASSIVE_LEVEL) f |= CAN_ERR_CRTL_TX_PASSIVE;
+    else if (tec >= ERR_WARNING_LEVEL) f |= CAN_ERR_CRTL_TX_WARNING;
+    return f ? f : CAN_ERR_CRTL_ACTIVE;
+}
+
+static void error_frame(uint32_t err_class, uint8_t crtl, const SourceStatus& st)
+{
+    uint8_t data[8] = {};
+    data[1] = crtl;
+    data[6] = (uint8_t)(st.tec > 255 ? 255 : st.tec);
+    data[7] = (uint8_t)(st.rec > 255 ? 255 : st.rec);
+    logging_error_frame(err_class, data);
+}
+
+void bus_health_sample()
+{
+    int64_t now = esp_timer_get_time();
+    SourceStatus st = {};
+    bool ok = frame_source_status(&st);
+    LoggingStats ls;
+    get_logging_stats(&ls);
+
+    BusHealth h;
+    portENTER_CRITICAL(&g_lock);
+    h = g_health;
+    portEXIT_CRITICAL(&g_lock);
+
+    h.ctrl_ok = ok;
+    if (ok) h.ctrl = st;
+
+    unsigned long overrun = ok ? st.rx_overrun - g_prev.rx_overrun : 0;
+    unsigned long missed = ok ? st.rx_missed - g_prev.rx_missed : 0;
+    unsigned long can_q = ls.dropped_can - g_prev_stats.dropped_can;
+    unsigned long sd_q = ls.dropped_sd - g_prev_stats.dropped_sd;
+    unsigned long wr = ls.write_errors - g_prev_stats.write_errors;
+
+    if (ok)
+    {
+        if (overrun || missed) error_frame(CAN_ERR_CRTL, CAN_ERR_CRTL_RX_OVERFLOW, st);
+        if (st.bus_errors != g_prev.bus_errors) error_frame(CAN_ERR_BUSERROR, 0, st);
+        uint8_t level = counter_flags(st.rec, st.tec);
+        if (level != counter_flags(g_prev.rec, g_prev.tec))
+        {
+            error_frame(CAN_ERR_CRTL | CAN_ERR_CNT, level, st);
+        }
+        if (st.state == SOURCE_BUS_OFF && g_prev.state != SOURCE_BUS_OFF)
+        {
+            h.bus_off_events++;
+            error_frame(CAN_ERR_BUSOFF, 0, st);
+            ESP_LOGW(TAG, "bus off");
+        }
+        else if (st.state == SOURCE_RUNNING &&
+                 (g_prev.state == SOURCE_BUS_OFF || g_prev.state == SOURCE_RECOVERING))
+        {
+            error_frame(CAN_ERR_RESTARTED, 0, st);
+        }
+    }
+    LossCounts& u = g_unreported;
+    u.overrun += overrun;
+    u.missed += missed;
+    u.can_q += can_q;
+    u.sd_q += sd_q;
+    u.wr += wr;
+    if (u.overrun || u.missed || u.can_q || u.sd_q || u.wr)
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "* LOSS ovr %lu miss %lu canq %lu sdq %lu wr %lu", u.overrun, u.missed,
+                 u.can_q, u.sd_q, u.wr);
+        if (logging_note(text)) u = {};
+    }
+
+    h.lost_overrun += overrun;
+    h.lost_missed += missed;
+    h.lost_can_queue += can_q;
+    h.lost_sd_queue += sd_q;
+    h.write_errors += wr;
+
+    double dt = (now - g_prev_us) / 1000000.0;
+    if (g_prev_us && dt > 0)
+    {
+        uint32_t bits = ls.bus_bits - g_prev_stats.bus_bits;
+        h.bus_load_pct = ls.bitrate ? (float)(100.0 * bits / dt / ls.bitrate) : 0.0f;
+        h.frames_per_s = (float)((ls.frames - g_prev_stats.frames) / dt);
+    }
+
+    portENTER_CRITICAL(&g_lock);
+    g_health = h;
+    portEXIT_CRITICAL(&g_lock);
+
+    if (ok) g_prev = st;
+    g_prev_stats = ls;
+    g_prev_us = now;
+}
+
+void bus_health_get(BusHealth* out)
+{
+    portENTER_CRITICAL(&g_lock);
+    *out = g_health;
+    portEXIT_CRITICAL(&g_lock);
+}
+
+const char* source_state_name(SourceState state)
+{
+    switch (state)
+    {
+    case SOURCE_RUNNING: return "running";
+    case SOURCE_BUS_OFF: return "bus-off";
+    case SOURCE_RECOVERING: return "recovering";
+    default: return "stopped";
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+#include "frame_source.h"
+
+// Where frames get lost, sampled about once per second while logging: in the controller (RX FIFO
+// overrun), the driver RX queue, canQueue, sdQueue or at the SD card. Controller events are written
+// into the log as candump error frames (CAN_ERR_FLAG 0x20000000, classes as in linux/can/error.h):
+//
+//   CRTL (0x004)      data[1] RX_OVERFLOW on overrun/missed frames, WARNING/PASSIVE/ACTIVE on level changes
+//   BUSERROR (0x080)  new bus errors
+//   BUSOFF (0x040), RESTARTED (0x100)
+//   CNT (0x200)       with every CRTL level change: data[6] TEC, data[7] REC
+//
+// plus a "* LOSS ..." line with the number of frames lost at each stage since the last such line (a line
+// that finds sdQueue full is not a frame loss; its counts go into the next one).
+typedef struct
+{
+    SourceStatus ctrl;              // last controller sample
+    bool ctrl_ok;                   // false if the status could not be read
+    unsigned long lost_overrun;     // controller RX FIFO
+    unsigned long lost_missed;      // driver RX queue
+    unsigned long lost_can_queue;   // canQueue (CAN_RX -> CAN_Proc)
+    unsigned long lost_sd_queue;    // sdQueue (CAN_Proc -> SD_Writer)
+    unsigned long write_errors;     // short writes to the SD card
+    unsigned bus_off_events;
+    float bus_load_pct;             // over the last sample period, from the frames seen
+    float frames_per_s;
+} BusHealth;
+
+// Call about once per second from the logging supervisor
+void bus_health_sample();
+
+void bus_health_get(BusHealth* out);
+const char* source_state_name(SourceState state);
@@ -0,0 +1,104 @@
+#include "canas.h"
+
+#include <cstring>
+
+// -----------------------------
+// Data types
+// -----------------------------
+typedef struct
+{
+    const char* name;
+    uint8_t elem_bytes;     // 0: no payload
+    uint8_t count;
+    bool is_signed;
+    bool is_float;
+} CanasTypeInfo;
+
+static const CanasTypeInfo TYPES[CANAS_TYPES] = {
+    {"NODATA", 0, 0, false, false},
+    {"ERROR", 4, 1, true, false},
+    {"FLOAT", 4, 1, false, true},
+    {"LONG", 4, 1, true, false},
+    {"ULONG", 4, 1, false, false},
+    {"BLONG", 4, 1, false, false},
+    {"SHORT", 2, 1, true, false},
+    {"USHORT", 2, 1, false, false},
+    {"BSHORT", 2, 1, false, false},
+    {"CHAR", 1, 1, true, false},
+    {"UCHAR", 1, 1, false, false},
+    {"BCHAR", 1, 1, false, false},
+    {"SHORT2", 2, 2, true, false},
+    {"USHORT2", 2, 2, false, false},
+    {"BSHORT2", 2, 2, false, false},
+    {"CHAR4", 1, 4, true, false},
+    {"UCHAR4", 1, 4, false, false},
+    {"BCHAR4", 1, 4, false, false},
+    {"CHAR2", 1, 2, true, false},
+    {"UCHAR2", 1, 2, false, false},
+    {"BCHAR2", 1, 2, false, false},
+    {"MEMID", 4, 1, false, false},
+    {"CHKSUM", 4, 1, false, false},
+    {"ACHAR", 1, 1, false, false},
+    {"ACHAR2", 1, 2, false, false},
+    {"ACHAR4", 1, 4, false, false},
+    {"CHAR3", 1, 3, true, false},
+    {"UCHAR3", 1, 3, false, false},
+    {"BCHAR3", 1, 3, false, false},
+    {"ACHAR3", 1, 3, false, false},
+    {"DOUBLEH", 4, 1, false, false},
+    {"DOUBLEL", 4, 1, false, false},
+};
+
+// -----------------------------
+// Public API
+// -----------------------------
+unsigned canas_payload_size(uint8_t type)
+{
+    return type < CANAS_TYPES ? TYPES[type].elem_bytes * TYPES[type].count : 0;
+}
+
+bool canas_parse(uint32_t id, uint8_t dlc, const uint8_t* data, CanasHeader* out)
+{
+    if (id > CANAS_MAX_ID || dlc < CANAS_HEADER_BYTES || data[1] >= CANAS_TYPES) return false;
+    // Senders may pad to 8 bytes, so only a payload shorter than the type needs is rejected
+    if (dlc < CANAS_HEADER_BYTES + canas_payload_size(data[1])) return false;
+    out->node_id = data[0];
+    out->data_type = data[1];
+    out->service_code = data[2];
+    out->message_code = data[3];
+    return true;
+}
+
+unsigned canas_values(uint8_t type, const uint8_t* payload, double out[4])
+{
+    if (type >= CANAS_TYPES) return 0;
+    const CanasTypeInfo& t = TYPES[type];
+    for (unsigned i = 0; i < t.count; i++)
+    {
+        const uint8_t* p = payload + i * t.elem_bytes;
+        uint32_t raw = 0;
+        for (unsigned b = 0; b < t.elem_bytes; b++) raw = (raw << 8) | p[b];
+        if (t.is_float)
+        {
+            float f;
+            memcpy(&f, &raw, sizeof(f));
+            out[i] = f;
+        }
+        else if (t.is_signed)
+        {
+            // Sign-extend from the element width
+            unsigned shift = 32 - 8 * t.elem_bytes;
+            out[i] = (int32_t)(raw << shift) >> shift;
+        }
+        else
+        {
+            out[i] = raw;
+        }
+    }
+    return t.count;
+}
+
+const char* canas_type_name(uint8_t type)
+{
+    return type < CANAS_TYPES ? TYPES[type].name : "?";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+// CANaerospace (11-bit identifiers): every message starts with a 4 byte header, followed by up to
+// 4 bytes of big-endian payload whose layout is given by the data type:
+//
+//   byte 0 node ID, byte 1 data type, byte 2 service code, byte 3 message code (rolling counter)
+#define CANAS_HEADER_BYTES  4
+#define CANAS_MAX_ID        0x7FF
+
+// Standard identifier distribution
+#define CANAS_ID_UTC        1200    // hours, minutes, seconds
+#define CANAS_ID_DATE       1201    // day, month, year (uint16)
+
+typedef enum
+{
+    CANAS_NODATA = 0,
+    CANAS_ERROR,
+    CANAS_FLOAT,
+    CANAS_LONG,
+    CANAS_ULONG,
+    CANAS_BLONG,
+    CANAS_SHORT,
+    CANAS_USHORT,
+    CANAS_BSHORT,
+    CANAS_CHAR,
+    CANAS_UCHAR,
+    CANAS_BCHAR,
+    CANAS_SHORT2,
+    CANAS_USHORT2,
+    CANAS_BSHORT2,
+    CANAS_CHAR4,
+    CANAS_UCHAR4,
+    CANAS_BCHAR4,
+    CANAS_CHAR2,
+    CANAS_UCHAR2,
+    CANAS_BCHAR2,
+    CANAS_MEMID,
+    CANAS_CHKSUM,
+    CANAS_ACHAR,
+    CANAS_ACHAR2,
+    CANAS_ACHAR4,
+    CANAS_CHAR3,
+    CANAS_UCHAR3,
+    CANAS_BCHAR3,
+    CANAS_ACHAR3,
+    CANAS_DOUBLEH,      // high and low half of a double in two messages; decoded as raw uint32
+    CANAS_DOUBLEL,
+    CANAS_TYPES
+} CanasType;
+
+typedef struct
+{
+    uint8_t node_id;
+    uint8_t data_type;
+    uint8_t service_code;
+    uint8_t message_code;
+} CanasHeader;
+
+// Header of a frame that can be CANaerospace: 11-bit ID, known data type, payload present
+bool canas_parse(uint32_t id, uint8_t dlc, const uint8_t* data, CanasHeader* out);
+
+// Payload bytes of a data type (0 for unknown types)
+unsigned canas_payload_size(uint8_t type);
+
+// Engineering values of a payload (the bytes after the header); returns how many (0-4)
+unsigned canas_values(uint8_t type, const uint8_t* payload, double out[4]);
+
+const char* canas_type_name(uint8_t type);
@@ -0,0 +1,236 @@
+#include "clock_sync.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "canas.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "logging.h"
+
+// -----------------------------
+// Config
+// -----------------------------
+#define CLOCK_STEP_THRESHOLD_US   2000000   // larger errors are stepped, smaller ones slewed
+#define CLOCK_SLEW_PPM            500       // max slew rate; also bounds how far a slew can bend time
+#define CLOCK_RECORD_MIN_US       1000      // slews below this are applied without a log record
+#define CLOCK_PREFER_CAN_MS       (10 * 60 * 1000)  // WEB is ignored this long after a CAN reference
+
+// CANaerospace time messages (canas.h, 0 disables). The seconds field only has 1 s resolution, so a
+// reference is taken when it changes: the error is then bounded by the message period.
+#define CLOCK_CANAS_UTC_ID        CANAS_ID_UTC
+#define CLOCK_CANAS_DATE_ID       CANAS_ID_DATE
+
+static const char* TAG = "CLOCK";
+
+static const int64_t FICTIONAL_START_US = (int64_t)(FICTIONAL_START_TIME * 1000000.0 + 0.5);
+
+// -----------------------------
+// State
+// -----------------------------
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t g_offset_us = FICTIONAL_START_US;  // log time = esp_timer_get_time() + offset
+static int64_t g_slew_us = 0;                      // still to be added to the offset
+static int64_t g_slew_mark = 0;                    // boot time up to which the slew has been applied
+static int64_t g_last_error_us = 0;
+static int64_t g_last_sync_us = -1;                // boot time of the last accepted reference
+static int64_t g_last_can_us = -1;
+static ClockSource g_source = CLOCK_SRC_NONE;
+static unsigned g_steps = 0;
+static unsigned g_slews = 0;
+static bool g_capturing = false;                   // frames are being timestamped
+static clock_record_sink g_sink = nullptr;
+
+// CANaerospace decoder state (capture task only)
+static int32_t g_canas_days = -1;   // days since 1970 of the last UTC second seen
+static int g_canas_last_sod = -1;   // last UTC second of day seen
+static int32_t g_canas_date = -1;   // last date message, not yet applied to a UTC frame
+
+// -----------------------------
+// Helpers
+// -----------------------------
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int32_t days_from_civil(int y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+// Apply the part of the pending slew that is due by 'now'; called with the lock held
+static void apply_slew(int64_t now)
+{
+    if (g_slew_us == 0)
+    {
+        g_slew_mark = now;
+        return;
+    }
+    int64_t due = (now - g_slew_mark) * CLOCK_SLEW_PPM / 1000000;
+    if (due == 0) return;
+    int64_t step = llabs(g_slew_us) <= due ? g_slew_us : (g_slew_us > 0 ? due : -due);
+    g_offset_us += step;
+    g_slew_us -= step;
+    g_slew_mark = now;
+}
+
+static void emit(const char* kind, int64_t us, ClockSource source)
+{
+    if (!g_sink) return;
+    char text[40];
+    snprintf(text, sizeof(text), "* CLOCK %s %c%lld.%06lld %s", kind, us < 0 ? '-' : '+', llabs(us) / 1000000,
+             llabs(us) % 1000000, clock_source_name(source));
+    g_sink(text);
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+int64_t clock_sync_now_us()
+{
+    portENTER_CRITICAL(&g_lock);
+    int64_t now = esp_timer_get_time();
+    apply_slew(now);
+    int64_t t = now + g_offset_us;
+    portEXIT_CRITICAL(&g_lock);
+    return t;
+}
+
+bool clock_sync_reference(int64_t ref_us, int64_t at_us, ClockSource source)
+{
+    int64_t now = esp_timer_get_time();
+    if (source == CLOCK_SRC_WEB && g_last_can_us >= 0 && (now - g_last_can_us) / 1000 < CLOCK_PREFER_CAN_MS)
+    {
+        return false;
+    }
+
+    int64_t error = ref_us - at_us;
+    bool step;
+    portENTER_CRITICAL(&g_lock);
+    apply_slew(now);
+    step = g_last_sync_us < 0 || llabs(error) > CLOCK_STEP_THRESHOLD_US;
+    // Once frames are logged, a browser clock may not step the log back: any client on the SoftAP can
+    // post one, and repeated timestamps would break the time bisection of /export
+    if (step && error < 0 && source == CLOCK_SRC_WEB && g_capturing)
+    {
+        portEXIT_CRITICAL(&g_lock);
+        ESP_LOGW(TAG, "WEB reference %+lld us ignored while logging", (long long)error);
+        return false;
+    }
+    if (step)
+    {
+        g_offset_us += error;
+        g_slew_us = 0;
+        g_steps++;
+    }
+    else
+    {
+        // The measured error already contains what is still pending, so it replaces it
+        g_slew_us = error;
+        g_slews++;
+    }
+    g_last_error_us = error;
+    g_last_sync_us = now;
+    if (source == CLOCK_SRC_CAN) g_last_can_us = now;
+    g_source = source;
+    portEXIT_CRITICAL(&g_lock);
+
+    if (step)
+    {
+        ESP_LOGI(TAG, "step %+lld us (%s)", (long long)error, clock_source_name(source));
+        emit("STEP", error, source);
+    }
+    else if (llabs(error) >= CLOCK_RECORD_MIN_US)
+    {
+        emit("SLEW", error, source);
+    }
+    return true;
+}
+
+void clock_sync_on_frame(uint32_t id, uint8_t dlc, const uint8_t* data, int64_t ts_us)
+{
+    if (!g_capturing)
+    {
+        portENTER_CRITICAL(&g_lock);
+        g_capturing = true;
+        portEXIT_CRITICAL(&g_lock);
+    }
+    if ((id != CLOCK_CANAS_UTC_ID && id != CLOCK_CANAS_DATE_ID) || id == 0) return;
+    if (dlc < (id == CLOCK_CANAS_DATE_ID ? 8 : 7)) return;
+
+    const uint8_t* p = data + CANAS_HEADER_BYTES;
+    if (id == CLOCK_CANAS_DATE_ID)
+    {
+        unsigned day = p[0], month = p[1];
+        int year = (p[2] << 8) | p[3];
+        if (day >= 1 && day <= 31 && month >= 1 && month <= 12 && year >= 2000 && year < 2200)
+        {
+            g_canas_date = days_from_civil(year, month, day);
+        }
+        return;
+    }
+
+    unsigned h = p[0], m = p[1], s = p[2];
+    if (h > 23 || m > 59 || s > 60) return;
+    int sod = (int)(h * 3600 + m * 60 + s);
+    int prev = g_canas_last_sod;
+    g_canas_last_sod = sod;
+    // Midnight passed since the previous UTC frame
+    const bool rolled = prev >= 0 && sod < prev && prev - sod > 12 * 3600;
+    if (g_canas_date >= 0)
+    {
+        // A date message in between may name the new day already, or still the one that ended
+        g_canas_days = rolled && g_canas_date == g_canas_days ? g_canas_date + 1 : g_canas_date;
+        g_canas_date = -1;
+    }
+    else if (rolled && g_canas_days >= 0)
+    {
+        g_canas_days++;
+    }
+    if (prev < 0 || sod == prev || g_canas_days < 0) return;
+
+    int64_t ref_us = ((int64_t)g_canas_days * 86400 + sod) * 1000000;
+    clock_sync_reference(ref_us, ts_us, CLOCK_SRC_CAN);
+}
+
+void clock_sync_set_record_sink(clock_record_sink sink)
+{
+    g_sink = sink;
+}
+
+void clock_sync_base_record(char* out, unsigned out_size)
+{
+    ClockSyncStatus st;
+    clock_sync_get_status(&st);
+    int64_t us = st.base_offset_us;
+    snprintf(out, out_size, "* CLOCK BASE %c%lld.%06lld %s", us < 0 ? '-' : '+', llabs(us) / 1000000,
+             llabs(us) % 1000000, clock_source_name(st.source));
+}
+
+void clock_sync_get_status(ClockSyncStatus* out)
+{
+    portENTER_CRITICAL(&g_lock);
+    int64_t now = esp_timer_get_time();
+    apply_slew(now);
+    out->source = g_source;
+    out->base_offset_us = g_offset_us - FICTIONAL_START_US;
+    out->last_error_us = g_last_error_us;
+    out->slew_pending_us = g_slew_us;
+    out->since_sync_ms = g_last_sync_us < 0 ? -1 : (now - g_last_sync_us) / 1000;
+    out->steps = g_steps;
+    out->slews = g_slews;
+    portEXIT_CRITICAL(&g_lock);
+}
+
+const char* clock_source_name(ClockSource source)
+{
+    switch (source)
+    {
+    case CLOCK_SRC_WEB: return "WEB";
+    case CLOCK_SRC_CAN: return "CAN";
+    default: return "NONE";
+    }
+}
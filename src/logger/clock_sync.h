@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// Log clock: time since boot plus an offset that starts at FICTIONAL_START_TIME (no RTC) and is
+// disciplined at runtime from the browser's clock (/api/time) or a CANaerospace UTC/date message.
+// Large errors (and the first reference) step the clock, small ones are slewed out at a bounded rate
+// so timestamps stay monotonic. Only CAN may step the clock back while logging. Every correction is
+// reported as a '*' record line:
+//
+//   * CLOCK BASE +31536000.123456 WEB   at log start: log time minus the fictional base
+//   * CLOCK STEP +31536000.123456 WEB   timestamps after this line jumped by this amount
+//   * CLOCK SLEW -0.012345 CAN          error seen here, removed at <= CLOCK_SLEW_PPM
+typedef enum
+{
+    CLOCK_SRC_NONE = 0,
+    CLOCK_SRC_WEB,      // browser clock of a client connected to the SoftAP
+    CLOCK_SRC_CAN,      // CANaerospace UTC/date message on the bus; preferred over WEB
+} ClockSource;
+
+typedef struct
+{
+    ClockSource source;         // last accepted reference
+    int64_t base_offset_us;     // log time minus (time since boot + FICTIONAL_START_TIME)
+    int64_t last_error_us;      // error measured by the last accepted reference
+    int64_t slew_pending_us;    // part of that error not yet slewed out
+    int64_t since_sync_ms;      // -1 if never synced
+    unsigned steps;
+    unsigned slews;
+} ClockSyncStatus;
+
+// Current log time in microseconds (unix time once synced)
+int64_t clock_sync_now_us();
+
+// Reference: the true time was ref_us when the log clock read at_us. False if it was ignored: WEB
+// within CLOCK_PREFER_CAN_MS of a CAN reference, or a WEB step backwards once frames are being logged.
+bool clock_sync_reference(int64_t ref_us, int64_t at_us, ClockSource source);
+
+// Feed every captured frame; picks up the configured CANaerospace time messages
+void clock_sync_on_frame(uint32_t id, uint8_t dlc, const uint8_t* data, int64_t ts_us);
+
+// Where correction records go (the log writer); text without newline
+typedef void (*clock_record_sink)(const char* text);
+void clock_sync_set_record_sink(clock_record_sink sink);
+
+// "* CLOCK BASE ..." record describing the current state, for a new log file
+void clock_sync_base_record(char* out, unsigned out_size);
+
+void clock_sync_get_status(ClockSyncStatus* out);
+const char* clock_source_name(ClockSource source);
@@ -0,0 +1,227 @@
+#include "downsample.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "canas.h"
+#include "esp_log.h"
+#include "mem_budget.h"
+#include "record_ring.h"
+#include "storage.h"
+
+static const char* TAG = "DOWNSAMPLE";
+
+// Same layout as id_stats: 11-bit IDs indexed directly, 29-bit IDs in a small open-addressing table
+#define STD_ID_COUNT    0x800
+#define EXT_ID_SLOTS    512
+#define EXT_ID_EMPTY    0xFFFFFFFF
+#define WRITE_CHUNK     16          // records per fwrite, on the supervisor stack
+
+static_assert(sizeof(DownsampleRecord) == 32, "DownsampleRecord must stay 32 bytes");
+
+typedef struct
+{
+    uint32_t id;
+    uint32_t count;         // in the open bucket; 0: not touched yet
+    double sum;
+    float min;
+    float max;
+    float last;
+    bool canas;
+} Accum;
+
+// -----------------------------
+// State (CAN_Proc, except the file and the close request)
+// -----------------------------
+static Accum* g_acc = nullptr;
+static uint16_t* g_touched = nullptr;   // slots of the open bucket in order of their first frame
+static unsigned g_touched_count = 0;
+static bool g_open = false;
+static int64_t g_bucket = 0;            // index of the open bucket
+static RecordRing g_ring;
+static std::atomic<bool> g_close_request{false};
+static unsigned long g_dropped = 0;     // records that found the ring full
+static unsigned long g_ext_overflow = 0;
+
+static FILE* g_file = nullptr;          // supervisor
+
+// -----------------------------
+// Helpers
+// -----------------------------
+static int slot_of(uint32_t id)
+{
+    if (id < STD_ID_COUNT) return (int)id;
+    uint32_t h = (id * 2654435761u) >> 23;  // Fibonacci hash -> 9 bits
+    for (int probe = 0; probe < EXT_ID_SLOTS; probe++)
+    {
+        int slot = STD_ID_COUNT + (int)((h + probe) & (EXT_ID_SLOTS - 1));
+        if (g_acc[slot].id == id) return slot;
+        if (g_acc[slot].id == EXT_ID_EMPTY)
+        {
+            g_acc[slot].id = id;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+static float frame_value(uint32_t id, uint8_t dlc, const uint8_t* data, bool* canas)
+{
+    CanasHeader hdr;
+    double v[4];
+    *canas = canas_parse(id, dlc, data, &hdr) &&
+             canas_values(hdr.data_type, data + CANAS_HEADER_BYTES, v) > 0;
+    if (*canas) return (float)v[0];
+    uint32_t raw = 0;
+    for (unsigned i = 0; i < dlc && i < 4; i++) raw = (raw << 8) | data[i];
+    return (float)raw;
+}
+
+static void close_bucket()
+{
+    const int64_t start_us = g_bucket * DOWNSAMPLE_BUCKET_MS * 1000;
+    for (unsigned i = 0; i < g_touched_count; i++)
+    {
+        Accum& a = g_acc[g_touched[i]];
+        DownsampleRecord rec;
+        rec.start_us = start_us;
+        rec.id_flags = a.id | (a.canas ? DOWNSAMPLE_CANAS : 0);
+        rec.count = a.count;
+        rec.min = a.min;
+        rec.max = a.max;
+        rec.mean = (float)(a.sum / a.count);
+        rec.last = a.last;
+        if (!record_ring_push(&g_ring, &rec, sizeof(rec), nullptr)) g_dropped++;
+        a.count = 0;
+    }
+    g_touched_count = 0;
+    g_open = false;
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool downsample_init()
+{
+    if (g_acc) return true;
+    const size_t slots = STD_ID_COUNT + EXT_ID_SLOTS;
+    Accum* acc = (Accum*)mem_budget_alloc("downsample: accumulators", slots * sizeof(Accum), MEM_PSRAM_ONLY);
+    uint16_t* touched = (uint16_t*)mem_budget_alloc("downsample: bucket IDs", slots * sizeof(uint16_t),
+                                                    MEM_PSRAM_ONLY);
+    uint8_t* ring = (uint8_t*)mem_budget_alloc("downsample: record ring", DOWNSAMPLE_RING_BYTES, MEM_PSRAM_ONLY);
+    if (!acc || !touched || !ring || !record_ring_init(&g_ring, ring, DOWNSAMPLE_RING_BYTES))
+    {
+        ESP_LOGW(TAG, "no PSRAM; companion file disabled");
+        return false;
+    }
+    memset(acc, 0, slots * sizeof(Accum));
+    for (size_t i = STD_ID_COUNT; i < slots; i++) acc[i].id = EXT_ID_EMPTY;
+    g_touched = touched;
+    g_acc = acc;
+    return true;
+}
+
+bool downsample_open(const char* path)
+{
+    if (!g_acc) return false;
+    if (g_file) fclose(g_file);
+    g_file = fopen(path, "wb");
+    if (!g_file)
+    {
+        ESP_LOGW(TAG, "fopen failed: %s", path);
+        return false;
+    }
+    DownsampleHeader h;
+    memcpy(h.magic, DOWNSAMPLE_MAGIC, sizeof(h.magic));
+    h.version = DOWNSAMPLE_VERSION;
+    h.bucket_ms = DOWNSAMPLE_BUCKET_MS;
+    fwrite(&h, sizeof(h), 1, g_file);
+    // The file size reaches the card only on sync, and power is simply cut
+    storage_sync(g_file);
+    return true;
+}
+
+void downsample_update(uint32_t id, int64_t ts_us, uint8_t dlc, const uint8_t* data)
+{
+    if (!g_acc) return;
+    const int64_t bucket = ts_us / (DOWNSAMPLE_BUCKET_MS * 1000);    // log time is never negative
+    // Any other bucket closes the open one; backwards only after a clock step
+    if (g_open && bucket != g_bucket) close_bucket();
+    if (!g_open)
+    {
+        g_bucket = bucket;
+        g_open = true;
+    }
+
+    int slot = slot_of(id);
+    if (slot < 0)
+    {
+        g_ext_overflow++;
+        return;
+    }
+    bool canas;
+    float v = frame_value(id, dlc, data, &canas);
+    Accum& a = g_acc[slot];
+    if (a.count == 0)
+    {
+        a.id = id;
+        a.sum = 0;
+        a.min = a.max = v;
+        g_touched[g_touched_count++] = (uint16_t)slot;
+    }
+    a.count++;
+    a.sum += v;
+    if (v < a.min) a.min = v;
+    if (v > a.max) a.max = v;
+    a.last = v;
+    a.canas = canas;
+}
+
+uint32_t downsample_tick(int64_t now_us)
+{
+    if (g_close_request.load())
+    {
+        if (g_open) close_bucket();
+        g_close_request = false;
+    }
+    if (!g_open) return DOWNSAMPLE_IDLE;
+    const int64_t due_us = (g_bucket + 1) * DOWNSAMPLE_BUCKET_MS * 1000 + DOWNSAMPLE_GRACE_MS * 1000;
+    if (now_us >= due_us)
+    {
+        close_bucket();
+        return DOWNSAMPLE_IDLE;
+    }
+    return (uint32_t)((due_us - now_us + 999) / 1000);
+}
+
+void downsample_request_close()
+{
+    if (g_acc) g_close_request = true;
+}
+
+bool downsample_close_pending()
+{
+    return g_close_request.load();
+}
+
+void downsample_write()
+{
+    if (!g_file) return;
+    DownsampleRecord recs[WRITE_CHUNK];
+    size_t n;
+    bool wrote = false;
+    while ((n = record_ring_take(&g_ring, (uint8_t*)recs, sizeof(recs), nullptr)) > 0)
+    {
+        fwrite(recs, 1, n, g_file);
+        wrote = true;
+    }
+    if (wrote) storage_sync(g_file);
+    static unsigned long reported = 0;
+    if (g_dropped != reported)
+    {
+        ESP_LOGW(TAG, "%lu bucket records dropped (ring full), %lu frames of untracked extended IDs",
+                 g_dropped, g_ext_overflow);
+        reported = g_dropped;
+    }
+}
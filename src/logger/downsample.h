@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+
+// Downsampled companion file (CANxxxxx.AGG next to CANxxxxx.LOG): per ID and DOWNSAMPLE_BUCKET_MS
+// bucket of log time, the frame count and min/max/mean/last of one value per frame, so a long
+// recording can be plotted without reading the log (test/src/canlog_agg.cpp). The value is the first
+// engineering value of frames that decode as CANaerospace (canas.h), else the first up to 4 payload
+// bytes as a big-endian unsigned number.
+//
+// CAN_Proc accumulates every frame it formats and closes a bucket when a frame of a later one arrives,
+// or once the bucket is DOWNSAMPLE_GRACE_MS past its end (downsample_tick). Closed buckets wait in a
+// PSRAM ring until the supervisor appends them to the file once per second.
+#define DOWNSAMPLE_BUCKET_MS    1000
+#define DOWNSAMPLE_GRACE_MS     50          // frames still on their way from CAN_RX
+#define DOWNSAMPLE_RING_BYTES   (128 * 1024)
+#define DOWNSAMPLE_MAGIC        "CANAGGR"
+#define DOWNSAMPLE_VERSION      1
+#define DOWNSAMPLE_CANAS        0x80000000u // id_flags: value decoded as CANaerospace
+#define DOWNSAMPLE_IDLE         UINT32_MAX  // downsample_tick: no bucket open
+
+// File: header, then one record per ID and bucket in bucket order (IDs in order of their first frame
+// in the bucket); all little endian
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t bucket_ms;
+} DownsampleHeader;
+
+typedef struct
+{
+    int64_t start_us;       // log time of the bucket start
+    uint32_t id_flags;      // CAN ID | DOWNSAMPLE_CANAS
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float last;
+} DownsampleRecord;
+
+// Allocate the accumulators and the ring (PSRAM only); false disables the companion file
+bool downsample_init();
+
+// Start the companion file of a new log (writes the header)
+bool downsample_open(const char* path);
+
+// CAN_Proc, per frame
+void downsample_update(uint32_t id, int64_t ts_us, uint8_t dlc, const uint8_t* data);
+
+// CAN_Proc, after each burst and when woken for it: closes the open bucket if it is due (or a close
+// was requested); returns ms until it is due, DOWNSAMPLE_IDLE if no bucket is open
+uint32_t downsample_tick(int64_t now_us);
+
+// Any task: have the next downsample_tick close the open bucket early (end of a run)
+void downsample_request_close();
+bool downsample_close_pending();
+
+// Supervisor: append closed buckets to the file
+void downsample_write();
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+// Where captured frames come from: the TWAI controller on the target,
+// a candump replay or a synthetic generator on the host build.
+
+#define FRAME_SOURCE_WAIT_FOREVER 0xFFFFFFFFu
+
+typedef struct
+{
+    uint32_t id;
+    uint8_t dlc;
+    bool extended;
+    uint8_t data[8];
+} SourceFrame;
+
+// Bring up the source; false if it could not be started
+bool frame_source_start();
+
+// Wait up to timeout_ms for the next frame
+bool frame_source_receive(SourceFrame* frame, uint32_t timeout_ms);
+
+// Nominal bus bitrate, used for bus load estimates
+uint32_t frame_source_bitrate();
+
+typedef enum
+{
+    SOURCE_STOPPED = 0,
+    SOURCE_RUNNING,
+    SOURCE_BUS_OFF,
+    SOURCE_RECOVERING,
+} SourceState;
+
+// Controller and driver status; counters are cumulative since start
+typedef struct
+{
+    SourceState state;
+    uint32_t rx_pending;    // frames waiting in the driver RX queue
+    uint32_t rx_missed;     // lost because the driver RX queue was full
+    uint32_t rx_overrun;    // lost in the controller RX FIFO
+    uint32_t bus_errors;
+    uint32_t arb_lost;
+    uint32_t tec;           // transmit error counter
+    uint32_t rec;           // receive error counter
+} SourceStatus;
+
+bool frame_source_status(SourceStatus* out);
@@ -0,0 +1,85 @@
+#include "frame_source.h"
+
+#include <cstring>
+
+#include "esp_log.h"
+#include "driver/twai.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mem_budget.h"
+
+#define CAN_TX_PIN         GPIO_NUM_18
+#define CAN_RX_PIN         GPIO_NUM_17
+#define CAN_BITRATE        500000
+#define CAN_DRIVER_RX_QUEUE_LEN 128   // ~15 ms of back-to-back frames at 500 kbit/s (default is 5)
+
+static const char* TAG = "CAN";
+
+static bool init_can()
+{
+    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(CAN_TX_PIN, CAN_RX_PIN, TWAI_MODE_LISTEN_ONLY);
+    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();  // keep CAN_BITRATE in sync
+    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
+    g_config.rx_queue_len = CAN_DRIVER_RX_QUEUE_LEN;
+
+    if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "driver install failed");
+        return false;
+    }
+    if (twai_start() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "start failed");
+        return false;
+    }
+    mem_budget_note("twai: driver RX queue", CAN_DRIVER_RX_QUEUE_LEN * sizeof(twai_message_t), false);
+    ESP_LOGI(TAG, "Driver installed and started");
+    return true;
+}
+
+bool frame_source_start()
+{
+    if (init_can()) return true;
+    ESP_LOGE(TAG, "CAN init failed!");
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return init_can();
+}
+
+bool frame_source_receive(SourceFrame* frame, uint32_t timeout_ms)
+{
+    twai_message_t message;
+    TickType_t ticks = timeout_ms == FRAME_SOURCE_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    if (twai_receive(&message, ticks) != ESP_OK) return false;
+
+    frame->id = message.identifier;
+    frame->extended = message.extd;
+    frame->dlc = message.data_length_code > 8 ? 8 : message.data_length_code;
+    memcpy(frame->data, message.data, frame->dlc);
+    return true;
+}
+
+uint32_t frame_source_bitrate()
+{
+    return CAN_BITRATE;
+}
+
+bool frame_source_status(SourceStatus* out)
+{
+    twai_status_info_t info;
+    if (twai_get_status_info(&info) != ESP_OK) return false;
+    switch (info.state)
+    {
+    case TWAI_STATE_RUNNING: out->state = SOURCE_RUNNING; break;
+    case TWAI_STATE_BUS_OFF: out->state = SOURCE_BUS_OFF; break;
+    case TWAI_STATE_RECOVERING: out->state = SOURCE_RECOVERING; break;
+    default: out->state = SOURCE_STOPPED; break;
+    }
+    out->rx_pending = info.msgs_to_rx;
+    out->rx_missed = info.rx_missed_count;
+    out->rx_overrun = info.rx_overrun_count;
+    out->bus_errors = info.bus_error_count;
+    out->arb_lost = info.arb_lost_count;
+    out->tec = info.tx_error_counter;
+    out->rec = info.rx_error_counter;
+    return true;
+}
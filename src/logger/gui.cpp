@@ -1,4 +1,6 @@
+#include <atomic>
 #include <cstdio>
+#include <cstring>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 
@@ -15,6 +17,8 @@
 #include "esp_lcd_sh8601.h"
 #include "lvgl.h"
 #include "lv_conf.h"
+#include "mem_budget.h"
+#include "gui.h"
 
 static const char* TAG = "GUI";
 
@@ -23,12 +27,44 @@ static const char* TAG = "GUI";
 #define LCD_V_RES              456
 
 #define LVGL_BUF_HEIGHT        (LCD_V_RES / 4)
-#define LVGL_TICK_PERIOD_MS    2
+#define LVGL_IDLE_WAIT_MS      1000   // upper bound for sleeping when nothing is animated
+#define LVGL_MIN_WAIT_MS       (portTICK_PERIOD_MS > 5 ? portTICK_PERIOD_MS : 5)   // at least one tick
+#define LVGL_FLUSH_WAIT_MS     50     // for the last chunk of a frame to leave the panel DMA
+#define LABEL_TEXT_MAX         64
+#define DASHBOARD_Y            110
+#define DASHBOARD_ROW_PITCH    34
 
 static SemaphoreHandle_t lvgl_mux = nullptr;
 esp_lcd_panel_handle_t panel_handle = nullptr;
 TaskHandle_t lvglTaskHandle = nullptr;
 
+// === Update mailbox ===
+// Writers only copy into the pending slot and notify the LVGL task; they never wait for a render.
+// A newer value simply replaces a pending one that has not been drawn yet.
+// Text slots: label1, label2, then one per dashboard row; bit n of pending_mask = slot n
+#define SLOT_LABEL1            0
+#define SLOT_LABEL2            1
+#define SLOT_ROW0              2
+#define TEXT_SLOTS             (SLOT_ROW0 + DASHBOARD_ROWS)
+#define PENDING_TEXT_MASK      ((1u << TEXT_SLOTS) - 1)
+#define PENDING_DASHBOARD      (1u << 29)
+#define PENDING_DISPLAY_OFF    (1u << 30)
+
+static portMUX_TYPE mailbox_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t pending_mask = 0;
+static char pending_text[TEXT_SLOTS][LABEL_TEXT_MAX];
+
+// Render cost, microseconds spent in LVGL per second of wall time
+static volatile uint32_t busy_us_per_s = 0;
+
+// Panel transfer time: started in the flush callback, ended by the DMA done callback (ISR). LVGL hands
+// over the next chunk only after the previous one is done, so one start time is enough.
+static volatile int64_t flush_start_us = 0;
+static std::atomic<uint32_t> flush_acc_us{0};
+static std::atomic<int> flush_in_flight{0};
+static SemaphoreHandle_t flush_done = nullptr;      // given when no chunk is in flight any more
+static volatile uint32_t last_frame_flush_us = 0;
+
 // SH8601 init cmds
 static const sh8601_lcd_init_cmd_t lcd_init_cmds[] = {
     {0x11, (uint8_t []){0x00}, 0, 80},
@@ -54,12 +90,19 @@ static void lvgl_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* px
     const int offsety1 = area->y1;
     const int offsety2 = area->y2;
 
-    esp_lcd_panel_draw_bitmap(panel_handle,
-                              offsetx1, offsety1,
-                              offsetx2 + 1, offsety2 + 1,
-                              pixels);
-
-    lv_display_flush_ready(disp);
+    flush_start_us = esp_timer_get_time();
+    flush_in_flight++;
+    if (esp_lcd_panel_draw_bitmap(panel_handle,
+                                  offsetx1, offsety1,
+                                  offsetx2 + 1, offsety2 + 1,
+                                  pixels) != ESP_OK)
+    {
+        // No transfer, no done callback
+        flush_start_us = 0;
+        flush_in_flight--;
+        lv_display_flush_ready(disp);
+    }
+    // Otherwise lv_display_flush_ready() comes from the DMA done callback: the buffer is in use until then
 }
 
 // esp_lcd IO event callback
@@ -69,59 +112,192 @@ static bool notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io,
 {
     (void)panel_io;
     (void)edata;
+    if (flush_start_us)
+    {
+        flush_acc_us += (uint32_t)(esp_timer_get_time() - flush_start_us);
+        flush_start_us = 0;
+    }
+    BaseType_t woken = pdFALSE;
+    if (--flush_in_flight <= 0)
+    {
+        flush_in_flight = 0;
+        if (flush_done) xSemaphoreGiveFromISR(flush_done, &woken);
+    }
     if (user_ctx)
     {
         auto* disp = static_cast<lv_display_t*>(user_ctx);
         lv_display_flush_ready(disp);
     }
-    return false;
+    return woken == pdTRUE;
+}
+
+// LVGL tick source; replaces a periodic timer interrupt
+static uint32_t lvgl_tick_ms()
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// === Global LVGL label handles ===
+static lv_obj_t* label1 = nullptr;
+static lv_obj_t* label2 = nullptr;
+static lv_obj_t* rows[DASHBOARD_ROWS] = {};
+
+// Fixed dashboard objects; only rows whose text changes get invalidated and redrawn
+static void create_dashboard()
+{
+    if (rows[0]) return;
+    lv_obj_add_flag(label2, LV_OBJ_FLAG_HIDDEN);
+    for (int i = 0; i < DASHBOARD_ROWS; i++)
+    {
+        rows[i] = lv_label_create(lv_screen_active());
+        lv_obj_set_style_text_color(rows[i], lv_color_make(0, 0, 0xFF), LV_PART_MAIN);
+        lv_obj_set_style_text_font(rows[i], &lv_font_unscii_16, 0);
+        lv_obj_set_width(rows[i], LCD_H_RES - 32);
+        lv_label_set_text(rows[i], "");
+        lv_obj_set_pos(rows[i], 16, DASHBOARD_Y + i * DASHBOARD_ROW_PITCH);
+    }
+}
+
+static lv_obj_t* slot_object(int slot)
+{
+    if (slot == SLOT_LABEL1) return label1;
+    if (slot == SLOT_LABEL2) return label2;
+    return rows[slot - SLOT_ROW0];
 }
 
-static void increase_lvgl_tick(void* arg)
+// Apply pending mailbox content, returns the mask that was taken and whether anything changed on screen
+static uint32_t apply_pending(bool* changed)
 {
-    (void)arg;
-    lv_tick_inc(LVGL_TICK_PERIOD_MS);
+    char text[TEXT_SLOTS][LABEL_TEXT_MAX];
+    taskENTER_CRITICAL(&mailbox_lock);
+    uint32_t mask = pending_mask;
+    pending_mask = 0;
+    for (int i = 0; i < TEXT_SLOTS; i++)
+    {
+        if (mask & (1u << i)) memcpy(text[i], pending_text[i], LABEL_TEXT_MAX);
+    }
+    taskEXIT_CRITICAL(&mailbox_lock);
+
+    *changed = false;
+    if (mask & PENDING_DASHBOARD)
+    {
+        create_dashboard();
+        *changed = true;
+    }
+    for (int i = 0; i < TEXT_SLOTS; i++)
+    {
+        lv_obj_t* obj = slot_object(i);
+        if (!(mask & (1u << i)) || !obj) continue;
+        if (strcmp(lv_label_get_text(obj), text[i]) == 0) continue;  // unchanged, keep it out of the dirty area
+        lv_label_set_text(obj, text[i]);
+        *changed = true;
+    }
+    return mask;
 }
 
 // === LVGL Task ===
+// Sleeps until the mailbox has new content or LVGL has an animation/timer due.
 [[noreturn]] static void lvgl_task(void* arg)
 {
     ESP_LOGI(TAG, "Starting LVGL task");
+    uint32_t wait_ms = 0;
+    uint64_t busy_us = 0;
+    int64_t window_start = esp_timer_get_time();
+    int windows = 0;
     while (true)
     {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_ms));
+
+        int64_t t0 = esp_timer_get_time();
+        uint32_t mask = 0;
+        bool changed = false;
         if (xSemaphoreTake(lvgl_mux, portMAX_DELAY))
         {
-            lv_timer_handler();
+            mask = apply_pending(&changed);
+            if (changed)
+            {
+                xSemaphoreTake(flush_done, 0);  // left over from flushes of lv_timer_handler
+                flush_acc_us = 0;
+                lv_refr_now(nullptr);  // draw now so no refresh is left pending when we go to sleep
+                // The last chunk may still be on its way to the panel
+                if (flush_in_flight.load() > 0) xSemaphoreTake(flush_done, pdMS_TO_TICKS(LVGL_FLUSH_WAIT_MS));
+                last_frame_flush_us = flush_acc_us.load();
+            }
+            wait_ms = lv_timer_handler();
             xSemaphoreGive(lvgl_mux);
         }
-        vTaskDelay(pdMS_TO_TICKS(20));
+        int64_t t1 = esp_timer_get_time();
+        busy_us += (uint64_t)(t1 - t0);
+
+        if (mask & PENDING_DISPLAY_OFF)
+        {
+            ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, false));
+            taskENTER_CRITICAL(&mailbox_lock);
+            lvglTaskHandle = nullptr;
+            taskEXIT_CRITICAL(&mailbox_lock);
+            ESP_LOGI(TAG, "Display off, LVGL task ends");
+            vTaskDelete(nullptr);
+        }
+
+        if (lv_anim_count_running() == 0 || wait_ms == LV_NO_TIMER_READY)
+        {
+            wait_ms = LVGL_IDLE_WAIT_MS;
+        }
+        if (wait_ms < LVGL_MIN_WAIT_MS) wait_ms = LVGL_MIN_WAIT_MS;
+        if (wait_ms > LVGL_IDLE_WAIT_MS) wait_ms = LVGL_IDLE_WAIT_MS;
+
+        if (t1 - window_start >= 1000000)
+        {
+            busy_us_per_s = (uint32_t)(busy_us * 1000000ULL / (uint64_t)(t1 - window_start));
+            busy_us = 0;
+            window_start = t1;
+            if (++windows >= 60)
+            {
+                ESP_LOGI(TAG, "LVGL CPU time: %lu us/s, last frame flush: %lu us", (unsigned long) busy_us_per_s,
+                         (unsigned long) last_frame_flush_us);
+                windows = 0;
+            }
+        }
     }
 }
 
-// === Global LVGL label handles ===
-static lv_obj_t* label1 = nullptr;
-static lv_obj_t* label2 = nullptr;
-
-// === Thread-safe setter functions ===
-static inline void set_label(lv_obj_t* label, const char* text)
+// Post to the mailbox and wake the LVGL task; never blocks
+static void post(uint32_t what, int slot, const char* text)
 {
-    if (xSemaphoreTake(lvgl_mux, portMAX_DELAY))
+    TaskHandle_t task;
+    taskENTER_CRITICAL(&mailbox_lock);
+    if (text)
     {
-        if (label && text)
-            lv_label_set_text(label, text);
-
-        xSemaphoreGive(lvgl_mux);
+        char* dst = pending_text[slot];
+        strncpy(dst, text, LABEL_TEXT_MAX - 1);
+        dst[LABEL_TEXT_MAX - 1] = '\0';
+        what |= 1u << slot;
     }
+    pending_mask |= what;
+    task = lvglTaskHandle;
+    taskEXIT_CRITICAL(&mailbox_lock);
+    if (task) xTaskNotifyGive(task);
 }
 
+// === Thread-safe setter functions ===
 void set_label1(const char* text)
 {
-    set_label(label1, text);
+    if (text) post(0, SLOT_LABEL1, text);
 }
 
 void set_label2(const char* text)
 {
-    set_label(label2, text);
+    if (text) post(0, SLOT_LABEL2, text);
+}
+
+void gui_show_dashboard()
+{
+    post(PENDING_DASHBOARD, 0, nullptr);
+}
+
+void set_dashboard_row(int row, const char* text)
+{
+    if (text && row >= 0 && row < DASHBOARD_ROWS) post(0, SLOT_ROW0 + row, text);
 }
 
 void set_label2(long value)
@@ -141,8 +317,8 @@ bool gui_init()
     const size_t buf_line_bytes = LCD_H_RES * LVGL_BUF_HEIGHT * 2;
     const size_t buf_alloc_bytes = buf_line_bytes + 8;
 
-    void* buf1 = heap_caps_malloc(buf_alloc_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-    void* buf2 = heap_caps_malloc(buf_alloc_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    void* buf1 = mem_budget_alloc("gui: LVGL buffer 1", buf_alloc_bytes, MEM_PSRAM_ONLY);
+    void* buf2 = mem_budget_alloc("gui: LVGL buffer 2", buf_alloc_bytes, MEM_PSRAM_ONLY);
 
     if (!buf1 || !buf2)
     {
@@ -150,6 +326,7 @@ bool gui_init()
         abort();
     }
 
+    flush_done = xSemaphoreCreateBinary();
     lv_display_t* display = lv_display_create(LCD_H_RES, LCD_V_RES);
     if (!display)
     {
@@ -165,14 +342,8 @@ bool gui_init()
     lv_display_set_default(display);
     lv_obj_set_style_bg_color(lv_screen_active(), lv_color_black(), LV_PART_MAIN);
 
-    // Start LVGL tick timer
-    const esp_timer_create_args_t lvgl_tick_timer_args = {
-        .callback = &increase_lvgl_tick,
-        .name = "lvgl_tick"
-    };
-    esp_timer_handle_t lvgl_tick_timer = nullptr;
-    ESP_ERROR_CHECK(esp_timer_create(&lvgl_tick_timer_args, &lvgl_tick_timer));
-    ESP_ERROR_CHECK(esp_timer_start_periodic(lvgl_tick_timer, LVGL_TICK_PERIOD_MS * 1000));
+    // LVGL reads the time when it needs it instead of a 2 ms tick interrupt
+    lv_tick_set_cb(lvgl_tick_ms);
 
     // Install panel IO
     ESP_LOGI(TAG, "Install panel IO");
@@ -208,9 +379,8 @@ bool gui_init()
     // Bind LVGL and panel
     lv_display_set_user_data(display, panel_handle);
 
-    // Create LVGL mutex + task
+    // Create LVGL mutex + task; the task runs below all capture tasks
     lvgl_mux = xSemaphoreCreateMutex();
-    xTaskCreate(lvgl_task, "LVGL", 4096, nullptr, 2, &lvglTaskHandle);
     // === Show label ===
     if (xSemaphoreTake(lvgl_mux, portMAX_DELAY))
     {
@@ -229,11 +399,25 @@ bool gui_init()
 
         xSemaphoreGive(lvgl_mux);
     }
+    TaskHandle_t task = nullptr;
+    xTaskCreate(lvgl_task, "LVGL", 4096, nullptr, 2, &task);
+    taskENTER_CRITICAL(&mailbox_lock);
+    lvglTaskHandle = task;
+    taskEXIT_CRITICAL(&mailbox_lock);
     return false;
 }
 
+unsigned long gui_cpu_us_per_s()
+{
+    return busy_us_per_s;
+}
+
+unsigned long gui_flush_us()
+{
+    return last_frame_flush_us;
+}
+
 void turn_display_off()
 {
-    ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, false));
-    vTaskDelete(lvglTaskHandle);
+    post(PENDING_DISPLAY_OFF, 0, nullptr);
 }
@@ -4,4 +4,15 @@ bool gui_init();
 void set_label1(const char* text);
 void set_label2(const char* text);
 void set_label2(long value);
-void turn_display_off();
\ No newline at end of file
+void turn_display_off();
+
+// Logging dashboard: fixed rows below label1, replacing label2
+#define DASHBOARD_ROWS 9
+void gui_show_dashboard();
+void set_dashboard_row(int row, const char* text);
+
+// Microseconds per second spent rendering (updated once per second)
+unsigned long gui_cpu_us_per_s();
+
+// Microseconds the panel transfer took for the last redrawn frame
+unsigned long gui_flush_us();
@@ -0,0 +1,148 @@
+#include "id_stats.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "esp_log.h"
+#include "mem_budget.h"
+
+static const char* TAG = "ID_STATS";
+
+// 11-bit IDs are indexed directly, 29-bit IDs go into a small open-addressing table
+#define STD_ID_COUNT   0x800
+#define EXT_ID_SLOTS   512
+#define EXT_ID_EMPTY   0xFFFFFFFF
+
+static IdStat* g_std = nullptr;
+static IdStat* g_ext = nullptr;
+static unsigned g_used = 0;
+static unsigned long g_ext_overflow = 0;
+
+bool id_stats_init()
+{
+    if (g_std) return true;
+    const size_t bytes = (STD_ID_COUNT + EXT_ID_SLOTS) * sizeof(IdStat);
+    g_std = (IdStat*)mem_budget_alloc("id_stats: table", bytes, MEM_PREFER_PSRAM);
+    if (!g_std)
+    {
+        ESP_LOGW(TAG, "stats table allocation failed (%u bytes); statistics disabled", (unsigned) bytes);
+        return false;
+    }
+    g_ext = g_std + STD_ID_COUNT;
+    for (int i = 0; i < EXT_ID_SLOTS; i++) g_ext[i].id = EXT_ID_EMPTY;
+    ESP_LOGI(TAG, "stats table allocated: %u bytes", (unsigned) bytes);
+    return true;
+}
+
+static IdStat* lookup(uint32_t id)
+{
+    if (id < STD_ID_COUNT) return &g_std[id];
+
+    uint32_t h = (id * 2654435761u) >> 23;  // Fibonacci hash -> 9 bits
+    for (int probe = 0; probe < EXT_ID_SLOTS; probe++)
+    {
+        IdStat* s = &g_ext[(h + probe) & (EXT_ID_SLOTS - 1)];
+        if (s->id == id) return s;
+        if (s->id == EXT_ID_EMPTY)
+        {
+            s->id = id;
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+void id_stats_update(uint32_t id, int64_t ts_us, uint8_t dlc, const uint8_t* data)
+{
+    if (!g_std) return;
+    IdStat* s = lookup(id);
+    if (!s)
+    {
+        g_ext_overflow++;
+        return;
+    }
+
+    if (s->count == 0)
+    {
+        s->id = id;
+        s->first_us = ts_us;
+        s->min_dt_us = UINT32_MAX;
+        g_used++;
+    }
+    else
+    {
+        int64_t d = ts_us - s->last_us;
+        uint32_t dt = d < 0 ? 0 : (d > UINT32_MAX ? UINT32_MAX : (uint32_t)d);
+        if (dt < s->min_dt_us) s->min_dt_us = dt;
+        if (dt > s->max_dt_us) s->max_dt_us = dt;
+        s->sum_dt_us += dt;
+    }
+    s->last_us = ts_us;
+    s->count++;
+    s->dlc = dlc > 8 ? 8 : dlc;
+    memcpy(s->data, data, s->dlc);
+}
+
+unsigned id_stats_count()
+{
+    return g_used;
+}
+
+void id_stats_foreach(id_stats_visitor visit, void* ctx)
+{
+    if (!g_std) return;
+    for (int i = 0; i < STD_ID_COUNT + EXT_ID_SLOTS; i++)
+    {
+        if (g_std[i].count == 0) continue;
+        IdStat copy = g_std[i];  // the capture task keeps updating the live entry
+        visit(&copy, ctx);
+    }
+}
+
+static int format_stat(char* buf, size_t size, const IdStat* s)
+{
+    double span = (double)(s->last_us - s->first_us) / 1000000.0;
+    double rate = (s->count > 1 && span > 0) ? (double)(s->count - 1) / span : 0.0;
+    double mean_ms = s->count > 1 ? (double)s->sum_dt_us / (double)(s->count - 1) / 1000.0 : 0.0;
+    double min_ms = s->count > 1 ? s->min_dt_us / 1000.0 : 0.0;
+    double max_ms = s->count > 1 ? s->max_dt_us / 1000.0 : 0.0;
+
+    int n = snprintf(buf, size, "%03lX,%lu,%lld.%06lld,%lld.%06lld,%.3f,%.3f,%.3f,%.2f,",
+                     (unsigned long) s->id, (unsigned long) s->count,
+                     (long long)(s->first_us / 1000000), (long long)(s->first_us % 1000000),
+                     (long long)(s->last_us / 1000000), (long long)(s->last_us % 1000000),
+                     min_ms, mean_ms, max_ms, rate);
+    for (int i = 0; i < s->dlc && n < (int)size - 3; i++)
+    {
+        n += snprintf(buf + n, size - n, "%02X", s->data[i]);
+    }
+    if (n < (int)size - 1) buf[n++] = '\n';
+    return n;
+}
+
+bool id_stats_write(const char* path)
+{
+    if (!g_std) return false;
+    FILE* f = fopen(path, "w");
+    if (!f)
+    {
+        ESP_LOGW(TAG, "fopen failed: %s", path);
+        return false;
+    }
+
+    char line[128];
+    int n = snprintf(line, sizeof(line), "* CAN Bus Summary, %u IDs, %lu frames of untracked extended IDs\n",
+                     g_used, g_ext_overflow);
+    fwrite(line, 1, n, f);
+    const char* columns = "# id,count,first_ts,last_ts,min_dt_ms,mean_dt_ms,max_dt_ms,rate_hz,last_data\n";
+    fwrite(columns, 1, strlen(columns), f);
+
+    id_stats_foreach([](const IdStat* s, void* ctx)
+    {
+        char buf[128];
+        int len = format_stat(buf, sizeof(buf), s);
+        fwrite(buf, 1, len, (FILE*)ctx);
+    }, f);
+    fclose(f);
+    return true;
+}
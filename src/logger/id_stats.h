@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// Per-ID traffic statistics, updated in O(1) for every logged frame
+typedef struct
+{
+    uint32_t id;
+    uint32_t count;
+    int64_t first_us;
+    int64_t last_us;
+    uint32_t min_dt_us;
+    uint32_t max_dt_us;
+    uint64_t sum_dt_us;
+    uint8_t dlc;
+    uint8_t data[8];
+} IdStat;
+
+// Allocate the table (PSRAM if available)
+bool id_stats_init();
+
+void id_stats_update(uint32_t id, int64_t ts_us, uint8_t dlc, const uint8_t* data);
+
+// Visit every ID seen so far with a copy of its entry
+typedef void (*id_stats_visitor)(const IdStat* stat, void* ctx);
+void id_stats_foreach(id_stats_visitor visit, void* ctx);
+
+// Write the summary as text to 'path' (overwrites)
+bool id_stats_write(const char* path);
+
+// Number of distinct IDs seen so far
+unsigned id_stats_count();
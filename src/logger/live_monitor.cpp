@@ -0,0 +1,283 @@
+#include "live_monitor.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "id_stats.h"
+#include "live_tap.h"
+#include "mem_budget.h"
+
+static const char* TAG = "MONITOR";
+
+#define MONITOR_MAX_CLIENTS       4
+#define MONITOR_PERIOD_MS         100   // one message per client per period at most
+#define MONITOR_BATCH_FRAMES      64
+#define MONITOR_DEFAULT_RATE      200   // frames/s per client
+#define MONITOR_MAX_RATE          2000
+#define MONITOR_LATEST_PERIOD_MS  500
+#define MONITOR_MSG_BUF           (8 * 1024)
+
+typedef enum
+{
+    MONITOR_FRAMES,  // every frame, rate limited
+    MONITOR_LATEST   // latest value per ID, throttled
+} monitor_mode_t;
+
+typedef struct
+{
+    int fd;  // -1 = free slot
+    monitor_mode_t mode;
+    uint32_t cursor;
+    uint32_t lost;
+    uint32_t reported_lost;
+    unsigned rate;
+    float tokens;
+    int64_t last_us;
+} MonitorClient;
+
+static httpd_handle_t g_server = nullptr;
+static MonitorClient g_clients[MONITOR_MAX_CLIENTS];
+static SemaphoreHandle_t g_clients_mux = nullptr;
+static char* g_msg = nullptr;
+
+static const char* MONITOR_PAGE =
+    "<!DOCTYPE html><html><head><title>CAN Monitor</title>"
+    "<meta name='viewport' content='width=device-width,initial-scale=1'/>"
+    "<style>body{font-family:monospace;padding:1rem;}</style></head><body>"
+    "<h2>CAN Monitor</h2><pre id='o'></pre><script>"
+    "var o=document.getElementById('o'),l=[];"
+    "var w=new WebSocket('ws://'+location.host+'/ws/monitor'+location.search);"
+    "w.onmessage=function(e){l=l.concat(e.data.split('\\n').filter(Boolean)).slice(-60);"
+    "o.textContent=l.join('\\n');};"
+    "w.onclose=function(){o.textContent+='\\n-- disconnected --';};"
+    "</script></body></html>";
+
+static int format_frame(char* buf, size_t size, int64_t ts_us, uint32_t id, uint8_t dlc, const uint8_t* data)
+{
+    int n = snprintf(buf, size, "(%lld.%06lld) can %03lX#", (long long)(ts_us / 1000000),
+                     (long long)(ts_us % 1000000), (unsigned long) id);
+    for (int i = 0; i < dlc && n < (int)size - 3; i++)
+    {
+        n += snprintf(buf + n, size - n, "%02X", data[i]);
+    }
+    if (n < (int)size - 1) buf[n++] = '\n';
+    return n;
+}
+
+static void remove_client(int fd)
+{
+    xSemaphoreTake(g_clients_mux, portMAX_DELAY);
+    for (auto& c : g_clients)
+    {
+        if (c.fd == fd) c.fd = -1;
+    }
+    xSemaphoreGive(g_clients_mux);
+}
+
+static bool send_text(int fd, const char* text, size_t len)
+{
+    if (len == 0) return true;
+    httpd_ws_frame_t frame = {};
+    frame.type = HTTPD_WS_TYPE_TEXT;
+    frame.payload = (uint8_t*)text;
+    frame.len = len;
+    return httpd_ws_send_frame_async(g_server, fd, &frame) == ESP_OK;
+}
+
+static bool send_frames(MonitorClient& c, int64_t now)
+{
+    // token bucket, at most one second worth of burst
+    c.tokens += (float)c.rate * (float)(now - c.last_us) / 1000000.0f;
+    if (c.tokens > (float)c.rate) c.tokens = (float)c.rate;
+    c.last_us = now;
+
+    unsigned allowed = (unsigned)c.tokens;
+    if (allowed > MONITOR_BATCH_FRAMES) allowed = MONITOR_BATCH_FRAMES;
+
+    // over budget: skip to the newest frames instead of falling further behind
+    uint32_t head = live_tap_head();
+    if (head - c.cursor > allowed)
+    {
+        c.lost += head - c.cursor - allowed;
+        c.cursor = head - allowed;
+    }
+
+    LiveFrame frames[MONITOR_BATCH_FRAMES];
+    unsigned n = live_tap_read(&c.cursor, frames, allowed, &c.lost);
+    c.tokens -= (float)n;
+
+    size_t used = 0;
+    if (c.lost != c.reported_lost)
+    {
+        used += snprintf(g_msg, MONITOR_MSG_BUF, "* skipped %lu\n", (unsigned long)(c.lost - c.reported_lost));
+        c.reported_lost = c.lost;
+    }
+    for (unsigned i = 0; i < n; i++)
+    {
+        used += format_frame(g_msg + used, MONITOR_MSG_BUF - used, frames[i].ts_us, frames[i].id, frames[i].dlc,
+                             frames[i].data);
+    }
+    return send_text(c.fd, g_msg, used);
+}
+
+typedef struct
+{
+    int fd;
+    size_t used;
+    bool ok;
+} LatestCtx;
+
+static bool send_latest(MonitorClient& c, int64_t now)
+{
+    if (now - c.last_us < MONITOR_LATEST_PERIOD_MS * 1000LL) return true;
+    c.last_us = now;
+
+    LatestCtx ctx = {c.fd, 0, true};
+    id_stats_foreach([](const IdStat* s, void* arg)
+    {
+        auto* ctx = static_cast<LatestCtx*>(arg);
+        if (!ctx->ok) return;
+        if (ctx->used > MONITOR_MSG_BUF - 64)
+        {
+            ctx->ok = send_text(ctx->fd, g_msg, ctx->used);
+            ctx->used = 0;
+        }
+        ctx->used += format_frame(g_msg + ctx->used, MONITOR_MSG_BUF - ctx->used, s->last_us, s->id, s->dlc,
+                                  s->data);
+    }, &ctx);
+    return ctx.ok && send_text(c.fd, g_msg, ctx.used);
+}
+
+// Low priority fan-out task: reads the lossy tap, never touches the capture queues
+[[noreturn]] static void monitor_task(void* arg)
+{
+    while (true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(MONITOR_PERIOD_MS));
+        for (int i = 0; i < MONITOR_MAX_CLIENTS; i++)
+        {
+            xSemaphoreTake(g_clients_mux, portMAX_DELAY);
+            MonitorClient c = g_clients[i];
+            xSemaphoreGive(g_clients_mux);
+            if (c.fd < 0) continue;
+
+            if (httpd_ws_get_fd_info(g_server, c.fd) != HTTPD_WS_CLIENT_WEBSOCKET)
+            {
+                remove_client(c.fd);
+                continue;
+            }
+
+            int64_t now = esp_timer_get_time();
+            bool ok = c.mode == MONITOR_LATEST ? send_latest(c, now) : send_frames(c, now);
+            if (!ok)
+            {
+                ESP_LOGI(TAG, "client %d gone", c.fd);
+                remove_client(c.fd);
+                continue;
+            }
+
+            xSemaphoreTake(g_clients_mux, portMAX_DELAY);
+            if (g_clients[i].fd == c.fd) g_clients[i] = c;
+            xSemaphoreGive(g_clients_mux);
+        }
+    }
+}
+
+static esp_err_t ws_monitor_handler(httpd_req_t* req)
+{
+    if (req->method == HTTP_GET)
+    {
+        // handshake: /ws/monitor?mode=frames|latest&rate=<frames/s>
+        MonitorClient c = {};
+        c.fd = httpd_req_to_sockfd(req);
+        c.mode = MONITOR_FRAMES;
+        c.rate = MONITOR_DEFAULT_RATE;
+        c.cursor = live_tap_head();
+        c.last_us = esp_timer_get_time();
+
+        char query[64];
+        char param[16];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+        {
+            if (httpd_query_key_value(query, "mode", param, sizeof(param)) == ESP_OK && strcmp(param, "latest") == 0)
+            {
+                c.mode = MONITOR_LATEST;
+            }
+            if (httpd_query_key_value(query, "rate", param, sizeof(param)) == ESP_OK)
+            {
+                int rate = atoi(param);
+                if (rate > 0) c.rate = rate > MONITOR_MAX_RATE ? MONITOR_MAX_RATE : rate;
+            }
+        }
+
+        bool added = false;
+        xSemaphoreTake(g_clients_mux, portMAX_DELAY);
+        for (auto& slot : g_clients)
+        {
+            if (slot.fd < 0)
+            {
+                slot = c;
+                added = true;
+                break;
+            }
+        }
+        xSemaphoreGive(g_clients_mux);
+        if (!added)
+        {
+            ESP_LOGW(TAG, "too many monitor clients");
+            return ESP_FAIL;
+        }
+        ESP_LOGI(TAG, "client %d connected (%s, %u frames/s)", c.fd, c.mode == MONITOR_LATEST ? "latest" : "frames",
+                 c.rate);
+        return ESP_OK;
+    }
+
+    // Incoming messages are not used; read and discard them
+    httpd_ws_frame_t frame = {};
+    if (httpd_ws_recv_frame(req, &frame, 0) != ESP_OK) return ESP_FAIL;
+    if (frame.len > 0 && frame.len <= 64)
+    {
+        uint8_t buf[64];
+        frame.payload = buf;
+        return httpd_ws_recv_frame(req, &frame, frame.len);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t monitor_page_handler(httpd_req_t* req)
+{
+    return httpd_resp_send(req, MONITOR_PAGE, strlen(MONITOR_PAGE));
+}
+
+void live_monitor_register(httpd_handle_t server)
+{
+    if (!g_clients_mux)
+    {
+        g_msg = (char*)mem_budget_alloc("live_monitor: message buffer", MONITOR_MSG_BUF, MEM_PREFER_PSRAM);
+        if (!g_msg)
+        {
+            ESP_LOGW(TAG, "message buffer allocation failed; live monitor disabled");
+            return;
+        }
+        for (auto& c : g_clients) c.fd = -1;
+        g_clients_mux = xSemaphoreCreateMutex();
+        xTaskCreate(monitor_task, "Monitor", 6144, nullptr, 1, nullptr);
+    }
+    g_server = server;
+
+    httpd_uri_t ws = {
+        .uri = "/ws/monitor", .method = HTTP_GET, .handler = ws_monitor_handler, .user_ctx = nullptr,
+        .is_websocket = true
+    };
+    httpd_uri_t page = {
+        .uri = "/monitor", .method = HTTP_GET, .handler = monitor_page_handler, .user_ctx = nullptr
+    };
+    httpd_register_uri_handler(server, &ws);
+    httpd_register_uri_handler(server, &page);
+}
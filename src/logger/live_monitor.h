@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_http_server.h"
+
+// Register /ws/monitor (WebSocket) and /monitor (viewer page) and start the broadcaster task
+void live_monitor_register(httpd_handle_t server);
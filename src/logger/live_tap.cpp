@@ -0,0 +1,89 @@
+#include "live_tap.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "esp_log.h"
+#include "mem_budget.h"
+
+static const char* TAG = "LIVE_TAP";
+
+#define TAP_SLOTS 1024  // power of two
+
+typedef struct
+{
+    std::atomic<uint32_t> seq;  // position + 1 of the frame held, 0 while being written
+    LiveFrame frame;
+} TapSlot;
+
+static TapSlot* g_slots = nullptr;
+static std::atomic<uint32_t> g_head{0};
+
+bool live_tap_init()
+{
+    if (g_slots) return true;
+    g_slots = (TapSlot*)mem_budget_alloc("live_tap: slots", TAP_SLOTS * sizeof(TapSlot), MEM_PSRAM_ONLY);
+    if (!g_slots)
+    {
+        ESP_LOGW(TAG, "tap allocation failed; live monitor disabled");
+        return false;
+    }
+    return true;
+}
+
+void live_tap_push(int64_t ts_us, uint32_t id, uint8_t dlc, const uint8_t* data)
+{
+    if (!g_slots) return;
+    uint32_t pos = g_head.load(std::memory_order_relaxed);
+    TapSlot& slot = g_slots[pos & (TAP_SLOTS - 1)];
+
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.frame.ts_us = ts_us;
+    slot.frame.id = id;
+    slot.frame.dlc = dlc > 8 ? 8 : dlc;
+    memcpy(slot.frame.data, data, slot.frame.dlc);
+    slot.seq.store(pos + 1, std::memory_order_release);
+    g_head.store(pos + 1, std::memory_order_release);
+}
+
+uint32_t live_tap_head()
+{
+    return g_head.load(std::memory_order_acquire);
+}
+
+unsigned live_tap_read(uint32_t* cursor, LiveFrame* out, unsigned max, uint32_t* lost)
+{
+    if (!g_slots) return 0;
+    uint32_t head = g_head.load(std::memory_order_acquire);
+    uint32_t pos = *cursor;
+    if (head - pos > TAP_SLOTS)
+    {
+        *lost += head - pos - TAP_SLOTS;
+        pos = head - TAP_SLOTS;
+    }
+
+    unsigned n = 0;
+    while (pos != head && n < max)
+    {
+        TapSlot& slot = g_slots[pos & (TAP_SLOTS - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1)
+        {
+            (*lost)++;  // overwritten while we were catching up
+            pos++;
+            continue;
+        }
+        LiveFrame f = slot.frame;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != pos + 1)
+        {
+            (*lost)++;
+            pos++;
+            continue;
+        }
+        out[n++] = f;
+        pos++;
+    }
+    *cursor = pos;
+    return n;
+}
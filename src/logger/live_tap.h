@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Lossy snapshot tap of the capture pipeline.
+// The capture path publishes every frame with a few stores and never waits;
+// readers keep their own cursor and simply lose frames once they fall a full ring behind.
+typedef struct
+{
+    int64_t ts_us;
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t data[8];
+} LiveFrame;
+
+bool live_tap_init();
+
+// Called by the capture path (single producer)
+void live_tap_push(int64_t ts_us, uint32_t id, uint8_t dlc, const uint8_t* data);
+
+// Current write position; a new reader starts here to see only new frames
+uint32_t live_tap_head();
+
+// Copy up to 'max' frames starting at *cursor and advance it.
+// Frames overwritten before they could be read are counted in *lost.
+unsigned live_tap_read(uint32_t* cursor, LiveFrame* out, unsigned max, uint32_t* lost);
@@ -1,69 +1,148 @@
 #include "logging.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <dirent.h>
-#include <sys/time.h>
 #include <unistd.h>
 
 #include "esp_log.h"
-#include "driver/sdmmc_host.h"
-#include "sdmmc_cmd.h"
-#include "esp_vfs_fat.h"
-#include "driver/twai.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_timer.h"
-#include "common.h"
 #include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "batch_ctl.h"
+#include "block_crc.h"
+#include "bus_health.h"
+#include "clock_sync.h"
+#include "downsample.h"
+#include "frame_source.h"
+#include "id_stats.h"
+#include "live_tap.h"
+#include "mem_budget.h"
+#include "param_table.h"
+#include "profiler.h"
+#include "record_ring.h"
+#include "storage.h"
+#include "trace.h"
+#include "trigger.h"
 
 // -----------------------------
 // Shared config (from main)
 // -----------------------------
-#define CAN_TX_PIN         GPIO_NUM_18
-#define CAN_RX_PIN         GPIO_NUM_17
-#define CAN_QUEUE_LEN          480
-#define SD_QUEUE_LEN          1000
+#define CAN_QUEUE_LEN         2048  // internal DRAM, 20 bytes per frame
+#define SD_RING_BYTES  (256*1024)   // formatted lines, in PSRAM: ~5500 full-length lines
+#define SD_RING_INTERNAL_BYTES (32*1024)   // without PSRAM
 #define BATCH_MAX_BYTES    (64*1024)
-#define BATCH_MAX_MS       20
-#define FICTIONAL_START_TIME 1755839937.312293  // due to missing RTC
+#define BATCH_MAX_LATENCY_MS 200   // adaptive batching: queue-to-card latency bound at low load
+#define BATCH_MIN_FLUSH_MS   20
+#define BATCH_FIXED_MS       20    // fixed batching: max collection time
+#define CAN_HANDOVER_FRAMES   64   // CAN_RX wakes CAN_Proc after this many frames
+#define CAN_HANDOVER_MS       10   // or once the bus has been quiet this long
+#define HOUSEKEEPING_PERIOD_MS 1000
+#define SUMMARY_PERIOD_S   60
+#define FREE_SPACE_PERIOD_S 30
+#define TRIGGER_RETRY_MS   10      // trigger mode: committed lines waiting for sdQueue
+#define TRIGGER_CFG_MAX_BYTES 1024
+#define LOG_BLOCK_BYTES   (16*1024)  // integrity record after each block of lines
+#define BLOCK_RECORD_MAX   48
 
 static const char* TAG = "LOGGING_MODE";
 
 // -----------------------------
 // Log line structure
 // -----------------------------
+// Formatted on the stack; sdQueue stores only the used part (see record_ring.h)
 typedef struct
 {
     uint16_t len;
-    char data[46];
+    char data[52];      // longest line: 29-bit ID with 8 data bytes, 50 chars + newline
 } LogLine;
 
 // -----------------------------
 // CAN message structure
 // -----------------------------
+// canQueue entry. The 64-bit log time is split into two words so the record is 4-byte aligned and
+// 20 bytes instead of 24; the DLC and the trace tag ride in the unused top bits of the high word.
 typedef struct
 {
+    uint32_t ts_lo;
+    uint32_t ts_hi_dlc;     // bits 0..26: timestamp bits 32..58, 27: traced (trace.h), 28..31: DLC
     uint32_t id;
-    uint8_t len;
     uint8_t buf[8];
-    double timestamp;
-} CANMessage_t;
+} CanFrameRec;
+
+static_assert(sizeof(CanFrameRec) == 20, "canQueue entry size");
+
+static inline void frame_rec_set(CanFrameRec* r, int64_t ts_us, uint8_t dlc, bool traced)
+{
+    r->ts_lo = (uint32_t)ts_us;
+    r->ts_hi_dlc = ((uint32_t)((uint64_t)ts_us >> 32) & 0x07FFFFFF) | ((uint32_t)traced << 27) | ((uint32_t)dlc << 28);
+}
+
+static inline int64_t frame_rec_ts(const CanFrameRec& r)
+{
+    return (int64_t)(((uint64_t)(r.ts_hi_dlc & 0x07FFFFFF) << 32) | r.ts_lo);
+}
+
+static inline bool frame_rec_traced(const CanFrameRec& r)
+{
+    return (r.ts_hi_dlc >> 27) & 1;
+}
+
+static inline uint8_t frame_rec_dlc(const CanFrameRec& r)
+{
+    return (uint8_t)(r.ts_hi_dlc >> 28);
+}
 
 // -----------------------------
 // Globals
 // -----------------------------
 static FILE* logFile = nullptr;
+static char logPath[128] = "";
 static unsigned long messageCount = 0;
+static unsigned long droppedCan = 0;
+static unsigned long droppedSd = 0;
+static unsigned long droppedStatus = 0;     // '*' records and error frames, not counted as frame loss
+static uint32_t bytesWritten = 0;
+static unsigned long writeErrors = 0;
+static volatile uint32_t batchPending = 0;
+static uint32_t busBits = 0;
+static uint64_t freeBytes = 0;
 static unsigned long lastSync = 0;
 
-static QueueHandle_t sdQueue = nullptr;
+static RecordRing sdQueue;
+static bool sdQueueReady = false;
 static QueueHandle_t canQueue = nullptr;
+static TaskHandle_t procTask = nullptr;
+static TaskHandle_t writerTask = nullptr;
+
+// SD_Writer sleeps until this many bytes are in sdQueue (0: it is awake); producers wake it
+static std::atomic<uint32_t> writerNeed{0};
+static std::atomic<uint32_t> writtenPos{0};     // sdQueue position up to which lines were written
+static unsigned long procWakeups = 0;
+static unsigned long writerWakeups = 0;
 
 // Large batch buffer moved to heap/PSRAM to save internal DRAM for queues
 static uint8_t* g_batchBuf = nullptr;
 static size_t g_batchBufSize = BATCH_MAX_BYTES;
+static uint32_t g_sdWakeBytes = SD_RING_BYTES / 2;    // SD_Writer is woken early at this sdQueue fill
+
+static bool g_triggerSpecSet = false;
+static TriggerConfig g_triggerCfg;
+
+// Integrity records in the log (SD_Writer; the log header before it starts)
+static uint32_t g_blockSeq = 0;
+static uint32_t g_blockBytes = 0;
+static uint32_t g_blockCrc = 0;
+
+static bool g_batchAdaptive = true;
+static uint32_t g_batchMaxLatencyMs = BATCH_MAX_LATENCY_MS;
+static BatchCtl g_batch;
 
 // -----------------------------
 // Helpers
@@ -73,11 +152,10 @@ static unsigned long millis()
     return (unsigned long)(esp_timer_get_time() / 1000ULL);
 }
 
-static double get_unix_timestamp()
+// Nominal frame length on the wire without stuff bits: SOF..EOF + intermission
+static inline uint32_t frame_bits(bool extended, uint8_t dlc)
 {
-    struct timeval tv;
-    gettimeofday(&tv, nullptr);
-    return (double)tv.tv_sec + (tv.tv_usec / 1000000.0) + FICTIONAL_START_TIME;
+    return (extended ? 67u : 47u) + 8u * dlc;
 }
 
 // cleanup threshold (bytes)
@@ -94,8 +172,7 @@ static void next_free_file_name(char* path, size_t path_size)
 
     // Check free space
     uint64_t out_total = 0, out_free = 0;
-    esp_err_t err = esp_vfs_fat_info(SD_MOUNT_POINT, &out_total, &out_free);
-    if (err == ESP_OK)
+    if (storage_info(&out_total, &out_free))
     {
         ESP_LOGI("SD", "Free space: %llu bytes", (unsigned long long) out_free);
 
@@ -106,7 +183,7 @@ static void next_free_file_name(char* path, size_t path_size)
             while (out_free < SD_TARGET_FREE)
             {
                 int min_index = -1;
-                DIR* d = opendir(SD_MOUNT_POINT);
+                DIR* d = opendir(storage_root());
                 if (!d) break;
 
                 while ((entry = readdir(d)) != nullptr)
@@ -129,26 +206,29 @@ static void next_free_file_name(char* path, size_t path_size)
                 }
 
                 char del_path[128];
-                snprintf(del_path, sizeof(del_path), SD_MOUNT_POINT "/CAN%05d.LOG", min_index);
+                snprintf(del_path, sizeof(del_path), "%s/CAN%05d.LOG", storage_root(), min_index);
                 ESP_LOGW("SD", "Deleting %s", del_path);
                 unlink(del_path);
+                snprintf(del_path, sizeof(del_path), "%s/CAN%05d.SUM", storage_root(), min_index);
+                unlink(del_path);
+                snprintf(del_path, sizeof(del_path), "%s/CAN%05d.AGG", storage_root(), min_index);
+                unlink(del_path);
+                snprintf(del_path, sizeof(del_path), "%s/CAN%05d.CRC", storage_root(), min_index);
+                unlink(del_path);
 
-                if (esp_vfs_fat_info(SD_MOUNT_POINT, &out_total, &out_free) != ESP_OK) break;
+                if (!storage_info(&out_total, &out_free)) break;
             }
 
             ESP_LOGI("SD", "Free space after cleanup: %llu bytes", (unsigned long long) out_free);
         }
-    }
-    else
-    {
-        ESP_LOGW("SD", "esp_vfs_fat_info failed: %s", esp_err_to_name(err));
+        freeBytes = out_free;
     }
 
     // Find next free filename
-    DIR* dir = opendir(SD_MOUNT_POINT);
+    DIR* dir = opendir(storage_root());
     if (dir == nullptr)
     {
-        snprintf(path, path_size, SD_MOUNT_POINT "/CAN%05d.LOG", 0);
+        snprintf(path, path_size, "%s/CAN%05d.LOG", storage_root(), 0);
         return;
     }
 
@@ -162,7 +242,81 @@ static void next_free_file_name(char* path, size_t path_size)
     }
     closedir(dir);
 
-    snprintf(path, path_size, SD_MOUNT_POINT "/CAN%05d.LOG", max_index + 1);
+    snprintf(path, path_size, "%s/CAN%05d.LOG", storage_root(), max_index + 1);
+}
+
+// CANxxxxx.LOG -> CANxxxxx.<ext>
+static void sidecar_path(const char* log_path, const char* ext, char* out, size_t out_size)
+{
+    snprintf(out, out_size, "%s", log_path);
+    char* dot = strrchr(out, '.');
+    if (dot && (size_t)(dot - out) + 1 + strlen(ext) < out_size)
+    {
+        strcpy(dot + 1, ext);
+    }
+}
+
+static void write_summary()
+{
+    if (!logPath[0]) return;
+    char path[128];
+    sidecar_path(logPath, "SUM", path, sizeof(path));
+    id_stats_write(path);
+}
+
+// Bytes into the log, hashed for the companion file
+static size_t write_log(const void* data, size_t len)
+{
+    size_t written = storage_write(logFile, data, len);
+    block_crc_update(data, written);
+    return written;
+}
+
+// Integrity records: the log is cut into blocks of whole lines of up to LOG_BLOCK_BYTES, each followed
+// by "* BLOCK <seq> <bytes> <crc32>" with the CRC32 of its bytes, so damage on the card is found and
+// located without a reference pattern (test/src/canlog_verify.cpp)
+static inline void block_add(const void* data, size_t len)
+{
+    g_blockCrc = esp_rom_crc32_le(g_blockCrc, (const uint8_t*)data, len);
+    g_blockBytes += len;
+}
+
+// No room for another line of the longest kind
+static inline bool block_full()
+{
+    return g_blockBytes + sizeof(LogLine::data) > LOG_BLOCK_BYTES;
+}
+
+// Record closing the current block into out (BLOCK_RECORD_MAX bytes); its length
+static size_t block_record(char* out)
+{
+    int n = snprintf(out, BLOCK_RECORD_MAX, "* BLOCK %lu %lu %08lX\n", (unsigned long)g_blockSeq,
+                     (unsigned long)g_blockBytes, (unsigned long)g_blockCrc);
+    g_blockSeq++;
+    g_blockBytes = 0;
+    g_blockCrc = 0;
+    return (size_t)n;
+}
+
+// Lines into the current block; when that fills it, its closing record goes into rec (BLOCK_RECORD_MAX
+// bytes). Returns the record's length, 0 if the block has room left.
+static size_t block_take(const void* data, size_t len, char* rec)
+{
+    block_add(data, len);
+    return block_full() ? block_record(rec) : 0;
+}
+
+// The previous log ended with a power cut: hash the tail its companion file does not cover yet
+static void finalize_previous_log(const char* path)
+{
+    const char* name = strrchr(path, '/');
+    int idx;
+    if (!name || sscanf(name + 1, "CAN%05d.LOG", &idx) != 1 || idx == 0) return;
+    char prev[128];
+    char crc[128];
+    snprintf(prev, sizeof(prev), "%s/CAN%05d.LOG", storage_root(), idx - 1);
+    sidecar_path(prev, "CRC", crc, sizeof(crc));
+    block_crc_finalize(prev, crc);
 }
 
 // -----------------------------
@@ -173,6 +327,7 @@ static bool init_sd_card_and_open_file()
     ESP_LOGI("SD", "SD card mounted");
     char path[128];
     next_free_file_name(path, sizeof(path));
+    finalize_previous_log(path);
     logFile = fopen(path, "w");
     if (!logFile)
     {
@@ -180,75 +335,125 @@ static bool init_sd_card_and_open_file()
         return false;
     }
     ESP_LOGI("SD", "Logging to: %s", path);
+    snprintf(logPath, sizeof(logPath), "%s", path);
+    char crc_path[128];
+    sidecar_path(path, "CRC", crc_path, sizeof(crc_path));
+    block_crc_open(crc_path);
     static char io_buf[8 * 1024];
     setvbuf(logFile, io_buf, _IOFBF, sizeof(io_buf));
-    const char* header = "* CAN Bus Log Started\n";
-    fwrite(header, 1, strlen(header), logFile);
-    fflush(logFile);
-    fsync(fileno(logFile));
-    return true;
-}
-
-// -----------------------------
-// CAN Init
-// -----------------------------
-static bool init_can()
-{
-    twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(CAN_TX_PIN, CAN_RX_PIN, TWAI_MODE_LISTEN_ONLY);
-    twai_timing_config_t t_config = TWAI_TIMING_CONFIG_500KBITS();
-    twai_filter_config_t f_config = TWAI_FILTER_CONFIG_ACCEPT_ALL();
-
-    if (twai_driver_install(&g_config, &t_config, &f_config) != ESP_OK)
-    {
-        ESP_LOGE("CAN", "driver install failed");
-        return false;
-    }
-    if (twai_start() != ESP_OK)
-    {
-        ESP_LOGE("CAN", "start failed");
-        return false;
-    }
-    ESP_LOGI("CAN", "Driver installed and started");
+    char header[96];
+    int n = snprintf(header, sizeof(header), "* CAN Bus Log Started\n");
+    clock_sync_base_record(header + n, sizeof(header) - n - 1);
+    strcat(header, "\n");
+    g_blockSeq = g_blockBytes = g_blockCrc = 0;
+    write_log(header, strlen(header));
+    block_add(header, strlen(header));
+    storage_sync(logFile);
     return true;
 }
 
 // -----------------------------
 // Tasks
 // -----------------------------
+// Hands frames to CAN_Proc in bursts: CAN_Proc is notified once CAN_HANDOVER_FRAMES frames are
+// waiting, the oldest has waited CAN_HANDOVER_MS or the bus went quiet, instead of for every frame
 [[noreturn]] static void can_receiver_task(void* arg)
 {
-    twai_message_t message;
+    SourceFrame message;
+    unsigned pending = 0;
+    int64_t handover_at = 0;
+    int64_t last_ts = 0;
     while (true)
     {
-        if (twai_receive(&message, pdMS_TO_TICKS(100)) == ESP_OK)
+        uint32_t timeout_ms = FRAME_SOURCE_WAIT_FOREVER;
+        if (pending) timeout_ms = (uint32_t)std::max<int64_t>(0, (handover_at - esp_timer_get_time()) / 1000);
+        bool got = frame_source_receive(&message, timeout_ms);
+        if (got && message.dlc > 0)
         {
-            if (message.data_length_code > 0)
+            int64_t ts_us = clock_sync_now_us();
+            // Frames are stamped as they are taken from the driver queue, and a backlog is taken within
+            // microseconds; keep them strictly ordered so time-sorting tools (merge, CANCOL) keep bus order.
+            // Backward clock steps are far larger than this window and pass through.
+            if (ts_us <= last_ts && last_ts - ts_us < 1000) ts_us = last_ts + 1;
+            last_ts = ts_us;
+            const bool traced = trace_sample();
+            if (traced) trace_event(TRACE_RX, (uint32_t)ts_us, 0);
+
+            CanFrameRec msg;
+            frame_rec_set(&msg, ts_us, message.dlc, traced);
+            msg.id = message.id;
+            memcpy(msg.buf, message.data, message.dlc);
+            busBits += frame_bits(message.extended, message.dlc);
+            if (xQueueSend(canQueue, &msg, 0) != pdTRUE)
             {
-                CANMessage_t msg;
-                msg.id = message.identifier;
-                msg.len = message.data_length_code;
-                memcpy(msg.buf, message.data, msg.len);
-                msg.timestamp = get_unix_timestamp();
-                if (xQueueSend(canQueue, &msg, 0) != pdTRUE)
-                {
-                    ESP_LOGW("CAN_RX", "canQueue full, dropped");
-                }
+                droppedCan++;
+                ESP_LOGW("CAN_RX", "canQueue full, dropped");
+            }
+            else
+            {
+                if (traced) trace_event(TRACE_CANQ_PUSH, (uint32_t)ts_us, 0);
+                if (pending++ == 0) handover_at = esp_timer_get_time() + CAN_HANDOVER_MS * 1000;
             }
         }
-        taskYIELD();
+        // Also early once canQueue is 3/4 full: CAN_Proc runs below us, so it only gets to work on the
+        // frames when notified and this task blocks (or from the other core)
+        if (pending && (!got || pending >= CAN_HANDOVER_FRAMES || esp_timer_get_time() >= handover_at ||
+                        uxQueueSpacesAvailable(canQueue) < CAN_QUEUE_LEN / 4))
+        {
+            xTaskNotifyGive(procTask);
+            pending = 0;
+        }
     }
 }
 
+// Queue a line for SD_Writer and wake it once what it waits for is there, or sdQueue is half full
+static bool sd_enqueue(const LogLine& line, uint32_t* end = nullptr)
+{
+    if (!record_ring_push(&sdQueue, line.data, line.len, end)) return false;
+    uint32_t need = writerNeed.load();
+    uint32_t queued = record_ring_used(&sdQueue);
+    if (need && (queued >= need || queued >= g_sdWakeBytes) && writerNeed.exchange(0))
+    {
+        xTaskNotifyGive(writerTask);
+    }
+    return true;
+}
+
+// Trigger mode: committed lines go on to sdQueue
+static bool trigger_sink(const char* text, uint16_t len)
+{
+    LogLine line;
+    memcpy(line.data, text, len);
+    line.len = len;
+    return sd_enqueue(line);
+}
+
 [[noreturn]] static void can_processor_task(void* arg)
 {
-    CANMessage_t msg;
+    CanFrameRec msg;
+    TickType_t wait = portMAX_DELAY;
     while (true)
     {
-        if (xQueueReceive(canQueue, &msg, portMAX_DELAY) == pdTRUE)
+        ulTaskNotifyTake(pdTRUE, wait);
+        procWakeups++;
+        while (xQueueReceive(canQueue, &msg, 0) == pdTRUE)
         {
+            const int64_t ts_us = frame_rec_ts(msg);
+            const uint8_t dlc = frame_rec_dlc(msg);
+            const bool traced = frame_rec_traced(msg);
+            const bool error = (msg.id & CAN_ERR_FLAG) != 0;     // from logging_error_frame
+            if (traced) trace_event(TRACE_CANQ_POP, (uint32_t)ts_us, 0);
+            if (!error)
+            {
+                id_stats_update(msg.id, ts_us, dlc, msg.buf);
+                downsample_update(msg.id, ts_us, dlc, msg.buf);
+                live_tap_push(ts_us, msg.id, dlc, msg.buf);
+            }
+
             LogLine line{};
-            int n = snprintf(line.data, sizeof(line.data), "(%.6lf) can %03lX#", msg.timestamp, (unsigned long)msg.id);
-            for (int i = 0; i < msg.len && n < (int)sizeof(line.data) - 2; i++)
+            int n = snprintf(line.data, sizeof(line.data), "(%lld.%06lld) can %03lX#", (long long)(ts_us / 1000000),
+                             (long long)(ts_us % 1000000), (unsigned long)msg.id);
+            for (int i = 0; i < dlc && n < (int)sizeof(line.data) - 2; i++)
             {
                 n += snprintf(line.data + n, sizeof(line.data) - n, "%02X", msg.buf[i]);
             }
@@ -263,145 +468,377 @@ static bool init_can()
             }
             line.data[n] = '\0';
             line.len = (uint16_t)n;
+            if (traced) trace_event(TRACE_FORMAT, (uint32_t)ts_us, 0);
 
-            if (xQueueSend(sdQueue, &line, 0) != pdTRUE)
+            uint32_t end;
+            if (trigger_enabled())
+            {
+                if (error) trigger_on_error();
+                // Lost committed lines count as sdQueue drops: that is where they were held up
+                droppedSd += trigger_on_line(msg.id, dlc, msg.buf, line.data, line.len);
+                if (!error) messageCount++;
+            }
+            else if (!sd_enqueue(line, &end))
             {
+                droppedSd++;
                 ESP_LOGW("CAN_Proc", "sdQueue full, dropped line");
             }
             else
             {
-                messageCount++;
+                if (!error) messageCount++;
+                if (traced) trace_event(TRACE_SDQ_PUSH, (uint32_t)ts_us, end);
             }
+            // After the line is queued, so a correction record follows the frame that caused it
+            if (!error) clock_sync_on_frame(msg.id, dlc, msg.buf, ts_us);
         }
+        // A window that sdQueue could not take yet is retried without waiting for new frames, and a
+        // downsampling bucket is closed on time on a quiet bus
+        wait = trigger_enabled() && trigger_drain(trigger_sink) ? pdMS_TO_TICKS(TRIGGER_RETRY_MS) : portMAX_DELAY;
+        uint32_t bucket_due_ms = downsample_tick(clock_sync_now_us());
+        if (bucket_due_ms != DOWNSAMPLE_IDLE) wait = std::min<TickType_t>(wait, pdMS_TO_TICKS(bucket_due_ms) + 1);
     }
 }
 
+// Sleep until sdQueue holds 'need' bytes (or g_sdWakeBytes), at most 'ticks'
+static void writer_wait(uint32_t need, TickType_t ticks)
+{
+    writerNeed.store(need);
+    // Enough may have been queued before 'need' was published; whoever clears it owns the wakeup
+    if (record_ring_used(&sdQueue) >= need && writerNeed.exchange(0)) return;
+    ulTaskNotifyTake(pdTRUE, ticks);
+    writerNeed.store(0);
+    writerWakeups++;
+}
+
+// Whole lines into the batch buffer, up to one line past the target, with the integrity record after
+// each completed block (the buffer keeps room for one)
+static size_t take_lines(size_t used, size_t target)
+{
+    size_t limit = std::min(g_batchBufSize - BLOCK_RECORD_MAX, target + sizeof(LogLine::data));
+    while (used < limit)
+    {
+        size_t max = std::min<size_t>(limit - used, LOG_BLOCK_BYTES - g_blockBytes);
+        size_t n = record_ring_take(&sdQueue, g_batchBuf + used, max, nullptr);
+        if (n) trace_event(TRACE_SDQ_POP, 0, sdQueue.tail.load());
+        size_t rec = block_take(g_batchBuf + used, n, (char*)g_batchBuf + used + n);
+        used += n + rec;
+        // A block that is not full has room for any line: then the ring or the limit stopped the take
+        if (!rec) break;
+    }
+    batchPending = used;
+    return used;
+}
+
+// Sleeps until a batch opens, then until the plan's size (watermark wakeup from sd_enqueue) or
+// deadline, and writes it: one wakeup per batch under load, none while the bus is idle
 [[noreturn]] static void sd_writer_task(void* arg)
 {
+    int64_t batch_start = esp_timer_get_time();
     while (true)
     {
-        size_t used = 0;
-        LogLine line;
-        if (xQueueReceive(sdQueue, &line, pdMS_TO_TICKS(50)) == pdTRUE)
+        writer_wait(1, portMAX_DELAY);
+        if (!g_batchBuf)
         {
-            if (g_batchBuf && line.len <= g_batchBufSize)
-            {
-                memcpy(g_batchBuf, line.data, line.len);
-                used = line.len;
-            }
-            else if (logFile && line.len > 0)
+            // Fallback: write line by line if there is no batch buffer
+            char line[sizeof(LogLine::data)];
+            size_t len;
+            while ((len = record_ring_take(&sdQueue, (uint8_t*)line, sizeof(line), nullptr)) > 0)
             {
-                // Fallback: write directly if no batch buffer
-                fwrite(line.data, 1, line.len, logFile);
+                if (!logFile) continue;
+                size_t written = write_log(line, len);
+                char rec[BLOCK_RECORD_MAX];
+                size_t rec_len = block_take(line, len, rec);
+                if (rec_len) written += write_log(rec, rec_len);
                 fflush(logFile);
+                bytesWritten += written;
+                writtenPos = sdQueue.tail.load();
+                trace_event(TRACE_WRITE, 0, writtenPos);
             }
+            continue;
         }
 
-        TickType_t start = xTaskGetTickCount();
-        while (g_batchBuf && (used + sizeof(LogLine::data) < g_batchBufSize))
+        // Collect until the plan's size or deadline (see batch_ctl.h)
+        const BatchPlan& plan = g_batch.plan;
+        const int64_t deadline = esp_timer_get_time() + (int64_t)plan.flush_ms * 1000;
+        size_t used = 0;
+        while (true)
         {
-            if ((xTaskGetTickCount() - start) * portTICK_PERIOD_MS >= BATCH_MAX_MS) break;
-
-            LogLine more;
-            if (xQueueReceive(sdQueue, &more, 0) != pdTRUE) break;
-            if (used + more.len > g_batchBufSize) break;
-            memcpy(g_batchBuf + used, more.data, more.len);
-            used += more.len;
+            used = take_lines(used, plan.target_bytes);
+            // take_lines keeps room for an integrity record at the end of the buffer
+            if (plan.stop_when_idle || used >= plan.target_bytes ||
+                used + sizeof(LogLine::data) + BLOCK_RECORD_MAX > g_batchBufSize)
+            {
+                break;
+            }
+            int64_t left_us = deadline - esp_timer_get_time();
+            if (left_us <= 0) break;
+            // Rounded up, so the deadline is not checked again a tick early
+            const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+            writer_wait((uint32_t)(plan.target_bytes - used), (TickType_t)((left_us + tick_us - 1) / tick_us));
         }
 
-        if (used > 0 && logFile && g_batchBuf)
+        if (used > 0 && logFile)
         {
-            size_t written = fwrite(g_batchBuf, 1, used, logFile);
+            int64_t t0 = esp_timer_get_time();
+            size_t written = write_log(g_batchBuf, used);
+            bytesWritten += written;
             if (written != used)
             {
+                writeErrors++;
                 ESP_LOGE("SD", "fwrite failed: wrote %u of %u", (unsigned) written, (unsigned) used);
             }
             fflush(logFile);
+            // SD_Writer is the only consumer, so everything up to the tail is in this batch
+            writtenPos = sdQueue.tail.load();
+            trace_event(TRACE_WRITE, 0, writtenPos);
+
+            int64_t t1 = esp_timer_get_time();
+            BatchSample sample;
+            sample.bytes = used;
+            sample.cycle_us = (uint32_t)std::min<int64_t>(t1 - batch_start, UINT32_MAX);
+            sample.write_us = (uint32_t)(t1 - t0);
+            sample.queue_used = record_ring_used(&sdQueue);
+            sample.queue_len = sdQueue.size;
+            batch_ctl_update(&g_batch, &sample);
+            batch_start = t1;
         }
+        batchPending = 0;
+    }
+}
 
-        // Only yield if we didn't write anything this iteration to keep draining the queue aggressively
-        if (used == 0) {
-            vTaskDelay(pdMS_TO_TICKS(1));
-        }
+// Clock correction records go through sdQueue, so they land in order with the frames around them
+static void clock_record_to_log(const char* text)
+{
+    logging_note(text);
+}
+
+// Lines written before the sync are durable after it
+static void sync_log()
+{
+    if (!logFile) return;
+    uint32_t pos = writtenPos.load();
+    storage_sync(logFile);
+    trace_event(TRACE_SYNC, 0, pos);
+}
+
+// Trigger capture if configured (logging_configure_trigger() or TRIGGER.CFG); a bad configuration
+// logs everything rather than nothing
+static void start_trigger()
+{
+    if (!g_triggerSpecSet)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "%s/TRIGGER.CFG", storage_root());
+        FILE* f = fopen(path, "r");
+        if (!f) return;
+        char text[TRIGGER_CFG_MAX_BYTES + 1];
+        size_t n = fread(text, 1, TRIGGER_CFG_MAX_BYTES, f);
+        fclose(f);
+        text[n] = '\0';
+        if (!logging_configure_trigger(text)) return;
     }
+    trigger_init(&g_triggerCfg);
 }
 
 // -----------------------------
 // Public API: start logging mode
 // -----------------------------
-void start_logging_mode()
+bool logging_note(const char* text)
+{
+    if (!sdQueueReady) return false;
+    LogLine line{};
+    int n = snprintf(line.data, sizeof(line.data) - 1, "%s", text);
+    if (n > (int)sizeof(line.data) - 2) n = sizeof(line.data) - 2;
+    line.data[n++] = '\n';
+    line.len = (uint16_t)n;
+    if (!sd_enqueue(line))
+    {
+        droppedStatus++;
+        return false;
+    }
+    return true;
+}
+
+// Through canQueue behind the frames received so far, so the log (and each trigger window, via the
+// pre-trigger ring) stays in time order
+bool logging_error_frame(uint32_t err_class, const uint8_t* data)
+{
+    if (!canQueue || !procTask) return false;
+    CanFrameRec msg;
+    frame_rec_set(&msg, clock_sync_now_us(), 8, false);
+    msg.id = CAN_ERR_FLAG | err_class;
+    memcpy(msg.buf, data, 8);
+    if (xQueueSend(canQueue, &msg, 0) != pdTRUE)
+    {
+        droppedStatus++;
+        return false;
+    }
+    xTaskNotifyGive(procTask);
+    return true;
+}
+
+bool logging_start()
 {
     if (!init_sd_card_and_open_file())
     {
         ESP_LOGE(TAG, "SD init/open failed for logging");
-        return;
+        return false;
     }
 
-    if (!init_can())
+    if (!frame_source_start())
     {
-        ESP_LOGE(TAG, "CAN init failed!");
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        if (!init_can())
-        {
-            ESP_LOGE(TAG, "CAN init failed permanently!");
-            return;
-        }
+        ESP_LOGE(TAG, "CAN init failed permanently!");
+        return false;
     }
 
-    canQueue = xQueueCreate(CAN_QUEUE_LEN, sizeof(CANMessage_t));
-    sdQueue = xQueueCreate(SD_QUEUE_LEN, sizeof(LogLine));
-    if (!canQueue || !sdQueue)
+    id_stats_init();
+    live_tap_init();
+    param_table_start();
+    if (downsample_init())
+    {
+        char path[128];
+        sidecar_path(logPath, "AGG", path, sizeof(path));
+        downsample_open(path);
+    }
+
+    canQueue = xQueueCreate(CAN_QUEUE_LEN, sizeof(CanFrameRec));
+    if (!canQueue)
     {
         ESP_LOGE(TAG, "queue create failed");
-        return;
+        return false;
     }
+    mem_budget_note("logging: canQueue", CAN_QUEUE_LEN * sizeof(CanFrameRec), false);
+
+    // Formatted lines wait in PSRAM; internal DRAM only gets a small ring if there is none
+    uint32_t ring_bytes = SD_RING_BYTES;
+    uint8_t* ring = (uint8_t*)mem_budget_alloc("logging: sdQueue", ring_bytes, MEM_PSRAM_ONLY);
+    if (!ring)
+    {
+        ring_bytes = SD_RING_INTERNAL_BYTES;
+        ring = (uint8_t*)mem_budget_alloc("logging: sdQueue", ring_bytes, MEM_INTERNAL);
+    }
+    if (!ring)
+    {
+        ESP_LOGE(TAG, "sdQueue allocation failed");
+        return false;
+    }
+    record_ring_init(&sdQueue, ring, ring_bytes);
+    g_sdWakeBytes = ring_bytes / 2;
+    sdQueueReady = true;
+
+    clock_sync_set_record_sink(clock_record_to_log);
+    start_trigger();
 
     // Allocate batch buffer in PSRAM if available to preserve internal DRAM for queues
     if (!g_batchBuf)
     {
-        g_batchBuf = (uint8_t*)heap_caps_malloc(BATCH_MAX_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (g_batchBuf)
-        {
-            g_batchBufSize = BATCH_MAX_BYTES;
-            ESP_LOGI("SD", "Batch buffer allocated in PSRAM: %u bytes", (unsigned) g_batchBufSize);
-        }
-        else
-        {
-            g_batchBuf = (uint8_t*)heap_caps_malloc(BATCH_MAX_BYTES, MALLOC_CAP_8BIT);
-            if (g_batchBuf)
-            {
-                g_batchBufSize = BATCH_MAX_BYTES;
-                ESP_LOGI("SD", "Batch buffer allocated in internal heap: %u bytes", (unsigned) g_batchBufSize);
-            }
-            else
-            {
-                g_batchBufSize = 0;
-                ESP_LOGW("SD", "Batch buffer allocation failed; will write line-by-line without batching");
-            }
-        }
+        g_batchBuf = (uint8_t*)mem_budget_alloc("logging: SD batch buffer", BATCH_MAX_BYTES, MEM_PREFER_PSRAM);
+        g_batchBufSize = g_batchBuf ? BATCH_MAX_BYTES : 0;
+        if (!g_batchBuf) ESP_LOGW("SD", "Batch buffer allocation failed; will write line-by-line without batching");
     }
 
-    xTaskCreate(can_receiver_task, "CAN_RX", 4096, nullptr, 5, nullptr);
-    xTaskCreate(can_processor_task, "CAN_Proc", 4096, nullptr, 4, nullptr);
+    BatchConfig batch_cfg;
+    batch_cfg.buffer_bytes = g_batchBufSize;
+    batch_cfg.unit_bytes = storage_write_unit();
+    // Part of the latency budget is spent before CAN_Proc sees a frame
+    batch_cfg.max_latency_ms = std::max<uint32_t>(g_batchMaxLatencyMs, 2 * CAN_HANDOVER_MS) - CAN_HANDOVER_MS;
+    batch_cfg.min_flush_ms = BATCH_MIN_FLUSH_MS;
+    batch_cfg.adaptive = g_batchAdaptive;
+    batch_cfg.fixed_flush_ms = BATCH_FIXED_MS;
+    batch_ctl_init(&g_batch, &batch_cfg);
+    ESP_LOGI("SD", "%s batching, write unit %u bytes", g_batchAdaptive ? "adaptive" : "fixed",
+             (unsigned)batch_cfg.unit_bytes);
+
+    // Consumers first: producers notify them by handle
     if (logFile)
     {
-        xTaskCreate(sd_writer_task, "SD_Writer", 8192, nullptr, 3, nullptr);
+        xTaskCreate(sd_writer_task, "SD_Writer", 8192, nullptr, 3, &writerTask);
+    }
+    xTaskCreate(can_processor_task, "CAN_Proc", 4096, nullptr, 4, &procTask);
+    xTaskCreate(can_receiver_task, "CAN_RX", 4096, nullptr, 5, nullptr);
+    mem_budget_log();
+    profiler_sample();     // CPU shares in the first report cover logging only
+    return true;
+}
+
+bool logging_configure_trigger(const char* spec)
+{
+    char err[64];
+    if (!trigger_parse(spec, &g_triggerCfg, err, sizeof(err)))
+    {
+        ESP_LOGE(TAG, "trigger: %s", err);
+        return false;
+    }
+    g_triggerSpecSet = true;
+    return true;
+}
+
+void logging_configure_batching(bool adaptive, uint32_t max_latency_ms)
+{
+    g_batchAdaptive = adaptive;
+    if (max_latency_ms) g_batchMaxLatencyMs = max_latency_ms;
+}
+
+void logging_housekeeping()
+{
+    static int stat_cnt = 0;
+    static int summary_cnt = 0;
+    static int free_cnt = 0;
+
+    // Callers may poll faster; start_logging_mode() wakes once per period (minus a tick of jitter)
+    if (millis() - lastSync < HOUSEKEEPING_PERIOD_MS - portTICK_PERIOD_MS) return;
+    lastSync = millis();
+    sync_log();
+    downsample_write();
+    block_crc_write();
+    bus_health_sample();
+    if (++stat_cnt >= PROFILER_PERIOD_S)
+    {
+        ESP_LOGI(TAG, "Messages: %lu, wakeups CAN_Proc %lu SD_Writer %lu", messageCount, procWakeups,
+                 writerWakeups);
+        // Per-task CPU share over the period; IDLEx is what the cores had left (and could sleep through)
+        profiler_sample();
+        profiler_log();
+        profiler_write_records();
+        stat_cnt = 0;
+    }
+    // No explicit close happens (power is simply cut), so the summary is refreshed periodically
+    if (++summary_cnt >= SUMMARY_PERIOD_S)
+    {
+        write_summary();
+        summary_cnt = 0;
     }
+    if (++free_cnt >= FREE_SPACE_PERIOD_S)
+    {
+        uint64_t total = 0, free_space = 0;
+        if (storage_info(&total, &free_space)) freeBytes = free_space;
+        free_cnt = 0;
+    }
+}
 
-    int stat_cnt = 0;
+void logging_flush()
+{
+    sync_log();
+    write_summary();
+    // The open downsampling bucket belongs to CAN_Proc: have it closed there
+    if (procTask)
+    {
+        downsample_request_close();
+        xTaskNotifyGive(procTask);
+        for (int i = 0; i < 100 && downsample_close_pending(); i++) vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    downsample_write();
+    block_crc_write();
+}
+
+void start_logging_mode()
+{
+    if (!logging_start()) return;
+    TickType_t last_wake = xTaskGetTickCount();
     while (true)
     {
-        if (millis() - lastSync >= 1000)
-        {
-            lastSync = millis();
-            if (logFile) fsync(fileno(logFile));
-            if (stat_cnt++ >= 60)
-            {
-                ESP_LOGI(TAG, "Messages: %lu", messageCount);
-                stat_cnt = 0;
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(10));
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(HOUSEKEEPING_PERIOD_MS));
+        logging_housekeeping();
     }
 }
 
@@ -409,3 +846,25 @@ long get_message_count()
 {
     return messageCount;
 }
+
+void get_logging_stats(LoggingStats* out)
+{
+    out->frames = messageCount;
+    out->dropped_can = droppedCan;
+    out->dropped_sd = droppedSd;
+    out->dropped_status = droppedStatus;
+    out->can_queue_used = canQueue ? uxQueueMessagesWaiting(canQueue) : 0;
+    out->can_queue_len = CAN_QUEUE_LEN;
+    out->sd_queue_used = sdQueueReady ? record_ring_used(&sdQueue) : 0;
+    out->sd_queue_len = sdQueue.size;
+    out->bytes_written = bytesWritten;
+    out->write_errors = writeErrors;
+    out->batch_pending = batchPending;
+    out->batch_target = (uint32_t)g_batch.plan.target_bytes;
+    out->batch_flush_ms = g_batch.plan.flush_ms;
+    out->proc_wakeups = procWakeups;
+    out->writer_wakeups = writerWakeups;
+    out->bus_bits = busBits;
+    out->bitrate = frame_source_bitrate();
+    out->free_bytes = freeBytes;
+}
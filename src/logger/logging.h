@@ -1,6 +1,66 @@
 #pragma once
 
-// Initialize logging
+#include <cstdint>
+
+// Log timestamps are time since boot plus this offset, due to missing RTC, until clock_sync.h
+// gets a real time reference
+#define FICTIONAL_START_TIME 1755839937.312293
+
+// Initialize logging and run the supervisor loop (returns only if startup failed)
 void start_logging_mode();
 
+// Open the log, start the frame source and the capture tasks
+bool logging_start();
+
+// Before logging_start(): adaptive SD write batching (default) or the fixed plan, and the latency
+// bound of the adaptive plan (0 keeps the default), see batch_ctl.h
+void logging_configure_batching(bool adaptive, uint32_t max_latency_ms);
+
+// Before logging_start(): trigger capture with this configuration (trigger.h) instead of a
+// TRIGGER.CFG in the log directory; false if it does not parse
+bool logging_configure_trigger(const char* spec);
+
+// Periodic sync, summary and free-space refresh; self-throttles to HOUSEKEEPING_PERIOD_MS (1 s), so it may be
+// polled faster. start_logging_mode() calls it once per period.
+void logging_housekeeping();
+
+// Sync the log file, rewrite the summary and write out the open downsampling bucket now
+void logging_flush();
+
+// Queue a '*' comment line (without newline, at most 50 chars) for the log, behind the frames queued so far
+bool logging_note(const char* text);
+
+// candump error frames: identifier with this flag, 8 data bytes (linux/can/error.h)
+#define CAN_ERR_FLAG 0x20000000u
+
+// Queue an error frame CAN_ERR_FLAG | err_class with the current log time. It is formatted by CAN_Proc
+// like a received frame, so it lands in time order (in trigger mode: only inside a window).
+bool logging_error_frame(uint32_t err_class, const uint8_t* data);
+
 long get_message_count();
+
+// Pipeline counters; byte and bit counters wrap, use differences between two snapshots
+typedef struct
+{
+    unsigned long frames;          // frames formatted and queued for the SD card (trigger mode: buffered)
+    unsigned long dropped_can;     // lost at canQueue (CAN_RX -> CAN_Proc)
+    unsigned long dropped_sd;      // lost at sdQueue (CAN_Proc -> SD_Writer)
+    unsigned long dropped_status;  // '*' records and error frames that found their queue full
+    unsigned can_queue_used;
+    unsigned can_queue_len;
+    unsigned sd_queue_used;        // bytes, including the 2-byte length of each line
+    unsigned sd_queue_len;         // ring size in bytes
+    uint32_t bytes_written;        // bytes handed to fwrite
+    unsigned long write_errors;    // short writes
+    uint32_t batch_pending;        // bytes collected by SD_Writer, not yet written
+    uint32_t batch_target;         // current adaptive batch size and flush interval
+    uint32_t batch_flush_ms;
+    unsigned long proc_wakeups;    // CAN_Proc / SD_Writer wakeups, one per handed-over burst / batch
+    unsigned long writer_wakeups;
+    uint32_t bus_bits;             // estimated bits on the bus for all received frames
+    uint32_t bitrate;
+    uint64_t free_bytes;           // refreshed every FREE_SPACE_PERIOD_S
+} LoggingStats;
+
+void get_logging_stats(LoggingStats* out);
+
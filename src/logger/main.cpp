@@ -1,3 +1,4 @@
+#include <cstdio>
 #include <esp_event.h>
 #include <esp_heap_caps.h>
 #include <esp_log.h>
@@ -7,6 +8,7 @@
 #include <esp_wifi.h>
 #include <nvs_flash.h>
 
+#include "bus_health.h"
 #include "gui.h"
 #include "wifi_web.h"
 #include "logging.h"
@@ -29,16 +31,79 @@ static const char* TAG = "CAN_Logger";
 
 static const unsigned display_on_time_sec = 5 * 60;
 
-// === Counter Task ===
-static void display_message_counter(void* arg)
+// Keep the AP and web server up while logging so /monitor can show live traffic (costs power, opt-in)
+static const bool live_monitor_while_logging = false;
+
+// Dashboard update periods; the slowest is used while the GUI exceeds its render budget
+static const unsigned dashboard_period_ms[] = {250, 500, 1000};
+static const unsigned long gui_budget_us_per_s = 20000;  // 2 % of one core
+
+// === Dashboard Task ===
+static void display_dashboard(void* arg)
 {
-    ESP_LOGI(TAG, "Starting display_message_counter task for %u seconds", display_on_time_sec);
+    ESP_LOGI(TAG, "Starting display_dashboard task for %u seconds", display_on_time_sec);
+    gui_show_dashboard();
 
-    unsigned cnt = 0;
-    while (cnt++ < display_on_time_sec)
+    LoggingStats prev, cur;
+    BusHealth health;
+    get_logging_stats(&prev);
+    int64_t prev_us = esp_timer_get_time();
+    const int64_t end_us = prev_us + display_on_time_sec * 1000000LL;
+    unsigned level = 0;
+    char row[48];
+
+    while (esp_timer_get_time() < end_us)
     {
-        set_label2(get_message_count());
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelay(pdMS_TO_TICKS(dashboard_period_ms[level]));
+        get_logging_stats(&cur);
+        bus_health_get(&health);
+        int64_t now_us = esp_timer_get_time();
+        double dt = (double)(now_us - prev_us) / 1000000.0;
+        if (dt <= 0) continue;
+
+        unsigned long frames = cur.frames - prev.frames;
+        uint32_t bits = cur.bus_bits - prev.bus_bits;
+        uint32_t bytes = cur.bytes_written - prev.bytes_written;
+
+        snprintf(row, sizeof(row), "Frames %lu", cur.frames);
+        set_dashboard_row(0, row);
+        snprintf(row, sizeof(row), "Rate   %.0f fr/s", frames / dt);
+        set_dashboard_row(1, row);
+        // The bus rate and the queues are known only once logging has started
+        if (cur.bitrate) snprintf(row, sizeof(row), "Bus    %.1f %%", 100.0 * bits / dt / cur.bitrate);
+        else snprintf(row, sizeof(row), "Bus    -- %%");
+        set_dashboard_row(2, row);
+        snprintf(row, sizeof(row), "Loss   hw %lu q %lu sd %lu", health.lost_overrun + health.lost_missed,
+                 cur.dropped_can, cur.dropped_sd + cur.write_errors);
+        set_dashboard_row(3, row);
+        char can_q[8] = "--", sd_q[8] = "--";
+        if (cur.can_queue_len) snprintf(can_q, sizeof(can_q), "%u", cur.can_queue_used * 100 / cur.can_queue_len);
+        if (cur.sd_queue_len) snprintf(sd_q, sizeof(sd_q), "%u", cur.sd_queue_used * 100 / cur.sd_queue_len);
+        snprintf(row, sizeof(row), "Queues %s%% / %s%%", can_q, sd_q);
+        set_dashboard_row(4, row);
+        snprintf(row, sizeof(row), "SD     %.3f MB/s", bytes / dt / (1024.0 * 1024.0));
+        set_dashboard_row(5, row);
+        snprintf(row, sizeof(row), "Free   %.1f GB", cur.free_bytes / (1024.0 * 1024.0 * 1024.0));
+        set_dashboard_row(6, row);
+        snprintf(row, sizeof(row), "GUI    %.1f ms/s %lu us", gui_cpu_us_per_s() / 1000.0, gui_flush_us());
+        set_dashboard_row(7, row);
+        snprintf(row, sizeof(row), "CAN    %s %lu/%lu", health.ctrl_ok ? source_state_name(health.ctrl.state) : "?",
+                 (unsigned long)health.ctrl.tec, (unsigned long)health.ctrl.rec);
+        set_dashboard_row(8, row);
+
+        prev = cur;
+        prev_us = now_us;
+
+        // keep the render cost within budget
+        unsigned long cost = gui_cpu_us_per_s();
+        if (cost > gui_budget_us_per_s && level + 1 < sizeof(dashboard_period_ms) / sizeof(dashboard_period_ms[0]))
+        {
+            level++;
+        }
+        else if (cost < gui_budget_us_per_s / 2 && level > 0)
+        {
+            level--;
+        }
     }
     turn_display_off();    // to avoid burn-in risk
     vTaskDelete(nullptr);  // safely end this task
@@ -96,11 +161,14 @@ extern "C" void app_main(void)
         }
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
-    if (server) httpd_stop(server);
-    esp_wifi_stop();
+    if (!live_monitor_while_logging)
+    {
+        if (server) httpd_stop(server);
+        esp_wifi_stop();
+    }
 
     // Logging Mode
     set_label1("Logger");
-    xTaskCreate(display_message_counter, "Counter", 4096, nullptr, 2, nullptr);
+    xTaskCreate(display_dashboard, "Dashboard", 4096, nullptr, 1, nullptr);
     start_logging_mode();
 }
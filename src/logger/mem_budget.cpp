@@ -0,0 +1,87 @@
+#include "mem_budget.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+#define MEM_BUDGET_ENTRIES 24
+
+static const char* TAG = "MEM";
+
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static MemBudgetEntry g_entries[MEM_BUDGET_ENTRIES];
+static unsigned g_count = 0;
+
+void mem_budget_note(const char* owner, size_t bytes, bool psram)
+{
+    portENTER_CRITICAL(&g_lock);
+    if (g_count < MEM_BUDGET_ENTRIES) g_entries[g_count++] = {owner, (uint32_t)bytes, psram};
+    portEXIT_CRITICAL(&g_lock);
+}
+
+void* mem_budget_alloc(const char* owner, size_t bytes, MemPlacement where)
+{
+    void* p = nullptr;
+    bool psram = false;
+    if (where != MEM_INTERNAL && heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0)
+    {
+        p = heap_caps_calloc(1, bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        psram = p != nullptr;
+    }
+    if (!p && where != MEM_PSRAM_ONLY)
+    {
+        p = heap_caps_calloc(1, bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!p)
+    {
+        ESP_LOGW(TAG, "%s: %u bytes not available", owner, (unsigned)bytes);
+        return nullptr;
+    }
+    mem_budget_note(owner, bytes, psram);
+    return p;
+}
+
+unsigned mem_budget_entries(MemBudgetEntry* out, unsigned max)
+{
+    portENTER_CRITICAL(&g_lock);
+    unsigned n = g_count < max ? g_count : max;
+    for (unsigned i = 0; i < n; i++) out[i] = g_entries[i];
+    portEXIT_CRITICAL(&g_lock);
+    return n;
+}
+
+void mem_budget_totals(MemBudgetTotals* out)
+{
+    *out = MemBudgetTotals{};
+    portENTER_CRITICAL(&g_lock);
+    for (unsigned i = 0; i < g_count; i++)
+    {
+        if (g_entries[i].psram) out->psram_bytes += g_entries[i].bytes;
+        else out->internal_bytes += g_entries[i].bytes;
+    }
+    portEXIT_CRITICAL(&g_lock);
+    out->internal_total = heap_caps_get_total_size(MALLOC_CAP_INTERNAL);
+    out->internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    out->internal_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    out->internal_largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    out->psram_total = heap_caps_get_total_size(MALLOC_CAP_SPIRAM);
+    out->psram_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+}
+
+void mem_budget_log()
+{
+    MemBudgetEntry entries[MEM_BUDGET_ENTRIES];
+    unsigned n = mem_budget_entries(entries, MEM_BUDGET_ENTRIES);
+    MemBudgetTotals t;
+    mem_budget_totals(&t);
+    ESP_LOGI(TAG, "%-32s %8s %8s", "buffer", "internal", "psram");
+    for (unsigned i = 0; i < n; i++)
+    {
+        ESP_LOGI(TAG, "%-32s %8u %8u", entries[i].owner, entries[i].psram ? 0u : (unsigned)entries[i].bytes,
+                 entries[i].psram ? (unsigned)entries[i].bytes : 0u);
+    }
+    ESP_LOGI(TAG, "%-32s %8u %8u", "total", (unsigned)t.internal_bytes, (unsigned)t.psram_bytes);
+    ESP_LOGI(TAG, "internal heap %u free of %u (min %u, largest block %u), PSRAM %u free of %u",
+             (unsigned)t.internal_free, (unsigned)t.internal_total, (unsigned)t.internal_min_free,
+             (unsigned)t.internal_largest, (unsigned)t.psram_free, (unsigned)t.psram_total);
+}
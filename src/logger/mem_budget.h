@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Long-lived buffers per subsystem and where they ended up, internal DRAM or PSRAM, next to the heap
+// totals. Internal DRAM is what the capture queues and the TWAI driver need; everything that can live
+// in PSRAM should, so the report shows what is left for capture depth.
+//
+// Buffers are allocated through mem_budget_alloc(); memory allocated elsewhere (FreeRTOS queues,
+// driver queues) is recorded with mem_budget_note().
+typedef enum
+{
+    MEM_PREFER_PSRAM = 0,   // PSRAM if present, internal otherwise
+    MEM_PSRAM_ONLY,         // optional feature buffers: nothing rather than internal RAM
+    MEM_INTERNAL,
+} MemPlacement;
+
+typedef struct
+{
+    const char* owner;      // "subsystem: what", a string literal
+    uint32_t bytes;
+    bool psram;
+} MemBudgetEntry;
+
+typedef struct
+{
+    uint32_t internal_bytes;    // sum of the entries per memory type
+    uint32_t psram_bytes;
+    size_t internal_total;      // heap_caps totals
+    size_t internal_free;
+    size_t internal_min_free;
+    size_t internal_largest;
+    size_t psram_total;
+    size_t psram_free;
+} MemBudgetTotals;
+
+// Zeroed, nullptr on failure (logged)
+void* mem_budget_alloc(const char* owner, size_t bytes, MemPlacement where);
+void mem_budget_note(const char* owner, size_t bytes, bool psram);
+
+unsigned mem_budget_entries(MemBudgetEntry* out, unsigned max);
+void mem_budget_totals(MemBudgetTotals* out);
+
+// Table on the console
+void mem_budget_log();
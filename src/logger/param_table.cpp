@@ -0,0 +1,132 @@
+#include "param_table.h"
+
+#include <cstring>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "live_tap.h"
+#include "mem_budget.h"
+
+static const char* TAG = "PARAMS";
+
+#define PARAM_IDS           (CANAS_MAX_ID + 1)
+#define PARAM_BATCH         64
+#define PARAM_PERIOD_SHIFT  3       // period average: 1/8 of each new interval
+#define PARAM_MAX_GAP_US    10000000    // longer intervals are clock steps or restarts, not a rate
+
+static_assert(sizeof(ParamEntry) == 32, "ParamEntry must stay 32 bytes");
+
+// -----------------------------
+// State
+// -----------------------------
+static ParamEntry* g_table = nullptr;       // indexed by identifier, count 0: not seen
+static uint16_t* g_order = nullptr;         // identifiers in order of first appearance
+static unsigned g_used = 0;
+static SemaphoreHandle_t g_mux = nullptr;   // table and counters; the poll holds it one batch at a time
+static uint32_t g_cursor = 0;
+static uint32_t g_lost = 0;
+static unsigned long g_decoded = 0;
+static unsigned long g_ignored = 0;
+
+// -----------------------------
+// Decoder
+// -----------------------------
+static void update(const LiveFrame& f)
+{
+    CanasHeader hdr;
+    if (!canas_parse(f.id, f.dlc, f.data, &hdr))
+    {
+        g_ignored++;
+        return;
+    }
+    g_decoded++;
+    ParamEntry& e = g_table[f.id];
+    if (e.count == 0)
+    {
+        e.id = (uint16_t)f.id;
+        g_order[g_used++] = (uint16_t)f.id;
+    }
+    else if (f.ts_us > e.last_us && f.ts_us - e.last_us < PARAM_MAX_GAP_US)
+    {
+        uint32_t dt = (uint32_t)(f.ts_us - e.last_us);
+        e.period_us = e.period_us ? e.period_us + ((int32_t)(dt - e.period_us) >> PARAM_PERIOD_SHIFT) : dt;
+    }
+    e.count++;
+    e.last_us = f.ts_us;
+    e.hdr = hdr;
+    memset(e.payload, 0, sizeof(e.payload));
+    memcpy(e.payload, f.data + CANAS_HEADER_BYTES, f.dlc - CANAS_HEADER_BYTES > 4 ? 4 : f.dlc - CANAS_HEADER_BYTES);
+}
+
+void param_table_poll()
+{
+    if (!g_table) return;
+    LiveFrame frames[PARAM_BATCH];
+    unsigned n;
+    do
+    {
+        xSemaphoreTake(g_mux, portMAX_DELAY);
+        n = live_tap_read(&g_cursor, frames, PARAM_BATCH, &g_lost);
+        for (unsigned i = 0; i < n; i++) update(frames[i]);
+        xSemaphoreGive(g_mux);
+    } while (n == PARAM_BATCH);
+}
+
+[[noreturn]] static void param_task(void* arg)
+{
+    while (true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(PARAM_PERIOD_MS));
+        param_table_poll();
+    }
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool param_table_start()
+{
+    if (g_table) return true;
+    g_table = (ParamEntry*)mem_budget_alloc("params: table", PARAM_IDS * sizeof(ParamEntry), MEM_PREFER_PSRAM);
+    g_order = (uint16_t*)mem_budget_alloc("params: order", PARAM_IDS * sizeof(uint16_t), MEM_PREFER_PSRAM);
+    g_mux = xSemaphoreCreateMutex();
+    if (!g_table || !g_order || !g_mux)
+    {
+        ESP_LOGW(TAG, "parameter table allocation failed; /api/params disabled");
+        g_table = nullptr;
+        return false;
+    }
+    memset(g_table, 0, PARAM_IDS * sizeof(ParamEntry));
+    g_cursor = live_tap_head();
+    xTaskCreate(param_task, "Params", 3072, nullptr, 1, nullptr);
+    return true;
+}
+
+void param_table_foreach(param_visitor visit, void* ctx)
+{
+    if (!g_table) return;
+    xSemaphoreTake(g_mux, portMAX_DELAY);
+    unsigned used = g_used;     // entries are only ever appended
+    xSemaphoreGive(g_mux);
+    for (unsigned i = 0; i < used; i++)
+    {
+        xSemaphoreTake(g_mux, portMAX_DELAY);
+        ParamEntry e = g_table[g_order[i]];
+        xSemaphoreGive(g_mux);
+        visit(&e, ctx);
+    }
+}
+
+void param_table_stats(ParamTableStats* out)
+{
+    *out = {};
+    if (!g_table) return;
+    xSemaphoreTake(g_mux, portMAX_DELAY);
+    out->params = g_used;
+    out->decoded = g_decoded;
+    out->ignored = g_ignored;
+    out->lost = g_lost;
+    xSemaphoreGive(g_mux);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "canas.h"
+
+// Live CANaerospace parameter table: a low priority task reads the lossy live tap (live_tap.h), so
+// the capture path pays nothing, decodes the header of every 11-bit frame that can be CANaerospace
+// and keeps, indexed directly by identifier, the latest header and payload, the log time of the last
+// update and a smoothed update period. GET /api/params serves it as JSON or binary.
+#define PARAM_PERIOD_MS     50      // decoder task wakeup; the tap holds ~1000 frames
+#define PARAM_MAGIC         "CANPARAM"
+#define PARAM_VERSION       1
+
+// One parameter, also the record of the binary snapshot (little endian)
+typedef struct
+{
+    int64_t last_us;        // log time of the latest message
+    uint32_t count;         // messages decoded
+    uint32_t period_us;     // moving average of the interval between messages, 0 until the second
+    uint16_t id;
+    CanasHeader hdr;
+    uint8_t payload[4];
+    uint8_t reserved[6];
+} ParamEntry;
+
+// Binary snapshot: "CANPARAM", uint32 version, uint32 record size, int64 log time of the snapshot,
+// then ParamEntry records in order of first appearance until the end of the response
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;
+    int64_t now_us;
+} ParamDumpHeader;
+
+typedef struct
+{
+    unsigned params;
+    unsigned long decoded;      // frames taken as CANaerospace
+    unsigned long ignored;      // frames that cannot be (29-bit ID, unknown type, short payload)
+    unsigned long lost;         // frames the task fell a full tap behind on
+} ParamTableStats;
+
+// Allocate the table (PSRAM if available) and start the decoder task
+bool param_table_start();
+
+// Decode what the tap holds now; the task does this every PARAM_PERIOD_MS
+void param_table_poll();
+
+// Parameters in order of first appearance; entries are copied one at a time, so a visitor may be slow
+typedef void (*param_visitor)(const ParamEntry* entry, void* ctx);
+void param_table_foreach(param_visitor visit, void* ctx);
+
+void param_table_stats(ParamTableStats* out);
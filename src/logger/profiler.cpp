@@ -0,0 +1,171 @@
+#include "profiler.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "logging.h"
+
+#define PROFILER_HAVE_TASKS (CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS)
+
+static const char* TAG = "PROFILER";
+
+// -----------------------------
+// State
+// -----------------------------
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static ProfilerSnapshot g_snap = {};
+
+#if PROFILER_HAVE_TASKS
+// Run time counters of the previous snapshot, matched by task number (tasks come and go)
+typedef struct
+{
+    UBaseType_t number;
+    uint32_t counter;
+} PrevCounter;
+
+static PrevCounter g_prev[PROFILER_MAX_TASKS];
+static unsigned g_prev_count = 0;
+static uint32_t g_prev_total = 0;
+#endif
+
+// Copy for the reports, too large for the supervisor's stack (supervisor task only)
+static ProfilerSnapshot g_report;
+
+// -----------------------------
+// Helpers
+// -----------------------------
+static void sample_heap(uint32_t caps, ProfilerHeap* out)
+{
+    out->free = heap_caps_get_free_size(caps);
+    out->min_free = heap_caps_get_minimum_free_size(caps);
+    out->largest = heap_caps_get_largest_free_block(caps);
+    out->frag_pct = out->free ? 100 - (unsigned)(out->largest * 100 / out->free) : 0;
+}
+
+#if PROFILER_HAVE_TASKS
+static uint32_t prev_counter(UBaseType_t number, uint32_t current)
+{
+    for (unsigned i = 0; i < g_prev_count; i++)
+    {
+        if (g_prev[i].number == number) return g_prev[i].counter;
+    }
+    return current;     // new task: no share until the next snapshot
+}
+#endif
+
+// -----------------------------
+// Public API
+// -----------------------------
+void profiler_sample()
+{
+    ProfilerHeap internal, psram;
+    sample_heap(MALLOC_CAP_INTERNAL, &internal);
+    sample_heap(MALLOC_CAP_SPIRAM, &psram);
+    int64_t now = esp_timer_get_time();
+
+#if PROFILER_HAVE_TASKS
+    // A few spare entries for tasks created in between; the call fails if the array is too small
+    UBaseType_t capacity = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t* status = (TaskStatus_t*)malloc(capacity * sizeof(TaskStatus_t));
+    uint32_t total = 0;
+    UBaseType_t n = status ? uxTaskGetSystemState(status, capacity, &total) : 0;
+#endif
+
+    portENTER_CRITICAL(&g_lock);
+    g_snap.interval_ms = g_snap.at_us ? (uint32_t)((now - g_snap.at_us) / 1000) : 0;
+    g_snap.at_us = now;
+    g_snap.internal = internal;
+    g_snap.psram = psram;
+    g_snap.task_count = 0;
+#if PROFILER_HAVE_TASKS
+    // The run time counter counts microseconds of wall time; a task's share is of one core
+    uint32_t dt = total - g_prev_total;
+    unsigned count = 0;
+    for (UBaseType_t i = 0; i < n && count < PROFILER_MAX_TASKS; i++)
+    {
+        const TaskStatus_t& s = status[i];
+        ProfilerTask& t = g_snap.tasks[count++];
+        strncpy(t.name, s.pcTaskName, sizeof(t.name) - 1);
+        t.name[sizeof(t.name) - 1] = '\0';
+        t.priority = (uint8_t)s.uxCurrentPriority;
+#if CONFIG_FREERTOS_VTASKLIST_INCLUDE_COREID
+        t.core = s.xCoreID == tskNO_AFFINITY ? -1 : (int8_t)s.xCoreID;
+#else
+        t.core = -1;
+#endif
+        uint32_t used = s.ulRunTimeCounter - prev_counter(s.xTaskNumber, s.ulRunTimeCounter);
+        t.cpu_permille = dt ? (uint16_t)((uint64_t)used * 1000 / dt) : 0;
+        // StackType_t is a byte on ESP-IDF, so the high-water mark is in bytes
+        t.stack_free = (uint32_t)s.usStackHighWaterMark;
+    }
+    g_snap.task_count = count;
+    g_prev_count = 0;
+    for (UBaseType_t i = 0; i < n && g_prev_count < PROFILER_MAX_TASKS; i++)
+    {
+        g_prev[g_prev_count++] = {status[i].xTaskNumber, status[i].ulRunTimeCounter};
+    }
+    g_prev_total = total;
+#endif
+    portEXIT_CRITICAL(&g_lock);
+
+#if PROFILER_HAVE_TASKS
+    free(status);
+#endif
+}
+
+void profiler_get(ProfilerSnapshot* out, uint32_t max_age_ms)
+{
+    portENTER_CRITICAL(&g_lock);
+    int64_t at = g_snap.at_us;
+    portEXIT_CRITICAL(&g_lock);
+    if (at == 0 || esp_timer_get_time() - at > (int64_t)max_age_ms * 1000) profiler_sample();
+
+    portENTER_CRITICAL(&g_lock);
+    *out = g_snap;
+    portEXIT_CRITICAL(&g_lock);
+}
+
+void profiler_log()
+{
+    ProfilerSnapshot& s = g_report;
+    profiler_get(&s, UINT32_MAX);
+    ESP_LOGI(TAG, "%-16s %3s %4s %7s %6s   (CPU over %lu ms)", "task", "pri", "core", "cpu", "stack",
+             (unsigned long)s.interval_ms);
+    for (unsigned i = 0; i < s.task_count; i++)
+    {
+        const ProfilerTask& t = s.tasks[i];
+        ESP_LOGI(TAG, "%-16s %3u %4d %5u.%u%% %6lu", t.name, t.priority, t.core, t.cpu_permille / 10,
+                 t.cpu_permille % 10, (unsigned long)t.stack_free);
+    }
+    ESP_LOGI(TAG, "internal %u free, min %u, largest %u (%u%% fragmented)", (unsigned)s.internal.free,
+             (unsigned)s.internal.min_free, (unsigned)s.internal.largest, s.internal.frag_pct);
+    ESP_LOGI(TAG, "PSRAM    %u free, min %u, largest %u (%u%% fragmented)", (unsigned)s.psram.free,
+             (unsigned)s.psram.min_free, (unsigned)s.psram.largest, s.psram.frag_pct);
+}
+
+void profiler_write_records()
+{
+    ProfilerSnapshot& s = g_report;
+    profiler_get(&s, UINT32_MAX);
+    char text[64];
+    for (unsigned i = 0; i < s.task_count; i++)
+    {
+        const ProfilerTask& t = s.tasks[i];
+        snprintf(text, sizeof(text), "* PROF %s cpu %u.%u%% stack %lu", t.name, t.cpu_permille / 10,
+                 t.cpu_permille % 10, (unsigned long)t.stack_free);
+        logging_note(text);
+    }
+    snprintf(text, sizeof(text), "* HEAP int %uK min %uK blk %uK frag %u%%", (unsigned)(s.internal.free / 1024),
+             (unsigned)(s.internal.min_free / 1024), (unsigned)(s.internal.largest / 1024), s.internal.frag_pct);
+    logging_note(text);
+    if (s.psram.free == 0) return;
+    snprintf(text, sizeof(text), "* HEAP psram %uK min %uK blk %uK frag %u%%", (unsigned)(s.psram.free / 1024),
+             (unsigned)(s.psram.min_free / 1024), (unsigned)(s.psram.largest / 1024), s.psram.frag_pct);
+    logging_note(text);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// How close the device runs to its limits: CPU share and stack headroom per FreeRTOS task (CAN_RX,
+// CAN_Proc, SD_Writer, LVGL, httpd, ...) and free memory per heap capability. A snapshot is taken
+// every PROFILER_PERIOD_S while logging and written into the log as '*' records:
+//
+//   * PROF CAN_Proc cpu 12.3% stack 1844   CPU share of one core since the last snapshot,
+//                                          stack bytes never used (high-water mark)
+//   * HEAP int 143K min 121K blk 96K frag 33%   free, minimum ever free, largest block, 100 - blk/free
+//   * HEAP psram 7910K min 7890K blk 7808K frag 1%
+//
+// Per-task numbers need CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+// (sdkconfig.can-logger); without them only the heap part is filled in.
+#define PROFILER_MAX_TASKS  32
+#define PROFILER_PERIOD_S   60
+
+typedef struct
+{
+    char name[16];
+    uint8_t priority;
+    int8_t core;                // -1: not pinned
+    uint16_t cpu_permille;      // of one core, since the previous snapshot
+    uint32_t stack_free;        // bytes
+} ProfilerTask;
+
+typedef struct
+{
+    size_t free;
+    size_t min_free;
+    size_t largest;
+    unsigned frag_pct;          // 100 - largest * 100 / free
+} ProfilerHeap;
+
+typedef struct
+{
+    int64_t at_us;              // esp_timer time of the snapshot, 0: none yet
+    uint32_t interval_ms;       // CPU shares cover this interval
+    unsigned task_count;
+    ProfilerTask tasks[PROFILER_MAX_TASKS];
+    ProfilerHeap internal;
+    ProfilerHeap psram;
+} ProfilerSnapshot;
+
+// New snapshot; CPU shares are relative to the previous one, whoever took it
+void profiler_sample();
+
+// Last snapshot; one is taken first if it is older than max_age_ms (web requests outside logging)
+void profiler_get(ProfilerSnapshot* out, uint32_t max_age_ms);
+
+// Last snapshot as a table on the console and as records into the log
+void profiler_log();
+void profiler_write_records();
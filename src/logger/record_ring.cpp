@@ -0,0 +1,94 @@
+#include "record_ring.h"
+
+#include <cstring>
+
+#define RECORD_HEADER 2
+
+static void copy_in(RecordRing* r, uint32_t pos, const void* data, uint32_t len)
+{
+    uint32_t at = pos & (r->size - 1);
+    uint32_t first = len < r->size - at ? len : r->size - at;
+    memcpy(r->buf + at, data, first);
+    memcpy(r->buf, (const uint8_t*)data + first, len - first);
+}
+
+static void copy_out(const RecordRing* r, uint32_t pos, void* out, uint32_t len)
+{
+    uint32_t at = pos & (r->size - 1);
+    uint32_t first = len < r->size - at ? len : r->size - at;
+    memcpy(out, r->buf + at, first);
+    memcpy((uint8_t*)out + first, r->buf, len - first);
+}
+
+bool record_ring_init(RecordRing* r, uint8_t* buf, uint32_t size)
+{
+    if (!buf || size < 64 || (size & (size - 1))) return false;
+    r->buf = buf;
+    r->size = size;
+    r->head.store(0);
+    r->tail.store(0);
+    portMUX_INITIALIZE(&r->lock);
+    return true;
+}
+
+bool record_ring_push(RecordRing* r, const void* data, uint16_t len, uint32_t* end)
+{
+    const uint32_t need = RECORD_HEADER + len;
+    portENTER_CRITICAL(&r->lock);
+    uint32_t head = r->head.load(std::memory_order_relaxed);
+    bool fits = r->size - (head - r->tail.load(std::memory_order_acquire)) >= need;
+    if (fits)
+    {
+        copy_in(r, head, &len, RECORD_HEADER);
+        copy_in(r, head + RECORD_HEADER, data, len);
+        r->head.store(head + need, std::memory_order_release);
+        if (end) *end = head + need;
+    }
+    portEXIT_CRITICAL(&r->lock);
+    return fits;
+}
+
+size_t record_ring_take(RecordRing* r, uint8_t* out, size_t max, uint32_t* records)
+{
+    uint32_t tail = r->tail.load(std::memory_order_relaxed);
+    const uint32_t head = r->head.load(std::memory_order_acquire);
+    size_t n = 0;
+    uint32_t count = 0;
+    while (head - tail >= RECORD_HEADER)
+    {
+        uint16_t len;
+        copy_out(r, tail, &len, RECORD_HEADER);
+        if (n + len > max) break;
+        copy_out(r, tail + RECORD_HEADER, out + n, len);
+        n += len;
+        tail += RECORD_HEADER + len;
+        count++;
+    }
+    r->tail.store(tail, std::memory_order_release);
+    if (records) *records += count;
+    return n;
+}
+
+uint16_t record_ring_peek(const RecordRing* r, uint8_t* out, size_t max)
+{
+    const uint32_t tail = r->tail.load(std::memory_order_relaxed);
+    if (r->head.load(std::memory_order_acquire) - tail < RECORD_HEADER) return 0;
+    uint16_t len;
+    copy_out(r, tail, &len, RECORD_HEADER);
+    copy_out(r, tail + RECORD_HEADER, out, len < max ? len : (uint32_t)max);
+    return len;
+}
+
+void record_ring_drop(RecordRing* r)
+{
+    const uint32_t tail = r->tail.load(std::memory_order_relaxed);
+    if (r->head.load(std::memory_order_acquire) - tail < RECORD_HEADER) return;
+    uint16_t len;
+    copy_out(r, tail, &len, RECORD_HEADER);
+    r->tail.store(tail + RECORD_HEADER + len, std::memory_order_release);
+}
+
+uint32_t record_ring_used(const RecordRing* r)
+{
+    return r->head.load(std::memory_order_acquire) - r->tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+
+// Queue of variable-length records in one byte buffer: any number of producers, one consumer.
+// Each record is stored as a 2-byte length and its payload, wrapping around the end of the buffer,
+// so a 37-byte log line takes 39 bytes instead of a fixed-size slot. Producers serialize on a
+// spinlock only for the few bytes they copy; the consumer copies out without it, so taking a whole
+// batch never holds the producers off.
+typedef struct
+{
+    uint8_t* buf;
+    uint32_t size;                  // power of two
+    std::atomic<uint32_t> head;     // bytes ever written; producers, under lock
+    std::atomic<uint32_t> tail;     // bytes ever consumed; consumer
+    portMUX_TYPE lock;
+} RecordRing;
+
+// 'buf' of 'size' bytes (a power of two) is owned by the caller
+bool record_ring_init(RecordRing* r, uint8_t* buf, uint32_t size);
+
+// False if the record does not fit (nothing is written). *end, if given, is the stream position just
+// past the record, to be compared with the consumer's tail.
+bool record_ring_push(RecordRing* r, const void* data, uint16_t len, uint32_t* end);
+
+// Consumer: move whole records, payloads only and back to back, into out while they fit in max
+// bytes; returns the bytes copied and adds the record count to *records if given
+size_t record_ring_take(RecordRing* r, uint8_t* out, size_t max, uint32_t* records);
+
+// Consumer: copy the oldest record (at most max bytes) without taking it; its length, 0 if empty
+uint16_t record_ring_peek(const RecordRing* r, uint8_t* out, size_t max);
+
+// Consumer: drop the oldest record
+void record_ring_drop(RecordRing* r);
+
+// Bytes in use including the length headers
+uint32_t record_ring_used(const RecordRing* r);
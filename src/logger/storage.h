@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sys/stat.h>
+
+// Log storage backend: FATFS on the SD card on the target, a plain directory on the host build.
+// Files are handled with stdio; the backend owns the root path, free space and the write/sync calls
+// so it can be measured or slowed down off-target.
+
+// Directory the logs live in (no trailing slash)
+const char* storage_root();
+
+bool storage_info(uint64_t* total_bytes, uint64_t* free_bytes);
+
+size_t storage_write(FILE* f, const void* data, size_t len);
+
+// Preferred write size granularity in bytes (the file system's cluster size)
+size_t storage_write_unit();
+
+// Flush stdio buffers and make the data durable
+void storage_sync(FILE* f);
+
+// FAT files grow up to 4 GB, but off_t (and long) are signed 32 bits on the target. These read sizes
+// as unsigned and seek only to offsets the C library can reach; past that storage_seek() fails.
+inline uint64_t storage_size(const struct stat& st)
+{
+    return sizeof(st.st_size) < sizeof(uint64_t) ? (uint64_t)(uint32_t)st.st_size : (uint64_t)st.st_size;
+}
+
+inline bool storage_file_size(FILE* f, uint64_t* size)
+{
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0) return false;
+    *size = storage_size(st);
+    return true;
+}
+
+inline bool storage_seek(FILE* f, uint64_t pos)
+{
+    const uint64_t max = sizeof(off_t) < sizeof(uint64_t) ? (1ULL << (8 * sizeof(off_t) - 1)) - 1 : INT64_MAX;
+    return pos <= max && fseeko(f, (off_t)pos, SEEK_SET) == 0;
+}
@@ -0,0 +1,50 @@
+#include "storage.h"
+
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+#include "ff.h"
+#include "common.h"
+
+#define DEFAULT_WRITE_UNIT (32 * 1024)
+
+const char* storage_root()
+{
+    return SD_MOUNT_POINT;
+}
+
+bool storage_info(uint64_t* total_bytes, uint64_t* free_bytes)
+{
+    esp_err_t err = esp_vfs_fat_info(SD_MOUNT_POINT, total_bytes, free_bytes);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW("SD", "esp_vfs_fat_info failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+size_t storage_write(FILE* f, const void* data, size_t len)
+{
+    return fwrite(data, 1, len, f);
+}
+
+size_t storage_write_unit()
+{
+    // The card is the first (and only) FATFS drive
+    FATFS* fs = nullptr;
+    DWORD free_clusters = 0;
+    if (f_getfree("0:", &free_clusters, &fs) != FR_OK || !fs) return DEFAULT_WRITE_UNIT;
+#if FF_MAX_SS != FF_MIN_SS
+    return (size_t)fs->csize * fs->ssize;
+#else
+    return (size_t)fs->csize * FF_MAX_SS;
+#endif
+}
+
+void storage_sync(FILE* f)
+{
+    fflush(f);
+    fsync(fileno(f));
+}
@@ -0,0 +1,188 @@
+#include "tar_stream.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "esp_rom_crc.h"
+#include "mem_budget.h"
+#include "rom/miniz.h"
+
+#define DEFLATE_FLAGS   (1 | TDEFL_GREEDY_PARSING_FLAG)     // one probe, greedy (zlib level 1); raw deflate
+
+typedef struct
+{
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+} TarHeader;
+
+static_assert(sizeof(TarHeader) == TAR_BLOCK, "TarHeader must be one block");
+
+static tdefl_compressor* g_deflate = nullptr;
+static std::atomic<bool> g_deflate_busy{false};
+
+// -----------------------------
+// Output
+// -----------------------------
+static mz_bool put_compressed(const void* data, int len, void* user)
+{
+    TarStream* ts = (TarStream*)user;
+    if (!ts->started)
+    {
+        // gzip member header: deflate, no name, no mtime, fastest, unknown OS
+        static const uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 4, 0xff};
+        ts->ok = ts->ok && ts->write(ts->ctx, header, sizeof(header));
+        ts->started = true;
+    }
+    ts->ok = ts->ok && ts->write(ts->ctx, data, (size_t)len);
+    return ts->ok;
+}
+
+static void flush(TarStream* ts)
+{
+    if (ts->used > 0 && ts->ok)
+    {
+        if (ts->gzip)
+        {
+            ts->crc = esp_rom_crc32_le(ts->crc, (const uint8_t*)ts->buf, ts->used);
+            ts->in_bytes += ts->used;
+            if (tdefl_compress_buffer(g_deflate, ts->buf, ts->used, TDEFL_NO_FLUSH) != TDEFL_STATUS_OKAY)
+            {
+                ts->ok = false;
+            }
+        }
+        else
+        {
+            ts->ok = ts->write(ts->ctx, ts->buf, ts->used);
+        }
+    }
+    ts->used = 0;
+}
+
+// data == nullptr: zeros
+static void put(TarStream* ts, const void* data, size_t len)
+{
+    const char* p = (const char*)data;
+    while (len > 0)
+    {
+        size_t n = ts->size - ts->used;
+        if (n > len) n = len;
+        if (p)
+        {
+            memcpy(ts->buf + ts->used, p, n);
+            p += n;
+        }
+        else
+        {
+            memset(ts->buf + ts->used, 0, n);
+        }
+        ts->used += n;
+        len -= n;
+        if (ts->used == ts->size) flush(ts);
+    }
+}
+
+// width - 1 zero-padded octal digits and a NUL
+static void octal(char* field, size_t width, uint64_t v)
+{
+    snprintf(field, width, "%0*llo", (int)(width - 1), (unsigned long long)v);
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool tar_stream_begin(TarStream* ts, bool (*write)(void* ctx, const void* data, size_t len), void* ctx,
+                      char* buf, size_t size, bool gzip)
+{
+    *ts = {write, ctx, buf, size, 0, gzip, 0, 0, false, true};
+    if (!gzip) return true;
+
+    bool expected = false;
+    if (!g_deflate_busy.compare_exchange_strong(expected, true)) return false;
+    if (!g_deflate)
+    {
+        g_deflate = (tdefl_compressor*)mem_budget_alloc("archive: deflate state", sizeof(tdefl_compressor),
+                                                        MEM_PSRAM_ONLY);
+    }
+    if (!g_deflate)
+    {
+        g_deflate_busy = false;
+        return false;
+    }
+    // The gzip header goes out with the first compressed bytes
+    tdefl_init(g_deflate, put_compressed, ts, DEFLATE_FLAGS);
+    return true;
+}
+
+bool tar_stream_file(TarStream* ts, const char* name, FILE* f, uint64_t size, int64_t mtime)
+{
+    TarHeader h;
+    memset(&h, 0, sizeof(h));
+    strncpy(h.name, name, sizeof(h.name) - 1);
+    octal(h.mode, sizeof(h.mode), 0644);
+    octal(h.uid, sizeof(h.uid), 0);
+    octal(h.gid, sizeof(h.gid), 0);
+    octal(h.size, sizeof(h.size), size);
+    octal(h.mtime, sizeof(h.mtime), mtime > 0 ? (uint64_t)mtime : 0);
+    h.typeflag = '0';
+    memcpy(h.magic, "ustar", 6);
+    memcpy(h.version, "00", 2);
+    // Checksum over the header with the checksum field as spaces: six digits, NUL, space
+    memset(h.chksum, ' ', sizeof(h.chksum));
+    unsigned sum = 0;
+    for (size_t i = 0; i < sizeof(h); i++) sum += ((const uint8_t*)&h)[i];
+    snprintf(h.chksum, 7, "%06o", sum);
+    h.chksum[7] = ' ';
+    put(ts, &h, sizeof(h));
+
+    // Read straight into the stream buffer
+    uint64_t left = size;
+    while (left > 0 && ts->ok)
+    {
+        size_t want = ts->size - ts->used;
+        if (want > left) want = (size_t)left;
+        size_t n = f ? fread(ts->buf + ts->used, 1, want, f) : 0;
+        if (n < want)
+        {
+            memset(ts->buf + ts->used + n, 0, want - n);
+            f = nullptr;
+        }
+        ts->used += want;
+        left -= want;
+        if (ts->used == ts->size) flush(ts);
+    }
+    put(ts, nullptr, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK);
+    return ts->ok;
+}
+
+bool tar_stream_end(TarStream* ts)
+{
+    put(ts, nullptr, 2 * TAR_BLOCK);
+    flush(ts);
+    if (!ts->gzip) return ts->ok;
+
+    if (ts->ok && tdefl_compress_buffer(g_deflate, nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE) ts->ok = false;
+    uint8_t trailer[8];
+    for (int i = 0; i < 4; i++)
+    {
+        trailer[i] = (uint8_t)(ts->crc >> (8 * i));
+        trailer[4 + i] = (uint8_t)(ts->in_bytes >> (8 * i));
+    }
+    if (ts->ok) ts->ok = ts->write(ts->ctx, trailer, sizeof(trailer));
+    g_deflate_busy = false;
+    return ts->ok;
+}
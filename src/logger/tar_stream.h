@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+// POSIX ustar archive written front to back into a sink (/archive). Each header is built from the
+// file size taken when the file is added, so nothing is staged on the card: the archive is the
+// headers, the file data and the end-of-archive blocks. Headers, data and padding are packed into
+// the caller's buffer and leave as full chunks.
+//
+// With gzip the stream goes through the ROM deflate at its fastest setting and a gzip wrapper. The
+// compressor state (~160 KB) sits in PSRAM and is shared: one compressed archive at a time.
+#define TAR_BLOCK   512
+
+typedef struct
+{
+    bool (*write)(void* ctx, const void* data, size_t len);
+    void* ctx;
+    char* buf;              // caller's buffer, at least TAR_BLOCK bytes
+    size_t size;
+    size_t used;
+    bool gzip;
+    uint32_t crc;           // of the uncompressed stream, for the gzip trailer
+    uint32_t in_bytes;      // mod 2^32, as in the gzip trailer
+    bool started;           // gzip header sent
+    bool ok;                // false once the sink failed; later writes are dropped
+} TarStream;
+
+// False when gzip was asked for and the compressor is in use or could not be allocated. Sends nothing,
+// so the caller can still answer with an error or set its response headers.
+bool tar_stream_begin(TarStream* ts, bool (*write)(void* ctx, const void* data, size_t len), void* ctx,
+                      char* buf, size_t size, bool gzip);
+
+// Header plus exactly 'size' bytes of the open file (zeros if it turns out shorter, so the header
+// stays true while the file grows), padded to a block. False if the sink failed.
+bool tar_stream_file(TarStream* ts, const char* name, FILE* f, uint64_t size, int64_t mtime);
+
+// End-of-archive blocks and the gzip trailer; releases the compressor. Also after a failure.
+bool tar_stream_end(TarStream* ts);
@@ -0,0 +1,81 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mem_budget.h"
+
+static const char* TAG = "TRACE";
+
+static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+static_assert(sizeof(TraceEvent) == 16, "trace event size");
+
+// -----------------------------
+// State
+// -----------------------------
+static TraceEvent* g_events = nullptr;
+static std::atomic<uint32_t> g_every{0};   // 0: tracing off
+static std::atomic<uint32_t> g_next{0};    // events ever claimed
+static uint32_t g_frames = 0;              // CAN_RX only
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool trace_start(uint32_t every)
+{
+    g_every.store(0);
+    if (every == 0) return true;
+    if (!g_events)
+    {
+        g_events = (TraceEvent*)mem_budget_alloc("trace: event ring", TRACE_EVENTS * sizeof(TraceEvent),
+                                                 MEM_PSRAM_ONLY);
+        if (!g_events) return false;
+    }
+    // Events still being written by a previous run land before the reset or are overwritten
+    vTaskDelay(1);
+    g_next.store(0);
+    g_frames = 0;
+    g_every.store(every);
+    ESP_LOGI(TAG, "tracing every %lu. frame", (unsigned long)every);
+    return true;
+}
+
+bool trace_sample()
+{
+    uint32_t every = g_every.load(std::memory_order_relaxed);
+    return every && g_frames++ % every == 0;
+}
+
+void trace_event(TraceStage stage, uint32_t frame, uint32_t pos)
+{
+    if (!g_every.load(std::memory_order_relaxed)) return;
+    TraceEvent& e = g_events[g_next.fetch_add(1, std::memory_order_relaxed) & (TRACE_EVENTS - 1)];
+    e.t_us = (uint32_t)esp_timer_get_time();
+    e.frame = frame;
+    e.pos = pos;
+    e.stage = (uint8_t)stage;
+}
+
+bool trace_dump(bool (*write)(void* ctx, const void* data, size_t len), void* ctx)
+{
+    g_every.store(0);
+    vTaskDelay(1);  // let writers that already claimed a slot finish it
+
+    uint32_t next = g_next.load();
+    TraceDumpHeader h;
+    memcpy(h.magic, TRACE_MAGIC, sizeof(h.magic));
+    h.version = TRACE_VERSION;
+    h.count = g_events ? (next < TRACE_EVENTS ? next : TRACE_EVENTS) : 0;
+    if (!write(ctx, &h, sizeof(h))) return false;
+    if (h.count == 0) return true;
+
+    // Oldest first: from the slot after the newest event to the end, then from the start
+    uint32_t first = (next - h.count) & (TRACE_EVENTS - 1);
+    uint32_t run = h.count < TRACE_EVENTS - first ? h.count : TRACE_EVENTS - first;
+    if (!write(ctx, g_events + first, run * sizeof(TraceEvent))) return false;
+    return run == h.count || write(ctx, g_events, (h.count - run) * sizeof(TraceEvent));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Optional latency tracing: every Nth captured frame is tagged in CAN_RX and timestamped at each
+// pipeline stage into a ring of TRACE_EVENTS events in PSRAM. Frames are identified by the low 32
+// bits of their log timestamp, which CAN_RX keeps unique. The SD stages work on byte ranges, not on
+// frames: a frame's SDQ_PUSH carries the sdQueue position just past its line, and SDQ_POP, WRITE and
+// SYNC carry the position up to which lines have been taken, written or made durable. The host tool
+// (test/src/canlog_trace.cpp) matches them up and writes a Chrome/Perfetto trace.
+//
+// Writers claim slots with one atomic increment and never wait; when the ring wraps the oldest
+// events are overwritten.
+#define TRACE_EVENTS        (64 * 1024)     // 1 MB
+#define TRACE_MAGIC         "CANTRACE"
+#define TRACE_VERSION       1
+
+typedef enum
+{
+    TRACE_RX = 0,       // taken from the driver RX queue (CAN_RX)
+    TRACE_CANQ_PUSH,    // in canQueue
+    TRACE_CANQ_POP,     // out of canQueue (CAN_Proc)
+    TRACE_FORMAT,       // log line formatted
+    TRACE_SDQ_PUSH,     // in sdQueue; pos: end of the line
+    TRACE_SDQ_POP,      // SD_Writer copied lines into the batch buffer; pos: end of what it took
+    TRACE_WRITE,        // storage_write returned; pos: end of what it wrote
+    TRACE_SYNC,         // storage_sync returned; pos: end of what was written before it started
+    TRACE_STAGES
+} TraceStage;
+
+typedef struct
+{
+    uint32_t t_us;      // esp_timer_get_time(), low 32 bits
+    uint32_t frame;     // frame stages: low 32 bits of the log timestamp
+    uint32_t pos;       // SD stages: sdQueue byte position
+    uint8_t stage;
+    uint8_t reserved[3];
+} TraceEvent;
+
+// Dump: "CANTRACE", uint32 version, uint32 event count, then the events oldest first
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+} TraceDumpHeader;
+
+// Sample every 'every'-th frame from now on (0 stops); clears the ring. False without PSRAM.
+bool trace_start(uint32_t every);
+
+// CAN_RX: whether to tag this frame
+bool trace_sample();
+
+// No-op while tracing is off
+void trace_event(TraceStage stage, uint32_t frame, uint32_t pos);
+
+// Stops tracing and hands the dump out in pieces; false if 'write' failed
+bool trace_dump(bool (*write)(void* ctx, const void* data, size_t len), void* ctx);
@@ -0,0 +1,405 @@
+#include "trigger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "logging.h"
+#include "mem_budget.h"
+#include "record_ring.h"
+
+#define RECORD_TIME     8       // ring record: int64 boot time, then the line
+#define RECORD_MAX      (RECORD_TIME + 64)
+
+static const char* TAG = "TRIGGER";
+
+// -----------------------------
+// State (CAN_Proc only, unless noted)
+// -----------------------------
+typedef struct
+{
+    int64_t from_us;
+    int64_t until_us;
+} Window;
+
+static TriggerConfig g_cfg;
+static RecordRing g_ring;
+static bool g_enabled = false;
+static int64_t g_last_us[TRIGGER_MAX_CONDITIONS];  // TRIG_RATE: previous frame of the ID, 0: none
+
+// Committed windows in time order; the first is the one being drained
+static Window g_win[TRIGGER_MAX_WINDOWS];
+static unsigned g_win_first = 0;
+static unsigned g_win_count = 0;
+
+static std::atomic<bool> g_error_pending{false};  // set by trigger_on_error
+static TriggerStatus g_status = {};
+
+// Copy of g_status and the end of the last window for trigger_get_status (any task)
+static portMUX_TYPE g_lock = portMUX_INITIALIZER_UNLOCKED;
+static TriggerStatus g_shared = {};
+static int64_t g_shared_until = 0;      // end of the last committed window, 0: none
+
+// -----------------------------
+// Configuration
+// -----------------------------
+// "0x123" or "0x123/0x7F0"
+static bool parse_masked(const char* s, uint32_t* value, uint32_t* mask, uint32_t full)
+{
+    char* end;
+    *value = (uint32_t)strtoul(s, &end, 0);
+    *mask = full;
+    if (end == s) return false;
+    if (*end == '/')
+    {
+        const char* m = end + 1;
+        *mask = (uint32_t)strtoul(m, &end, 0);
+        if (end == m) return false;
+    }
+    return *end == '\0';
+}
+
+static bool valid_op(const char* op)
+{
+    static const char* ops[] = {"=", "!=", ">", "<", ">=", "<=", "&"};
+    for (const char* o : ops)
+    {
+        if (strcmp(op, o) == 0) return true;
+    }
+    return false;
+}
+
+static bool parse_line(char* line, TriggerConfig* out)
+{
+    char* save;
+    char* kw = strtok_r(line, " \t", &save);
+    if (!kw) return true;
+    char* a[4] = {};
+    int n = 0;
+    while (n < 4 && (a[n] = strtok_r(nullptr, " \t", &save)) != nullptr) n++;
+    if (strtok_r(nullptr, " \t", &save)) return false;
+
+    if (strcmp(kw, "pre") == 0 || strcmp(kw, "post") == 0)
+    {
+        if (n != 1) return false;
+        char* end;
+        double s = strtod(a[0], &end);
+        if (*end || s < 0 || s > 3600) return false;
+        (kw[1] == 'r' ? out->pre_ms : out->post_ms) = (uint32_t)(s * 1000 + 0.5);
+        return true;
+    }
+
+    if (out->count == TRIGGER_MAX_CONDITIONS) return false;
+    TriggerCond c = {};
+    c.id_mask = 0x1FFFFFFF;
+    c.value_mask = 0xFF;
+    if (strcmp(kw, "error") == 0 && n == 0)
+    {
+        c.kind = TRIG_ERROR;
+    }
+    else if (strcmp(kw, "id") == 0 && n == 1)
+    {
+        c.kind = TRIG_ID;
+        if (!parse_masked(a[0], &c.id, &c.id_mask, 0x1FFFFFFF)) return false;
+    }
+    else if (strcmp(kw, "data") == 0 && n == 4)
+    {
+        c.kind = TRIG_DATA;
+        uint32_t value, mask;
+        char* end;
+        c.byte = (uint8_t)strtoul(a[1], &end, 0);
+        if (*end || c.byte > 7 || strlen(a[2]) > 2 || !valid_op(a[2])) return false;
+        strcpy(c.op, a[2]);
+        if (!parse_masked(a[0], &c.id, &c.id_mask, 0x1FFFFFFF) || !parse_masked(a[3], &value, &mask, 0xFF) ||
+            value > 0xFF || mask > 0xFF)
+        {
+            return false;
+        }
+        c.value = (uint8_t)value;
+        c.value_mask = (uint8_t)mask;
+    }
+    else if (strcmp(kw, "rate") == 0 && n == 3)
+    {
+        c.kind = TRIG_RATE;
+        char* end1;
+        char* end2;
+        c.min_gap_ms = (uint32_t)strtoul(a[1], &end1, 0);
+        c.max_gap_ms = (uint32_t)strtoul(a[2], &end2, 0);
+        if (*end1 || *end2 || !parse_masked(a[0], &c.id, &c.id_mask, 0x1FFFFFFF)) return false;
+        if (c.min_gap_ms == 0 && c.max_gap_ms == 0) return false;
+    }
+    else
+    {
+        return false;
+    }
+    out->cond[out->count++] = c;
+    return true;
+}
+
+bool trigger_parse(const char* text, TriggerConfig* out, char* err, size_t err_size)
+{
+    memset(out, 0, sizeof(*out));
+    out->pre_ms = 5000;
+    out->post_ms = 10000;
+    char line[96];
+    int line_no = 1;
+    const char* p = text;
+    while (*p)
+    {
+        size_t len = strcspn(p, "\n;");
+        size_t copy = std::min(len, sizeof(line) - 1);
+        memcpy(line, p, copy);
+        line[copy] = '\0';
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* cr = strchr(line, '\r');
+        if (cr) *cr = '\0';
+        if (len >= sizeof(line) || !parse_line(line, out))
+        {
+            snprintf(err, err_size, "line %d: %.*s", line_no, (int)std::min<size_t>(len, 40), p);
+            return false;
+        }
+        if (p[len] == '\n') line_no++;
+        p += len + (p[len] ? 1 : 0);
+    }
+    if (out->count == 0)
+    {
+        snprintf(err, err_size, "no trigger condition");
+        return false;
+    }
+    return true;
+}
+
+// -----------------------------
+// Matching
+// -----------------------------
+static bool compare(const char* op, uint8_t v, uint8_t ref)
+{
+    switch (op[0])
+    {
+    case '=': return v == ref;
+    case '!': return v != ref;
+    case '&': return (v & ref) != 0;
+    case '>': return op[1] ? v >= ref : v > ref;
+    case '<': return op[1] ? v <= ref : v < ref;
+    default: return false;
+    }
+}
+
+// Index of the first matching condition, -1 if none; *gap_ms is set for TRIG_RATE
+static int match(uint32_t id, uint8_t dlc, const uint8_t* data, int64_t now, uint32_t* gap_ms)
+{
+    int hit = -1;
+    for (unsigned i = 0; i < g_cfg.count; i++)
+    {
+        const TriggerCond& c = g_cfg.cond[i];
+        if (c.kind == TRIG_ERROR || (id & c.id_mask) != (c.id & c.id_mask)) continue;
+        bool m = false;
+        if (c.kind == TRIG_ID)
+        {
+            m = true;
+        }
+        else if (c.kind == TRIG_DATA)
+        {
+            m = c.byte < dlc && compare(c.op, data[c.byte] & c.value_mask, c.value);
+        }
+        else
+        {
+            // Every rate condition keeps its own previous frame, so it is evaluated even after a hit
+            int64_t last = g_last_us[i];
+            g_last_us[i] = now;
+            if (last)
+            {
+                uint32_t gap = (uint32_t)std::min<int64_t>((now - last) / 1000, UINT32_MAX);
+                m = (c.min_gap_ms && gap < c.min_gap_ms) || (c.max_gap_ms && gap > c.max_gap_ms);
+                if (m && hit < 0) *gap_ms = gap;
+            }
+        }
+        if (m && hit < 0) hit = (int)i;
+    }
+    return hit;
+}
+
+// -----------------------------
+// Pre-trigger ring and windows
+// -----------------------------
+static bool committed(int64_t t)
+{
+    for (unsigned k = 0; k < g_win_count; k++)
+    {
+        const Window& w = g_win[(g_win_first + k) % TRIGGER_MAX_WINDOWS];
+        if (t >= w.from_us && t <= w.until_us) return true;
+    }
+    return false;
+}
+
+// Oldest lines make room; returns how many of them were committed
+static unsigned buffer(int64_t t, const char* line, uint16_t len)
+{
+    uint8_t rec[RECORD_MAX];
+    len = std::min<uint16_t>(len, RECORD_MAX - RECORD_TIME);
+    memcpy(rec, &t, RECORD_TIME);
+    memcpy(rec + RECORD_TIME, line, len);
+    unsigned lost = 0;
+    while (!record_ring_push(&g_ring, rec, RECORD_TIME + len, nullptr))
+    {
+        int64_t t0;
+        if (record_ring_peek(&g_ring, (uint8_t*)&t0, RECORD_TIME) < RECORD_TIME) break;
+        if (committed(t0)) lost++;
+        record_ring_drop(&g_ring);
+    }
+    g_status.lost += lost;
+    return lost;
+}
+
+static void fire(int64_t now, const char* what)
+{
+    g_status.triggers++;
+    const int64_t from = now - (int64_t)g_cfg.pre_ms * 1000;
+    const int64_t until = now + (int64_t)g_cfg.post_ms * 1000;
+    Window* last = g_win_count ? &g_win[(g_win_first + g_win_count - 1) % TRIGGER_MAX_WINDOWS] : nullptr;
+    if (last && (from <= last->until_us || g_win_count == TRIGGER_MAX_WINDOWS))
+    {
+        // Overlapping (or no slot left): one longer window
+        last->until_us = std::max(last->until_us, until);
+    }
+    else
+    {
+        g_win[(g_win_first + g_win_count++) % TRIGGER_MAX_WINDOWS] = {from, until};
+        g_status.windows++;
+    }
+    char text[64];
+    int n = snprintf(text, sizeof(text), "* TRIGGER %s\n", what);
+    buffer(now, text, (uint16_t)std::min<int>(n, sizeof(text) - 1));
+}
+
+static void publish()
+{
+    const int64_t until = g_win_count ? g_win[(g_win_first + g_win_count - 1) % TRIGGER_MAX_WINDOWS].until_us : 0;
+    const uint32_t used = record_ring_used(&g_ring);
+    portENTER_CRITICAL(&g_lock);
+    g_shared = g_status;
+    g_shared.buffered_bytes = used;
+    g_shared_until = until;
+    portEXIT_CRITICAL(&g_lock);
+}
+
+static void describe(const TriggerCond& c, uint32_t gap_ms, char* out, size_t size)
+{
+    switch (c.kind)
+    {
+    case TRIG_ID: snprintf(out, size, "id %03lX", (unsigned long)c.id); break;
+    case TRIG_DATA:
+        snprintf(out, size, "data %03lX %u %s %02X", (unsigned long)c.id, c.byte, c.op, c.value);
+        break;
+    case TRIG_RATE: snprintf(out, size, "rate %03lX gap %lu ms", (unsigned long)c.id, (unsigned long)gap_ms); break;
+    default: snprintf(out, size, "error"); break;
+    }
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool trigger_init(const TriggerConfig* cfg)
+{
+    if (!g_ring.buf)
+    {
+        uint8_t* buf = (uint8_t*)mem_budget_alloc("trigger: pre-trigger ring", TRIGGER_RING_BYTES, MEM_PSRAM_ONLY);
+        if (!buf || !record_ring_init(&g_ring, buf, TRIGGER_RING_BYTES))
+        {
+            ESP_LOGE(TAG, "no PSRAM for the pre-trigger ring; logging every frame");
+            return false;
+        }
+    }
+    g_cfg = *cfg;
+    memset(g_last_us, 0, sizeof(g_last_us));
+    g_win_first = g_win_count = 0;
+    g_status = {};
+    g_status.enabled = g_enabled = true;
+    publish();
+    ESP_LOGI(TAG, "%u conditions, %lu ms before / %lu ms after", g_cfg.count, (unsigned long)g_cfg.pre_ms,
+             (unsigned long)g_cfg.post_ms);
+    return true;
+}
+
+bool trigger_enabled()
+{
+    return g_enabled;
+}
+
+unsigned trigger_on_line(uint32_t id, uint8_t dlc, const uint8_t* data, const char* line, uint16_t len)
+{
+    const int64_t now = esp_timer_get_time();
+    uint32_t gap_ms = 0;
+    // Error frames only meet TRIG_ERROR (trigger_on_error): the ID masks would drop CAN_ERR_FLAG
+    int hit = id & CAN_ERR_FLAG ? -1 : match(id, dlc, data, now, &gap_ms);
+    char what[40];
+    if (hit >= 0)
+    {
+        describe(g_cfg.cond[hit], gap_ms, what, sizeof(what));
+        fire(now, what);
+    }
+    else if (g_error_pending.exchange(false))
+    {
+        fire(now, "error");
+    }
+    unsigned lost = buffer(now, line, len);
+    publish();
+    return lost;
+}
+
+bool trigger_drain(bool (*sink)(const char* line, uint16_t len))
+{
+    uint8_t rec[RECORD_MAX];
+    bool waiting = false;
+    while (g_win_count && !waiting)
+    {
+        uint16_t len = record_ring_peek(&g_ring, rec, sizeof(rec));
+        if (len < RECORD_TIME) break;
+        int64_t t;
+        memcpy(&t, rec, RECORD_TIME);
+        const Window& w = g_win[g_win_first];
+        if (t > w.until_us)
+        {
+            // Lines are in time order: this window is complete
+            g_win_first = (g_win_first + 1) % TRIGGER_MAX_WINDOWS;
+            g_win_count--;
+            continue;
+        }
+        if (t >= w.from_us)
+        {
+            if (!sink((const char*)rec + RECORD_TIME, len - RECORD_TIME))
+            {
+                waiting = true;
+                break;
+            }
+            g_status.committed++;
+        }
+        record_ring_drop(&g_ring);
+    }
+    publish();
+    return waiting;
+}
+
+void trigger_on_error()
+{
+    if (!g_enabled) return;
+    for (unsigned i = 0; i < g_cfg.count; i++)
+    {
+        if (g_cfg.cond[i].kind == TRIG_ERROR) g_error_pending = true;
+    }
+}
+
+void trigger_get_status(TriggerStatus* out)
+{
+    portENTER_CRITICAL(&g_lock);
+    *out = g_shared;
+    const int64_t until = g_shared_until;
+    portEXIT_CRITICAL(&g_lock);
+    out->in_window = out->enabled && until && esp_timer_get_time() <= until;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Trigger capture: instead of every frame, only the seconds around interesting events go to the card.
+// All formatted lines pass through a pre-trigger ring in PSRAM (TRIGGER_RING_BYTES); when a condition
+// matches, the lines from 'pre' seconds before until 'post' seconds after it are committed to sdQueue,
+// preceded by a "* TRIGGER <condition>" record. A trigger within a running window (or whose pre-trigger
+// part reaches into it) extends that window instead of starting a new one.
+//
+// Enabled by a TRIGGER.CFG in the log directory, one setting or condition per line ('#' comments,
+// ';' also separates):
+//
+//   pre 5                          seconds before a trigger (default 5)
+//   post 10                        seconds after the last trigger of a window (default 10)
+//   id 0x123[/0x7F0]               any frame with a matching ID (under mask)
+//   data 0x123[/MASK] 2 > 0x80     payload byte 2 of ID 0x123 compared (= != > < >= <=) with a value;
+//   data 0x123 0 & 0x04            '&': any of these bits set
+//   error                          controller error events (the error frames bus_health writes)
+//   rate 0x123 5 50                gap between two frames of ID 0x123 below 5 ms or above 50 ms (0: no bound)
+//
+// Windows are measured on the monotonic boot clock, so clock corrections do not cut them. Error frames
+// pass through the ring like received frames, so each window is written in time order; '*' status
+// records carry no timestamp and are written as they happen. Lines that overflow the pre-trigger ring while they wait for sdQueue inside a window are
+// counted as sdQueue drops.
+#define TRIGGER_RING_BYTES      (2 * 1024 * 1024)   // ~9 s of 100 % bus load at 500 kbit/s
+#define TRIGGER_MAX_CONDITIONS  16
+#define TRIGGER_MAX_WINDOWS     8                   // committed windows still waiting for sdQueue
+
+typedef enum
+{
+    TRIG_ID = 0,
+    TRIG_DATA,
+    TRIG_ERROR,
+    TRIG_RATE,
+} TriggerKind;
+
+typedef struct
+{
+    TriggerKind kind;
+    uint32_t id;
+    uint32_t id_mask;
+    uint8_t byte;           // TRIG_DATA
+    char op[3];             // TRIG_DATA: "=", "!=", ">", "<", ">=", "<=", "&"
+    uint8_t value;
+    uint8_t value_mask;
+    uint32_t min_gap_ms;    // TRIG_RATE
+    uint32_t max_gap_ms;
+} TriggerCond;
+
+typedef struct
+{
+    uint32_t pre_ms;
+    uint32_t post_ms;
+    unsigned count;
+    TriggerCond cond[TRIGGER_MAX_CONDITIONS];
+} TriggerConfig;
+
+typedef struct
+{
+    bool enabled;
+    bool in_window;             // lines are being committed
+    unsigned long triggers;     // conditions matched
+    unsigned long windows;      // after coalescing
+    unsigned long committed;    // lines handed to sdQueue
+    unsigned long lost;         // committed lines that overflowed the ring
+    uint32_t buffered_bytes;    // in the pre-trigger ring
+} TriggerStatus;
+
+// Parses a configuration (see above); on failure err names the offending line
+bool trigger_parse(const char* text, TriggerConfig* out, char* err, size_t err_size);
+
+// Allocates the ring and arms the conditions; false (trigger mode off) without PSRAM
+bool trigger_init(const TriggerConfig* cfg);
+bool trigger_enabled();
+
+// CAN_Proc: match a frame and buffer its formatted line (with newline); returns committed lines
+// dropped to make room
+unsigned trigger_on_line(uint32_t id, uint8_t dlc, const uint8_t* data, const char* line, uint16_t len);
+
+// CAN_Proc: move committed lines on while sink takes them; true if some are still waiting
+bool trigger_drain(bool (*sink)(const char* line, uint16_t len));
+
+// CAN_Proc: the next line is a controller error frame (TRIG_ERROR)
+void trigger_on_error();
+
+// Any task: a snapshot CAN_Proc publishes after each line and drain
+void trigger_get_status(TriggerStatus* out);
@@ -0,0 +1,122 @@
+#include "web_async.h"
+
+#include <cstdio>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "mem_budget.h"
+
+static const char* TAG = "WEB_ASYNC";
+
+#define WEB_ASYNC_PRIORITY  2       // below the capture tasks when the monitor runs while logging
+#define WEB_ASYNC_STACK     6144
+
+typedef struct
+{
+    httpd_req_t* req;               // async copy, owned by the worker until complete
+    esp_err_t (*handler)(httpd_req_t* req);
+} AsyncJob;
+
+typedef struct
+{
+    TaskHandle_t task;
+    char* buf;
+    size_t size;
+} Worker;
+
+static QueueHandle_t g_jobs = nullptr;
+static Worker g_workers[WEB_ASYNC_WORKERS];
+
+// -----------------------------
+// Workers
+// -----------------------------
+[[noreturn]] static void worker_task(void* arg)
+{
+    AsyncJob job;
+    while (true)
+    {
+        if (xQueueReceive(g_jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+        job.handler(job.req);
+        httpd_req_async_handler_complete(job.req);
+    }
+}
+
+// -----------------------------
+// Public API
+// -----------------------------
+bool web_async_start()
+{
+    if (g_jobs) return true;
+    g_jobs = xQueueCreate(WEB_ASYNC_QUEUE_LEN, sizeof(AsyncJob));
+    if (!g_jobs) return false;
+    for (int i = 0; i < WEB_ASYNC_WORKERS; i++)
+    {
+        Worker& w = g_workers[i];
+        w.size = WEB_ASYNC_BUF_BYTES;
+        w.buf = (char*)mem_budget_alloc("web: transfer buffer", w.size, MEM_PSRAM_ONLY);
+        if (!w.buf)
+        {
+            w.size = WEB_ASYNC_BUF_MIN_BYTES;
+            w.buf = (char*)mem_budget_alloc("web: transfer buffer", w.size, MEM_INTERNAL);
+        }
+        if (!w.buf)
+        {
+            ESP_LOGW(TAG, "transfer buffer allocation failed; %d workers", i);
+            break;
+        }
+        char name[12];
+        snprintf(name, sizeof(name), "HTTP_W%d", i);
+        xTaskCreate(worker_task, name, WEB_ASYNC_STACK, nullptr, WEB_ASYNC_PRIORITY, &w.task);
+    }
+    if (!g_workers[0].task)
+    {
+        vQueueDelete(g_jobs);
+        g_jobs = nullptr;
+        return false;
+    }
+    return true;
+}
+
+static bool on_worker()
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (const Worker& w : g_workers)
+    {
+        if (w.task && w.task == self) return true;
+    }
+    return false;
+}
+
+bool web_async_offload(httpd_req_t* req, esp_err_t (*handler)(httpd_req_t* req))
+{
+    if (!g_jobs || on_worker()) return false;
+
+    AsyncJob job = {nullptr, handler};
+    if (uxQueueSpacesAvailable(g_jobs) == 0 || httpd_req_async_handler_begin(req, &job.req) != ESP_OK)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        httpd_resp_sendstr(req, "busy, too many transfers");
+        return true;
+    }
+    // Only the httpd task submits, so the space checked above is still there
+    xQueueSend(g_jobs, &job, 0);
+    return true;
+}
+
+char* web_async_buffer(size_t* size)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (const Worker& w : g_workers)
+    {
+        if (w.task && w.task == self)
+        {
+            *size = w.size;
+            return w.buf;
+        }
+    }
+    *size = 0;
+    return nullptr;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+#include "esp_http_server.h"
+
+// Worker pool for long-running HTTP handlers (downloads, exports). The httpd task hands such a
+// request over with the async request API and goes back to serving the other sockets, so the file
+// listing and the small API calls stay responsive while several clients download in parallel.
+// Each worker owns a transfer buffer in PSRAM (WEB_ASYNC_BUF_BYTES; WEB_ASYNC_BUF_MIN_BYTES in
+// internal RAM without PSRAM), which bounds the memory per connection.
+#define WEB_ASYNC_WORKERS       3
+#define WEB_ASYNC_QUEUE_LEN     4       // waiting requests beyond the busy workers get 503
+#define WEB_ASYNC_BUF_BYTES     (32 * 1024)
+#define WEB_ASYNC_BUF_MIN_BYTES (12 * 1024)
+
+// Create the workers and their buffers; handlers run synchronously if this failed
+bool web_async_start();
+
+// At the top of a long-running handler: hands the request to a worker (or answers 503 if all are
+// busy) and returns true, then the handler returns ESP_OK. False when already on a worker or
+// without a pool: the handler goes on as usual.
+bool web_async_offload(httpd_req_t* req, esp_err_t (*handler)(httpd_req_t* req));
+
+// The calling worker's transfer buffer, nullptr off the workers
+char* web_async_buffer(size_t* size);
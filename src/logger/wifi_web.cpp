@@ -1,9 +1,15 @@
 #include "wifi_web.h"
 
+#include <algorithm>
+#include <bitset>
+#include <cctype>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <memory>
+#include <new>
+#include <vector>
 #include <dirent.h>
 #include <sys/stat.h>
 
@@ -17,8 +23,28 @@
 #include "esp_timer.h"
 #include "common.h"
 #include "esp_netif.h"
+#include "live_monitor.h"
+#include "clock_sync.h"
+#include "block_crc.h"
+#include "storage.h"
+#include "bus_health.h"
+#include "logging.h"
+#include "mem_budget.h"
+#include "param_table.h"
+#include "profiler.h"
+#include "trace.h"
+#include "tar_stream.h"
+#include "trigger.h"
+#include "web_async.h"
 
 #define WIFI_PASSWORD     "12345678"
+#define EXPORT_READ_BUF    (8 * 1024)
+#define EXPORT_SEND_BUF    (4 * 1024)
+#define EXPORT_MAX_FILES   16
+#define ARCHIVE_MIN_BUF    (8 * 1024)     // off the workers
+#define HTTPD_PRIORITY     2              // below SD_Writer, CAN_Proc and CAN_RX: the server runs while logging
+
+static_assert(EXPORT_READ_BUF + EXPORT_SEND_BUF <= WEB_ASYNC_BUF_MIN_BYTES, "export buffers come from a worker");
 
 #pragma GCC diagnostic ignored "-Wformat-truncation"  // todo -- fix that!!
 
@@ -101,7 +127,19 @@ esp_err_t root_get_handler(httpd_req_t* req)
         "<style>body{font-family:Arial;padding:1rem;}table{border-collapse:collapse;width:100%;}"
         "th,td{padding:8px;border-bottom:1px solid #ccc;text-align:left;}th{background:#eee;}"
         "a{text-decoration:none;color:#0066cc;word-break:break-all;}</style></head><body>"
-        "<h2>ESP32 File Browser (SD Card)</h2><table><tr><th>Name</th><th>Size</th></tr>";
+        "<h2>ESP32 File Browser (SD Card)</h2>"
+        "<p><a href='/monitor'>Live monitor</a> | <a href='/monitor?mode=latest'>Latest per ID</a> | "
+        "<a href='/archive'>All files (tar)</a></p>"
+        "<form action='/export'>Export "
+        "<input name='file' placeholder='CAN00001.LOG,CAN00002.LOG' size='24'/> "
+        "from <input name='from' placeholder='unix s' size='12'/> "
+        "to <input name='to' placeholder='unix s' size='12'/> "
+        "IDs <input name='ids' placeholder='123,200-2FF' size='16'/> "
+        "<select name='format'><option>text</option><option>bin</option></select> "
+        "<input type='submit' value='Export'/></form>"
+        "<table><tr><th>Name</th><th>Size</th></tr>"
+        // hand the browser's clock to the logger
+        "<script>fetch('/api/time?t='+Date.now()/1000,{method:'POST'});</script>";
 
     struct dirent* entry;
     while ((entry = readdir(dir)) != nullptr)
@@ -127,7 +165,7 @@ esp_err_t root_get_handler(httpd_req_t* req)
             html += "\">";
             html += entry->d_name;
             html += "</a></td><td>";
-            html += human_size(st.st_size);
+            html += human_size(storage_size(st));
             html += "</td></tr>";
         }
     }
@@ -138,9 +176,54 @@ esp_err_t root_get_handler(httpd_req_t* req)
     return ESP_OK;
 }
 
+// Send an open file (at most len bytes from its position) as chunked response and close it
+static esp_err_t stream_file(httpd_req_t* req, FILE* f, uint64_t len = UINT64_MAX)
+{
+    // The worker's transfer buffer: larger reads keep the card and the socket busy
+    char small[1024];
+    size_t size;
+    char* chunk = web_async_buffer(&size);
+    if (!chunk)
+    {
+        chunk = small;
+        size = sizeof(small);
+    }
+    size_t read_bytes;
+    while (len > 0 && (read_bytes = fread(chunk, 1, len < size ? (size_t)len : size, f)) > 0)
+    {
+        len -= read_bytes;
+        if (httpd_resp_send_chunk(req, chunk, read_bytes) != ESP_OK)
+        {
+            fclose(f);
+            httpd_resp_sendstr_chunk(req, nullptr);
+            return ESP_FAIL;
+        }
+        reset_web_activity();   // a long download is activity, not idle time
+    }
+    fclose(f);
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
+// "bytes=N-" or "bytes=N-M" (one range); *open_end is set for "N-"
+static bool parse_range(const char* s, uint64_t* first, uint64_t* last, bool* open_end)
+{
+    if (strncmp(s, "bytes=", 6) != 0 || !isdigit((unsigned char)s[6])) return false;
+    char* end;
+    *first = strtoull(s + 6, &end, 10);
+    if (*end != '-') return false;
+    s = end + 1;
+    *open_end = *s == '\0';
+    if (*open_end) return true;
+    if (!isdigit((unsigned char)*s)) return false;
+    *last = strtoull(s, &end, 10);
+    return *end == '\0' && *last >= *first;
+}
+
 esp_err_t download_get_handler(httpd_req_t* req)
 {
     reset_web_activity();
+    if (web_async_offload(req, download_get_handler)) return ESP_OK;
     char filepath[256];
     size_t buf_len = httpd_req_get_url_query_len(req) + 1;
     if (buf_len > 1)
@@ -173,22 +256,1040 @@ esp_err_t download_get_handler(httpd_req_t* req)
                     httpd_resp_set_hdr(req, "Content-Disposition", header);
                 }
 
-                char chunk[1024];
-                size_t read_bytes;
-                while ((read_bytes = fread(chunk, 1, sizeof(chunk), f)) > 0)
+                // Range requests resume a download or fetch only the new tail of a growing log
+                httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+                // Offsets past what the C library can seek to (2 GB on the target) are refused with 416
+                char range[48];
+                uint64_t first, last, size;
+                bool open_end;
+                if (httpd_req_get_hdr_value_str(req, "Range", range, sizeof(range)) == ESP_OK &&
+                    parse_range(range, &first, &last, &open_end) && storage_file_size(f, &size))
                 {
-                    if (httpd_resp_send_chunk(req, chunk, read_bytes) != ESP_OK)
+                    char content_range[64];
+                    if (first >= size || !storage_seek(f, first))
                     {
                         fclose(f);
-                        httpd_resp_sendstr_chunk(req, nullptr);
-                        return ESP_FAIL;
+                        snprintf(content_range, sizeof(content_range), "bytes */%llu", (unsigned long long)size);
+                        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+                        httpd_resp_set_hdr(req, "Content-Range", content_range);
+                        httpd_resp_send(req, nullptr, 0);
+                        return ESP_OK;
+                    }
+                    if (open_end || last >= size) last = size - 1;
+                    snprintf(content_range, sizeof(content_range), "bytes %llu-%llu/%llu", (unsigned long long)first,
+                             (unsigned long long)last, (unsigned long long)size);
+                    httpd_resp_set_status(req, "206 Partial Content");
+                    httpd_resp_set_hdr(req, "Content-Range", content_range);
+                    return stream_file(req, f, last - first + 1);
+                }
+                return stream_file(req, f);
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+// ---- Filtered export ----
+// GET /export?file=A.LOG[,B.LOG...][&from=<unix s>][&to=<unix s>][&ids=123,200-2FF,18FEF100][&format=text|bin]
+// Streams only the frames within [from, to] whose ID is in the set. Log timestamps are monotonic,
+// so the start of the window is found by bisecting the file instead of scanning it from the top. A
+// backward clock step ("* CLOCK STEP -", CAN only once frames are logged) breaks that: when the bisection
+// probes go back in time the whole file is scanned, and after a step record the scan no longer stops at
+// the first frame past 'to'. A step after that frame is not looked for.
+
+// Binary export record, little endian, 24 bytes
+typedef struct __attribute__((packed))
+{
+    uint64_t ts_us;
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t data[8];
+    uint8_t reserved[3];
+} ExportRecord;
+
+static_assert(sizeof(ExportRecord) == 24, "ExportRecord must stay 24 bytes");
+
+struct IdFilter
+{
+    bool all = true;
+    std::bitset<0x800> std_ids;                         // 11-bit IDs, one bit each
+    std::vector<std::pair<uint32_t, uint32_t>> ext_ids; // 29-bit ID ranges
+
+    bool match(uint32_t id) const
+    {
+        if (all) return true;
+        if (id < 0x800) return std_ids.test(id);
+        for (const auto& r : ext_ids)
+        {
+            if (id >= r.first && id <= r.second) return true;
+        }
+        return false;
+    }
+};
+
+// "123,200-2FF,18FEF100" -> filter; returns false on a malformed list
+static bool parse_id_filter(const char* s, IdFilter& filter)
+{
+    filter = IdFilter{};
+    if (!s || !*s) return true;
+    filter.all = false;
+    while (*s)
+    {
+        char* end;
+        unsigned long lo = strtoul(s, &end, 16);
+        if (end == s) return false;
+        unsigned long hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = strtoul(s, &end, 16);
+            if (end == s || hi < lo) return false;
+        }
+        if (hi > 0x1FFFFFFF) return false;
+        for (unsigned long id = lo; id <= hi && id < 0x800; id++)
+        {
+            filter.std_ids.set(id);
+        }
+        if (hi >= 0x800)
+        {
+            filter.ext_ids.emplace_back(lo < 0x800 ? 0x800 : lo, hi);
+        }
+        s = end;
+        if (*s == ',') s++;
+        else if (*s) return false;
+    }
+    return true;
+}
+
+// "1755839938.5" -> microseconds; returns false if not a number
+static bool parse_unix_us(const char* s, int64_t* out)
+{
+    char* end;
+    double v = strtod(s, &end);
+    if (end == s) return false;
+    *out = (int64_t)(v * 1000000.0);
+    return true;
+}
+
+static inline int hex_val(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// Query values in place: %XX and '+'. Browsers encode the commas of a submitted form ("A.LOG%2CB.LOG").
+static void url_decode(char* s)
+{
+    char* out = s;
+    for (const char* p = s; *p; p++)
+    {
+        int hi, lo;
+        if (*p == '%' && (hi = hex_val(p[1])) >= 0 && (lo = hex_val(p[2])) >= 0)
+        {
+            *out++ = (char)(hi << 4 | lo);
+            p += 2;
+        }
+        else
+        {
+            *out++ = *p == '+' ? ' ' : *p;
+        }
+    }
+    *out = '\0';
+}
+
+// Parse "(1755839938.123456) can 123#11AAFF" (no trailing newline required).
+// Comment lines ('*') and anything else that is not a frame return false.
+static bool parse_log_line(const char* p, const char* end, ExportRecord* rec)
+{
+    if (p >= end || *p != '(') return false;
+    p++;
+    int64_t sec = 0;
+    while (p < end && *p >= '0' && *p <= '9') sec = sec * 10 + (*p++ - '0');
+    int64_t usec = 0;
+    int digits = 0;
+    if (p < end && *p == '.')
+    {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            if (digits++ < 6) usec = usec * 10 + (*p - '0');
+            p++;
+        }
+    }
+    while (digits++ < 6) usec *= 10;
+    if (p >= end || *p++ != ')') return false;
+    // skip " <iface> "
+    while (p < end && *p == ' ') p++;
+    while (p < end && *p != ' ') p++;
+    while (p < end && *p == ' ') p++;
+
+    uint32_t id = 0;
+    int n = 0, v;
+    while (p < end && (v = hex_val(*p)) >= 0 && n < 8)
+    {
+        id = (id << 4) | v;
+        p++;
+        n++;
+    }
+    if (n == 0 || p >= end || *p++ != '#') return false;
+
+    rec->ts_us = (uint64_t)(sec * 1000000 + usec);
+    rec->id = id;
+    rec->dlc = 0;
+    memset(rec->data, 0, sizeof(rec->data));
+    memset(rec->reserved, 0, sizeof(rec->reserved));
+    while (p + 1 < end && rec->dlc < 8)
+    {
+        int h = hex_val(p[0]), l = hex_val(p[1]);
+        if (h < 0 || l < 0) break;
+        rec->data[rec->dlc++] = (uint8_t)((h << 4) | l);
+        p += 2;
+    }
+    return true;
+}
+
+// Timestamp of the first complete frame line at or after 'pos' (pos is assumed mid-line unless 0).
+static bool first_ts_after(FILE* f, uint64_t pos, char* buf, size_t buf_size, uint64_t* ts_us)
+{
+    if (!storage_seek(f, pos)) return false;
+    size_t n = fread(buf, 1, buf_size, f);
+    const char* p = buf;
+    const char* end = buf + n;
+    if (pos > 0)
+    {
+        p = (const char*)memchr(p, '\n', end - p);
+        if (!p) return false;
+        p++;
+    }
+    while (p < end)
+    {
+        const char* eol = (const char*)memchr(p, '\n', end - p);
+        if (!eol) return false;
+        ExportRecord rec;
+        if (parse_log_line(p, eol, &rec))
+        {
+            *ts_us = rec.ts_us;
+            return true;
+        }
+        p = eol + 1;
+    }
+    return false;
+}
+
+// Offset of a line start at or before the first frame with ts >= from_us; false if the probes go back in time
+static bool seek_to_time(FILE* f, uint64_t size, uint64_t from_us, char* buf, size_t buf_size, uint64_t* pos)
+{
+    uint64_t lo = 0, hi = size;
+    uint64_t lo_ts = 0, hi_ts = UINT64_MAX;     // probed timestamps at lo and hi
+    while (hi - lo > buf_size)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        uint64_t ts;
+        if (!first_ts_after(f, mid, buf, buf_size, &ts))
+        {
+            hi = mid;
+        }
+        else if (ts < lo_ts || ts > hi_ts)
+        {
+            return false;   // backward clock step
+        }
+        else if (ts >= from_us)
+        {
+            hi = mid;
+            hi_ts = ts;
+        }
+        else
+        {
+            lo = mid;
+            lo_ts = ts;
+        }
+    }
+    *pos = lo;
+    return true;
+}
+
+struct ExportSink
+{
+    httpd_req_t* req;
+    char* buf;
+    size_t used;
+
+    bool put(const char* data, size_t len)
+    {
+        if (used + len > EXPORT_SEND_BUF && !flush()) return false;
+        memcpy(buf + used, data, len);
+        used += len;
+        return true;
+    }
+
+    bool flush()
+    {
+        if (used == 0) return true;
+        bool ok = httpd_resp_send_chunk(req, buf, used) == ESP_OK;
+        used = 0;
+        return ok;
+    }
+};
+
+// Stream the matching frames of one file; returns false if the client went away
+static bool export_file(const char* name, int64_t from_us, int64_t to_us, const IdFilter& filter, bool binary,
+                        char* rbuf, ExportSink& sink)
+{
+    char filepath[256];
+    snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s", name);
+    FILE* f = fopen(filepath, "rb");
+    if (!f)
+    {
+        ESP_LOGW(TAG, "export: cannot open %s", filepath);
+        return true;
+    }
+
+    uint64_t size, start = 0;
+    bool stepped = false;   // behind a backward clock step: 'to' does not end the scan
+    if (from_us > 0 && storage_file_size(f, &size) && size > 0 &&
+        !seek_to_time(f, size, (uint64_t)from_us, rbuf, EXPORT_READ_BUF, &start))
+    {
+        start = 0;
+        stepped = true;
+    }
+    storage_seek(f, start);     // a probed offset, so reachable
+
+    bool ok = true;
+    bool done = false;
+    bool skip_partial = start > 0;
+    size_t carry = 0;
+    size_t n;
+    while (!done && (n = fread(rbuf + carry, 1, EXPORT_READ_BUF - carry, f)) > 0)
+    {
+        const char* p = rbuf;
+        const char* end = rbuf + carry + n;
+        const char* eol;
+        while ((eol = (const char*)memchr(p, '\n', end - p)) != nullptr)
+        {
+            if (skip_partial)
+            {
+                skip_partial = false;
+                p = eol + 1;
+                continue;
+            }
+            ExportRecord rec;
+            if (eol - p > 14 && memcmp(p, "* CLOCK STEP -", 14) == 0)
+            {
+                stepped = true;
+            }
+            else if (parse_log_line(p, eol, &rec))
+            {
+                if (to_us > 0 && (int64_t)rec.ts_us > to_us && !stepped)
+                {
+                    done = true;
+                    break;
+                }
+                if ((int64_t)rec.ts_us >= from_us && filter.match(rec.id))
+                {
+                    ok = binary ? sink.put((const char*)&rec, sizeof(rec)) : sink.put(p, eol - p + 1);
+                    if (!ok)
+                    {
+                        done = true;
+                        break;
                     }
                 }
-                fclose(f);
-                httpd_resp_send_chunk(req, nullptr, 0);
             }
+            p = eol + 1;
+        }
+        carry = end - p;
+        if (carry >= EXPORT_READ_BUF) carry = 0; // overlong garbage line, drop it
+        memmove(rbuf, p, carry);
+    }
+    fclose(f);
+    return ok;
+}
+
+esp_err_t export_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    if (web_async_offload(req, export_get_handler)) return ESP_OK;
+    size_t buf_len = httpd_req_get_url_query_len(req) + 1;
+    if (buf_len <= 1)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing file parameter");
+        return ESP_FAIL;
+    }
+    std::unique_ptr<char[]> query(new char[buf_len]);
+    if (httpd_req_get_url_query_str(req, query.get(), buf_len) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad query");
+        return ESP_FAIL;
+    }
+
+    char files[256];
+    char param[256];
+    if (httpd_query_key_value(query.get(), "file", files, sizeof(files)) != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing file parameter");
+        return ESP_FAIL;
+    }
+    url_decode(files);
+
+    int64_t from_us = 0, to_us = 0;
+    if (httpd_query_key_value(query.get(), "from", param, sizeof(param)) == ESP_OK && !parse_unix_us(param, &from_us))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad from");
+        return ESP_FAIL;
+    }
+    if (httpd_query_key_value(query.get(), "to", param, sizeof(param)) == ESP_OK && !parse_unix_us(param, &to_us))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad to");
+        return ESP_FAIL;
+    }
+
+    auto filter = std::make_unique<IdFilter>();
+    param[0] = '\0';
+    httpd_query_key_value(query.get(), "ids", param, sizeof(param));
+    url_decode(param);
+    if (!parse_id_filter(param, *filter))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad ids");
+        return ESP_FAIL;
+    }
+
+    bool binary = httpd_query_key_value(query.get(), "format", param, sizeof(param)) == ESP_OK &&
+        strcmp(param, "bin") == 0;
+
+    // Both buffers from the worker's transfer buffer; on the httpd task from the heap
+    size_t worker_size;
+    char* worker_buf = web_async_buffer(&worker_size);
+    std::unique_ptr<char[]> rbuf_heap, sbuf_heap;
+    char* rbuf = worker_buf;
+    char* sbuf = worker_buf ? worker_buf + EXPORT_READ_BUF : nullptr;
+    if (!worker_buf)
+    {
+        rbuf_heap.reset(new(std::nothrow) char[EXPORT_READ_BUF]);
+        sbuf_heap.reset(new(std::nothrow) char[EXPORT_SEND_BUF]);
+        rbuf = rbuf_heap.get();
+        sbuf = sbuf_heap.get();
+    }
+    if (!rbuf || !sbuf)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "out of memory");
+        return ESP_FAIL;
+    }
+
+    if (binary)
+    {
+        httpd_resp_set_type(req, "application/octet-stream");
+        httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"export.bin\"");
+    }
+    else
+    {
+        httpd_resp_set_type(req, "text/plain; charset=utf-8");
+    }
+
+    ExportSink sink{req, sbuf, 0};
+    int count = 0;
+    char* save = nullptr;
+    for (char* name = strtok_r(files, ",", &save); name && count < EXPORT_MAX_FILES;
+         name = strtok_r(nullptr, ",", &save), count++)
+    {
+        if (strchr(name, '/')) continue;
+        if (!export_file(name, from_us, to_us, *filter, binary, rbuf, sink))
+        {
+            httpd_resp_sendstr_chunk(req, nullptr);
+            return ESP_FAIL;
+        }
+        reset_web_activity();
+    }
+    if (!sink.flush())
+    {
+        httpd_resp_sendstr_chunk(req, nullptr);
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
+// ---- Bulk archive ----
+// GET /archive[?files=A.LOG,A.SUM,...|since=<index>|from=<unix s>][&gzip=1]
+// One tar stream of the selected files, built while it is sent: no temporary file, one long transfer
+// for a full-card offload. No selection: every file in the card root. since= takes the recordings
+// from that index on, from= those with frames at or after that time, both with their companion files.
+static int log_index(const char* name)
+{
+    int idx;
+    char dot;
+    return sscanf(name, "CAN%05d%c", &idx, &dot) == 2 && dot == '.' ? idx : -1;
+}
+
+// Whether a recording reaches 'from_us': the first frame in its last read buffer. Unknown counts as yes.
+static bool log_reaches(const char* name, int64_t from_us, char* buf, size_t buf_size)
+{
+    char filepath[256];
+    snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s", name);
+    FILE* f = fopen(filepath, "rb");
+    if (!f) return false;
+    struct stat st{};
+    long pos = fstat(fileno(f), &st) == 0 && st.st_size > (long)buf_size ? st.st_size - (long)buf_size : 0;
+    uint64_t ts;
+    bool reaches = !first_ts_after(f, pos, buf, buf_size, &ts) || (int64_t)ts >= from_us;
+    fclose(f);
+    return reaches;
+}
+
+static bool send_archive_chunk(void* ctx, const void* data, size_t len)
+{
+    reset_web_activity();   // a long download is activity, not idle time
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, (const char*)data, len) == ESP_OK;
+}
+
+esp_err_t archive_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    if (web_async_offload(req, archive_get_handler)) return ESP_OK;
+
+    size_t query_len = httpd_req_get_url_query_len(req) + 1;
+    std::unique_ptr<char[]> query(new char[query_len]);
+    std::unique_ptr<char[]> files(new char[query_len]);
+    query[0] = files[0] = '\0';
+    if (query_len > 1) httpd_req_get_url_query_str(req, query.get(), query_len);
+    char param[32];
+    int since = -1;
+    int64_t from_us = -1;
+    bool listed = httpd_query_key_value(query.get(), "files", files.get(), query_len) == ESP_OK;
+    url_decode(files.get());
+    if (httpd_query_key_value(query.get(), "since", param, sizeof(param)) == ESP_OK) since = atoi(param);
+    if (httpd_query_key_value(query.get(), "from", param, sizeof(param)) == ESP_OK && !parse_unix_us(param, &from_us))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad from");
+        return ESP_FAIL;
+    }
+    bool gzip = httpd_query_key_value(query.get(), "gzip", param, sizeof(param)) == ESP_OK &&
+        strcmp(param, "1") == 0;
+
+    size_t buf_size;
+    char* buf = web_async_buffer(&buf_size);
+    std::unique_ptr<char[]> buf_heap;
+    if (!buf)
+    {
+        buf_size = ARCHIVE_MIN_BUF;
+        buf_heap.reset(new(std::nothrow) char[buf_size]);
+        buf = buf_heap.get();
+    }
+    if (!buf)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "out of memory");
+        return ESP_FAIL;
+    }
+
+    // Select, in name order (= recording order for the logs)
+    std::vector<std::string> wanted;
+    char* save = nullptr;
+    for (char* name = strtok_r(files.get(), ",", &save); name; name = strtok_r(nullptr, ",", &save))
+    {
+        wanted.push_back(name);
+    }
+    std::vector<std::string> names;
+    DIR* dir = opendir(SD_MOUNT_POINT);
+    if (!dir)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "cannot open SD card root");
+        return ESP_FAIL;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr)
+    {
+        if (entry->d_type == DT_DIR) continue;
+        if (listed && std::find(wanted.begin(), wanted.end(), entry->d_name) == wanted.end()) continue;
+        if ((since >= 0 || from_us >= 0) && log_index(entry->d_name) < since) continue;
+        names.push_back(entry->d_name);
+    }
+    closedir(dir);
+    std::sort(names.begin(), names.end());
+
+    if (from_us >= 0)
+    {
+        // Keep the indexes whose log reaches from=, with all of their files
+        std::vector<int> keep;
+        for (const std::string& name : names)
+        {
+            const char* ext = strrchr(name.c_str(), '.');
+            if (ext && strcasecmp(ext, ".LOG") == 0 && log_index(name.c_str()) >= 0 &&
+                log_reaches(name.c_str(), from_us, buf, buf_size))
+            {
+                keep.push_back(log_index(name.c_str()));
+            }
+        }
+        names.erase(std::remove_if(names.begin(), names.end(), [&keep](const std::string& name) {
+            return std::find(keep.begin(), keep.end(), log_index(name.c_str())) == keep.end();
+        }), names.end());
+    }
+
+    // Nothing has been sent yet: the 503 and the headers below still make it into the response
+    TarStream ts;
+    if (!tar_stream_begin(&ts, send_archive_chunk, req, buf, buf_size, gzip))
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "5");
+        httpd_resp_sendstr(req, "compressor busy or no PSRAM, retry or drop gzip=1");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, gzip ? "application/gzip" : "application/x-tar");
+    httpd_resp_set_hdr(req, "Content-Disposition",
+                       gzip ? "attachment; filename=\"canlogs.tar.gz\"" : "attachment; filename=\"canlogs.tar\"");
+
+    for (const std::string& name : names)
+    {
+        char filepath[256];
+        snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s", name.c_str());
+        FILE* f = fopen(filepath, "rb");
+        if (!f) continue;   // removed by the log cleanup meanwhile
+        struct stat st{};
+        if (fstat(fileno(f), &st) == 0 && !tar_stream_file(&ts, name.c_str(), f, st.st_size, st.st_mtime))
+        {
+            fclose(f);
+            break;
+        }
+        fclose(f);
+    }
+    if (!tar_stream_end(&ts))
+    {
+        ESP_LOGW(TAG, "archive: client went away");
+        httpd_resp_sendstr_chunk(req, nullptr);
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
+// ---- Per-ID statistics ----
+// GET /api/stats?file=CAN00012.LOG -> CAN00012.SUM written by the logger (CSV, one line per ID)
+esp_err_t stats_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    char query[160];
+    char param[128];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "file", param, sizeof(param)) != ESP_OK || strchr(param, '/'))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing file parameter");
+        return ESP_FAIL;
+    }
+    char* dot = strrchr(param, '.');
+    if (dot) *dot = '\0';
+
+    char filepath[256];
+    snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s.SUM", param);
+    FILE* f = fopen(filepath, "rb");
+    if (!f)
+    {
+        httpd_resp_send_404(req);
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "text/csv; charset=utf-8");
+    return stream_file(req, f);
+}
+
+// ---- Sync manifest ----
+// GET /api/manifest                    -> every file with size and mtime; logs also with the bytes their
+//                                         companion CRC file covers and the CRC32 through them
+// GET /api/manifest?file=CAN00012.LOG  -> one log with the CRC32 of each block (block_crc.h)
+// An offload client fetches the files it does not have, and of a grown log only the blocks after the
+// last one that still matches its copy (test/src/canlog-sync.sh).
+// CANxxxxx.LOG -> path of CANxxxxx.CRC; false for other files
+static bool crc_companion(const char* name, char* out, size_t out_size)
+{
+    const char* dot = strrchr(name, '.');
+    if (!dot || strcasecmp(dot, ".LOG") != 0) return false;
+    snprintf(out, out_size, SD_MOUNT_POINT "/%.*s.CRC", (int)(dot - name), name);
+    return true;
+}
+
+static bool manifest_blocks(ExportSink& sink, const char* crc_path)
+{
+    FILE* f = fopen(crc_path, "rb");
+    bool ok = sink.put(",\"block_crc\":[", 13);
+    BlockCrcHeader h;
+    if (f && fread(&h, sizeof(h), 1, f) == 1 && memcmp(h.magic, BLOCK_CRC_MAGIC, sizeof(h.magic)) == 0)
+    {
+        BlockCrcRecord recs[32];
+        size_t n;
+        bool first = true;
+        while (ok && (n = fread(recs, sizeof(recs[0]), 32, f)) > 0)
+        {
+            for (size_t i = 0; i < n && ok; i++, first = false)
+            {
+                char item[12];
+                int len = snprintf(item, sizeof(item), "%s\"%08lx\"", first ? "" : ",", (unsigned long)recs[i].crc);
+                ok = sink.put(item, len);
+            }
+        }
+    }
+    if (f) fclose(f);
+    return ok && sink.put("]", 1);
+}
+
+static bool manifest_entry(ExportSink& sink, const char* name, const struct stat& st, bool first, bool with_blocks)
+{
+    char item[224];
+    int n = snprintf(item, sizeof(item), "%s{\"name\":\"%s\",\"size\":%llu,\"mtime\":%lld", first ? "" : ",\n",
+                     name, (unsigned long long)storage_size(st), (long long)st.st_mtime);
+    char crc_path[256];
+    uint64_t hashed;
+    uint32_t file_crc, blocks;
+    bool hashes = crc_companion(name, crc_path, sizeof(crc_path)) &&
+                  block_crc_summary(crc_path, &hashed, &file_crc, &blocks);
+    if (hashes)
+    {
+        n += snprintf(item + n, sizeof(item) - n, ",\"hashed\":%llu,\"crc\":\"%08lx\",\"blocks\":%lu",
+                      (unsigned long long)hashed, (unsigned long)file_crc, (unsigned long)blocks);
+    }
+    bool ok = sink.put(item, n);
+    if (ok && hashes && with_blocks) ok = manifest_blocks(sink, crc_path);
+    return ok && sink.put("}", 1);
+}
+
+esp_err_t manifest_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    if (web_async_offload(req, manifest_get_handler)) return ESP_OK;
+    char query[160] = "";
+    char file[128] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    bool single = httpd_query_key_value(query, "file", file, sizeof(file)) == ESP_OK;
+    if (single && strchr(file, '/'))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad file");
+        return ESP_FAIL;
+    }
+
+    size_t worker_size;
+    char* sbuf = web_async_buffer(&worker_size);
+    std::unique_ptr<char[]> sbuf_heap;
+    if (!sbuf)
+    {
+        sbuf_heap.reset(new(std::nothrow) char[EXPORT_SEND_BUF]);
+        sbuf = sbuf_heap.get();
+    }
+    if (!sbuf)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "out of memory");
+        return ESP_FAIL;
+    }
+    ExportSink sink{req, sbuf, 0};
+    httpd_resp_set_type(req, "application/json");
+
+    bool ok;
+    if (single)
+    {
+        char filepath[256];
+        snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s", file);
+        struct stat st{};
+        if (stat(filepath, &st) != 0)
+        {
+            httpd_resp_send_404(req);
+            return ESP_FAIL;
         }
+        char head[48];
+        ok = sink.put(head, snprintf(head, sizeof(head), "{\"block\":%u,\"file\":", (unsigned)BLOCK_CRC_BYTES)) &&
+             manifest_entry(sink, file, st, true, true) && sink.put("}\n", 2);
     }
+    else
+    {
+        DIR* dir = opendir(SD_MOUNT_POINT);
+        if (!dir)
+        {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "cannot open SD card root");
+            return ESP_FAIL;
+        }
+        char head[48];
+        ok = sink.put(head, snprintf(head, sizeof(head), "{\"block\":%u,\"files\":[\n", (unsigned)BLOCK_CRC_BYTES));
+        bool first = true;
+        struct dirent* entry;
+        while (ok && (entry = readdir(dir)) != nullptr)
+        {
+            char filepath[256];
+            snprintf(filepath, sizeof(filepath), SD_MOUNT_POINT "/%s", entry->d_name);
+            struct stat st{};
+            if (entry->d_type == DT_DIR || stat(filepath, &st) != 0) continue;
+            ok = manifest_entry(sink, entry->d_name, st, first, false);
+            first = false;
+        }
+        closedir(dir);
+        ok = ok && sink.put("\n]}\n", 4);
+    }
+    if (!ok || !sink.flush())
+    {
+        httpd_resp_sendstr_chunk(req, nullptr);
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
+// ---- Clock ----
+// POST /api/time?t=<unix s>  sets the log clock from the client (the root page does this on load);
+//                            409 if it was ignored (see clock_sync_reference)
+// GET  /api/time             clock state as JSON
+esp_err_t time_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    char query[64];
+    char param[32];
+    int64_t ref_us;
+    if (req->method == HTTP_POST)
+    {
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+            httpd_query_key_value(query, "t", param, sizeof(param)) != ESP_OK || !parse_unix_us(param, &ref_us))
+        {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing t");
+            return ESP_FAIL;
+        }
+        if (!clock_sync_reference(ref_us, clock_sync_now_us(), CLOCK_SRC_WEB))
+        {
+            httpd_resp_set_status(req, "409 Conflict");
+        }
+    }
+
+    ClockSyncStatus st;
+    clock_sync_get_status(&st);
+    int64_t now = clock_sync_now_us();
+    char json[256];
+    snprintf(json, sizeof(json),
+             "{\"now\":%lld.%06lld,\"source\":\"%s\",\"base_offset_us\":%lld,\"last_error_us\":%lld,"
+             "\"slew_pending_us\":%lld,\"since_sync_ms\":%lld,\"steps\":%u,\"slews\":%u}",
+             (long long)(now / 1000000), (long long)(now % 1000000), clock_source_name(st.source),
+             (long long)st.base_offset_us, (long long)st.last_error_us, (long long)st.slew_pending_us,
+             (long long)st.since_sync_ms, st.steps, st.slews);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+    return ESP_OK;
+}
+
+// ---- Bus health ----
+// GET /api/health -> where frames were lost since logging started, controller state and bus load
+esp_err_t health_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    BusHealth h;
+    bus_health_get(&h);
+    LoggingStats ls;
+    get_logging_stats(&ls);
+    TriggerStatus ts;
+    trigger_get_status(&ts);
+    char json[768];
+    snprintf(json, sizeof(json),
+             "{\"state\":\"%s\",\"tec\":%lu,\"rec\":%lu,\"bus_errors\":%lu,\"arb_lost\":%lu,"
+             "\"bus_off_events\":%u,\"rx_pending\":%lu,\"bus_load_pct\":%.1f,\"frames_per_s\":%.0f,"
+             "\"frames\":%lu,\"lost\":{\"controller_overrun\":%lu,\"driver_rx_queue\":%lu,"
+             "\"can_queue\":%lu,\"sd_queue\":%lu,\"sd_write_errors\":%lu,\"status_records\":%lu},"
+             "\"sd_batch\":{\"target_bytes\":%lu,\"flush_ms\":%lu},"
+             "\"trigger\":{\"enabled\":%s,\"in_window\":%s,\"triggers\":%lu,\"windows\":%lu,"
+             "\"committed\":%lu,\"lost\":%lu,\"buffered_bytes\":%lu}}",
+             h.ctrl_ok ? source_state_name(h.ctrl.state) : "unknown", (unsigned long)h.ctrl.tec,
+             (unsigned long)h.ctrl.rec, (unsigned long)h.ctrl.bus_errors, (unsigned long)h.ctrl.arb_lost,
+             h.bus_off_events, (unsigned long)h.ctrl.rx_pending, h.bus_load_pct, h.frames_per_s, ls.frames,
+             h.lost_overrun, h.lost_missed, h.lost_can_queue, h.lost_sd_queue, h.write_errors, ls.dropped_status,
+             (unsigned long)ls.batch_target, (unsigned long)ls.batch_flush_ms, ts.enabled ? "true" : "false",
+             ts.in_window ? "true" : "false", ts.triggers, ts.windows, ts.committed, ts.lost,
+             (unsigned long)ts.buffered_bytes);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+    return ESP_OK;
+}
+
+// ---- Memory budget ----
+// GET /api/memory -> long-lived buffers per subsystem and heap totals per memory type
+esp_err_t memory_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    MemBudgetEntry entries[32];
+    unsigned n = mem_budget_entries(entries, 32);
+    MemBudgetTotals t;
+    mem_budget_totals(&t);
+    std::string json = "{\"buffers\":[";
+    char item[160];
+    for (unsigned i = 0; i < n; i++)
+    {
+        snprintf(item, sizeof(item), "%s{\"owner\":\"%s\",\"bytes\":%lu,\"psram\":%s}", i ? "," : "",
+                 entries[i].owner, (unsigned long)entries[i].bytes, entries[i].psram ? "true" : "false");
+        json += item;
+    }
+    snprintf(item, sizeof(item), "],\"internal\":{\"buffers\":%lu,\"total\":%u,\"free\":%u,\"min_free\":%u,",
+             (unsigned long)t.internal_bytes, (unsigned)t.internal_total, (unsigned)t.internal_free,
+             (unsigned)t.internal_min_free);
+    json += item;
+    snprintf(item, sizeof(item), "\"largest_block\":%u},\"psram\":{\"buffers\":%lu,\"total\":%u,\"free\":%u}}",
+             (unsigned)t.internal_largest, (unsigned long)t.psram_bytes, (unsigned)t.psram_total,
+             (unsigned)t.psram_free);
+    json += item;
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json.c_str());
+    return ESP_OK;
+}
+
+// ---- Profiler ----
+// GET /api/profile -> CPU share and stack headroom per task, free memory per heap capability
+esp_err_t profile_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    static ProfilerSnapshot s;  // handlers run on the single httpd task
+    // While logging the supervisor samples every PROFILER_PERIOD_S; before that the request does
+    profiler_get(&s, PROFILER_PERIOD_S * 1000);
+    char item[160];
+    snprintf(item, sizeof(item), "{\"age_ms\":%lld,\"interval_ms\":%lu,\"tasks\":[",
+             (long long)((esp_timer_get_time() - s.at_us) / 1000), (unsigned long)s.interval_ms);
+    std::string json = item;
+    for (unsigned i = 0; i < s.task_count; i++)
+    {
+        const ProfilerTask& t = s.tasks[i];
+        snprintf(item, sizeof(item),
+                 "%s{\"name\":\"%s\",\"priority\":%u,\"core\":%d,\"cpu_pct\":%u.%u,\"stack_free\":%lu}",
+                 i ? "," : "", t.name, t.priority, t.core, t.cpu_permille / 10, t.cpu_permille % 10,
+                 (unsigned long)t.stack_free);
+        json += item;
+    }
+    const ProfilerHeap* heaps[2] = {&s.internal, &s.psram};
+    const char* names[2] = {"internal", "psram"};
+    for (int i = 0; i < 2; i++)
+    {
+        snprintf(item, sizeof(item), "%s\"%s\":{\"free\":%u,\"min_free\":%u,\"largest_block\":%u,\"frag_pct\":%u}",
+                 i ? "," : "],", names[i], (unsigned)heaps[i]->free, (unsigned)heaps[i]->min_free,
+                 (unsigned)heaps[i]->largest, heaps[i]->frag_pct);
+        json += item;
+    }
+    json += "}";
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json.c_str());
+    return ESP_OK;
+}
+
+// ---- Latency trace ----
+// POST /api/trace?every=N  tags every Nth frame from now on (0 stops)
+// GET  /api/trace          stops tracing and downloads the event ring (test/src/canlog_trace.cpp)
+static bool send_trace_chunk(void* ctx, const void* data, size_t len)
+{
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, (const char*)data, len) == ESP_OK;
+}
+
+esp_err_t trace_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    if (req->method == HTTP_POST)
+    {
+        char query[32];
+        char param[16];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+            httpd_query_key_value(query, "every", param, sizeof(param)) != ESP_OK)
+        {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "missing every");
+            return ESP_FAIL;
+        }
+        if (!trace_start((uint32_t)strtoul(param, nullptr, 10)))
+        {
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "no PSRAM for the trace ring");
+            return ESP_FAIL;
+        }
+        httpd_resp_sendstr(req, "ok");
+        return ESP_OK;
+    }
+    if (web_async_offload(req, trace_handler)) return ESP_OK;
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"trace.bin\"");
+    if (!trace_dump(send_trace_chunk, req)) return ESP_FAIL;
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
+// ---- CANaerospace parameters ----
+// GET /api/params[?ids=4B0,300-3FF][&format=bin] -> latest value, age and update rate per parameter
+// (JSON), or the table records as in param_table.h
+struct ParamsCtx
+{
+    ExportSink* sink;
+    const IdFilter* filter;
+    bool binary;
+    int64_t now_us;
+    unsigned n;
+    bool ok;
+};
+
+static void send_param(const ParamEntry* e, void* arg)
+{
+    auto* ctx = static_cast<ParamsCtx*>(arg);
+    if (!ctx->ok || !ctx->filter->match(e->id)) return;
+    if (ctx->binary)
+    {
+        ctx->ok = ctx->sink->put((const char*)e, sizeof(*e));
+        return;
+    }
+    char item[256];
+    int n = snprintf(item, sizeof(item), "%s{\"id\":\"%03X\",\"node\":%u,\"type\":\"%s\",\"service\":%u,\"code\":%u,"
+                     "\"value\":", ctx->n++ ? ",\n" : "", e->id, e->hdr.node_id, canas_type_name(e->hdr.data_type),
+                     e->hdr.service_code, e->hdr.message_code);
+    double v[4];
+    unsigned count = canas_values(e->hdr.data_type, e->payload, v);
+    if (count == 0) n += snprintf(item + n, sizeof(item) - n, "null");
+    if (count > 1) item[n++] = '[';
+    for (unsigned i = 0; i < count; i++) n += snprintf(item + n, sizeof(item) - n, "%s%.9g", i ? "," : "", v[i]);
+    if (count > 1) item[n++] = ']';
+    n += snprintf(item + n, sizeof(item) - n, ",\"age_ms\":%lld,\"rate_hz\":%.2f,\"count\":%lu}",
+                  (long long)((ctx->now_us - e->last_us) / 1000), e->period_us ? 1e6 / e->period_us : 0.0,
+                  (unsigned long)e->count);
+    ctx->ok = ctx->sink->put(item, n);
+}
+
+esp_err_t params_get_handler(httpd_req_t* req)
+{
+    reset_web_activity();
+    char query[256] = "";
+    char param[224] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    auto filter = std::make_unique<IdFilter>();
+    httpd_query_key_value(query, "ids", param, sizeof(param));
+    url_decode(param);
+    if (!parse_id_filter(param, *filter))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "bad ids");
+        return ESP_FAIL;
+    }
+    bool binary = httpd_query_key_value(query, "format", param, sizeof(param)) == ESP_OK && strcmp(param, "bin") == 0;
+    std::unique_ptr<char[]> sbuf(new(std::nothrow) char[EXPORT_SEND_BUF]);
+    if (!sbuf)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "out of memory");
+        return ESP_FAIL;
+    }
+
+    ExportSink sink{req, sbuf.get(), 0};
+    ParamsCtx ctx{&sink, filter.get(), binary, clock_sync_now_us(), 0, true};
+    ParamTableStats st;
+    param_table_stats(&st);
+    if (binary)
+    {
+        httpd_resp_set_type(req, "application/octet-stream");
+        ParamDumpHeader h;
+        memcpy(h.magic, PARAM_MAGIC, sizeof(h.magic));
+        h.version = PARAM_VERSION;
+        h.record_bytes = sizeof(ParamEntry);
+        h.now_us = ctx.now_us;
+        sink.put((const char*)&h, sizeof(h));
+    }
+    else
+    {
+        httpd_resp_set_type(req, "application/json");
+        char head[128];
+        int n = snprintf(head, sizeof(head), "{\"decoded\":%lu,\"ignored\":%lu,\"lost\":%lu,\"params\":[\n",
+                         st.decoded, st.ignored, st.lost);
+        sink.put(head, n);
+    }
+    param_table_foreach(send_param, &ctx);
+    if (!binary && ctx.ok) ctx.ok = sink.put("]}\n", 3);
+    if (!ctx.ok || !sink.flush())
+    {
+        httpd_resp_sendstr_chunk(req, nullptr);
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, nullptr, 0);
     return ESP_OK;
 }
 
@@ -196,15 +1297,64 @@ httpd_handle_t start_webserver()
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
+    config.task_priority = HTTPD_PRIORITY;
+    config.max_uri_handlers = 24;
     httpd_handle_t server = nullptr;
     if (httpd_start(&server, &config) == ESP_OK)
     {
+        // Downloads and exports run on workers; the httpd task stays free for the rest
+        if (!web_async_start()) ESP_LOGW(TAG, "no transfer workers; long requests block the server");
         httpd_uri_t root = {.uri = "/", .method = HTTP_GET, .handler = root_get_handler, .user_ctx = nullptr};
         httpd_uri_t download = {
             .uri = "/download", .method = HTTP_GET, .handler = download_get_handler, .user_ctx = nullptr
         };
+        httpd_uri_t export_uri = {
+            .uri = "/export", .method = HTTP_GET, .handler = export_get_handler, .user_ctx = nullptr
+        };
         httpd_register_uri_handler(server, &root);
         httpd_register_uri_handler(server, &download);
+        httpd_uri_t stats = {
+            .uri = "/api/stats", .method = HTTP_GET, .handler = stats_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &export_uri);
+        httpd_uri_t archive = {
+            .uri = "/archive", .method = HTTP_GET, .handler = archive_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &archive);
+        httpd_register_uri_handler(server, &stats);
+        httpd_uri_t time_get = {.uri = "/api/time", .method = HTTP_GET, .handler = time_handler, .user_ctx = nullptr};
+        httpd_uri_t time_post = {.uri = "/api/time", .method = HTTP_POST, .handler = time_handler, .user_ctx = nullptr};
+        httpd_register_uri_handler(server, &time_get);
+        httpd_register_uri_handler(server, &time_post);
+        httpd_uri_t health = {
+            .uri = "/api/health", .method = HTTP_GET, .handler = health_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &health);
+        httpd_uri_t memory = {
+            .uri = "/api/memory", .method = HTTP_GET, .handler = memory_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &memory);
+        httpd_uri_t profile = {
+            .uri = "/api/profile", .method = HTTP_GET, .handler = profile_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &profile);
+        httpd_uri_t trace_get = {
+            .uri = "/api/trace", .method = HTTP_GET, .handler = trace_handler, .user_ctx = nullptr
+        };
+        httpd_uri_t trace_post = {
+            .uri = "/api/trace", .method = HTTP_POST, .handler = trace_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &trace_get);
+        httpd_register_uri_handler(server, &trace_post);
+        httpd_uri_t params = {
+            .uri = "/api/params", .method = HTTP_GET, .handler = params_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &params);
+        httpd_uri_t manifest = {
+            .uri = "/api/manifest", .method = HTTP_GET, .handler = manifest_get_handler, .user_ctx = nullptr
+        };
+        httpd_register_uri_handler(server, &manifest);
+        live_monitor_register(server);
     }
     return server;
 }
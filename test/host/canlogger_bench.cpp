@@ -0,0 +1,343 @@
+// Throughput / loss regression benchmark for the logging pipeline.
+// Every scenario runs the unmodified pipeline in a forked child (the capture tasks cannot be stopped),
+// the parent collects the results, prints a table and compares it against stored baselines.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "host_run.h"
+#include "logging.h"
+
+// Simulated cards: cost per write call, bandwidth, periodic stalls
+struct CardProfile
+{
+    const char* name;
+    uint32_t write_latency_us;
+    double write_mbps;
+    uint32_t stall_every_ms;
+    uint32_t stall_us;
+};
+
+static const CardProfile CARDS[] = {
+    {"none",  0,    0,  0,    0},       // command line --write-latency-us / --write-mbps
+    {"sd",    1500, 20, 0,    0},       // typical class 10 card through the SDMMC host
+    {"slow",  5000, 5,  0,    0},       // worn or low-end card
+    {"stall", 1500, 20, 1000, 100000},  // sd plus a 100 ms garbage collection pause every second
+};
+
+struct Scenario
+{
+    const char* name;
+    const char* profile;
+    double rate;        // frames/s, 0 = as fast as the pipeline takes them
+    uint32_t bitrate;
+    uint64_t frames;
+    const char* card;
+    const char* what;
+};
+
+// Roughly 3 s each, except flood which runs as fast as it can
+static const Scenario SCENARIOS[] = {
+    {"seq_2k",     "seq",   2000,  500000, 6000,   "none",  "cangen -I i -D i -L 4 -g 0.5 (README reference)"},
+    {"burst_2k",   "burst", 2000,  500000, 6000,   "none",  "32-frame bursts at bus speed, 2000 frames/s average"},
+    {"full_500k",  "full",  0,     500000, 13500,  "none",  "100% bus load, 8-byte frames, 500 kbit/s"},
+    {"full_1m",    "full",  0,    1000000, 27000,  "none",  "100% bus load, 8-byte frames, 1 Mbit/s"},
+    {"mixed_3k",   "mixed", 3000,  500000, 9000,   "none",  "alternating 11/29-bit IDs, DLC 1..8, 3000 frames/s"},
+    {"flood",      "seq",   0,     500000, 200000, "none",  "pipeline capacity, no bus timing"},
+    {"seq_2k_sd",  "seq",   2000,  500000, 6000,   "sd",    "seq_2k on a simulated SD card"},
+    {"full_1m_sd", "full",  0,    1000000, 27000,  "sd",    "full_1m on a simulated SD card"},
+    {"full_1m_slow", "full", 0,   1000000, 27000,  "slow",  "full_1m on a slow card (5 ms + 5 MB/s per write)"},
+    {"full_1m_stall", "full", 0,  1000000, 27000,  "stall", "full_1m on an SD card pausing 100 ms every second"},
+};
+
+static const CardProfile* find_card(const char* name)
+{
+    for (const CardProfile& c : CARDS)
+    {
+        if (strcmp(c.name, name) == 0) return &c;
+    }
+    return nullptr;
+}
+
+struct Measurement
+{
+    bool ok;
+    double fps;
+    double loss_pct;
+    double p50_ms, p90_ms, p99_ms, max_ms;
+    double rx_wait_p99_ms;
+    double cpu_us_per_frame;
+    double kb_per_write;
+    double write_pct;       // share of the run spent inside storage writes
+    double csw_per_s;       // context switches of the pipeline process per second
+    HostRunResult run;
+};
+
+// Limits a scenario has to stay within; missing entries are not checked
+struct Baseline
+{
+    double min_fps = 0;
+    double max_loss_pct = 100;
+    double max_p99_ms = 1e9;
+    double max_cpu_us_per_frame = 1e9;
+};
+
+static double percentile_ms(std::vector<uint32_t>& v, double p)
+{
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(p / 100.0 * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k] / 1000.0;
+}
+
+struct BenchOptions
+{
+    HostStorageConfig storage;
+    unsigned rx_queue = 256;
+    bool adaptive = true;
+    uint32_t max_latency_ms = 0;
+};
+
+static Measurement run_child(const Scenario& sc, const BenchOptions& opt)
+{
+    HostSourceConfig source;
+    source.profile = sc.profile;
+    source.rate = sc.rate;
+    source.bitrate = sc.bitrate;
+    source.max_frames = sc.frames;
+    source.rx_queue_len = opt.rx_queue;
+
+    HostStorageConfig storage = opt.storage;
+    const CardProfile* card = find_card(sc.card);
+    if (card && strcmp(card->name, "none") != 0)
+    {
+        storage.write_latency_us = card->write_latency_us;
+        storage.write_bytes_per_s = card->write_mbps * 1e6;
+        storage.stall_every_ms = card->stall_every_ms;
+        storage.stall_us = card->stall_us;
+    }
+    storage.root += "/";
+    storage.root += sc.name;
+    storage.trace_latency = true;
+    std::string cmd = "rm -rf '" + storage.root + "'";
+    if (system(cmd.c_str()) != 0) fprintf(stderr, "could not clear %s\n", storage.root.c_str());
+
+    Measurement m{};
+    logging_configure_batching(opt.adaptive, opt.max_latency_ms);
+    if (!host_run(source, storage, 0, &m.run)) return m;
+
+    const HostRunResult& r = m.run;
+    std::vector<uint32_t> lat = host_storage_latency_us();
+    std::vector<uint32_t> wait = host_source_rx_wait_us();
+    uint64_t lost = r.missed_rx + r.dropped_can + r.dropped_sd;
+    m.ok = true;
+    m.fps = r.elapsed_s > 0 ? r.logged / r.elapsed_s : 0;
+    m.loss_pct = r.generated ? 100.0 * lost / r.generated : 0;
+    m.p50_ms = percentile_ms(lat, 50);
+    m.p90_ms = percentile_ms(lat, 90);
+    m.p99_ms = percentile_ms(lat, 99);
+    m.max_ms = lat.empty() ? 0 : *std::max_element(lat.begin(), lat.end()) / 1000.0;
+    m.rx_wait_p99_ms = percentile_ms(wait, 99);
+    m.cpu_us_per_frame = r.logged ? (double)r.task_cpu_us / r.logged : 0;
+    m.kb_per_write = r.writes ? r.bytes / 1024.0 / r.writes : 0;
+    m.write_pct = r.elapsed_s > 0 ? 100.0 * r.write_us / 1e6 / r.elapsed_s : 0;
+    m.csw_per_s = r.elapsed_s > 0 ? r.ctx_switches / r.elapsed_s : 0;
+    return m;
+}
+
+static bool run_scenario(const Scenario& sc, const BenchOptions& opt, Measurement* out)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    fflush(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0)
+    {
+        close(fds[0]);
+        Measurement m = run_child(sc, opt);
+        ssize_t n = write(fds[1], &m, sizeof(m));
+        _exit(n == (ssize_t)sizeof(m) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t n = read(fds[0], out, sizeof(*out));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return n == (ssize_t)sizeof(*out) && WIFEXITED(status) && WEXITSTATUS(status) == 0 && out->ok;
+}
+
+// Format: one scenario per line, "name min_fps max_loss_pct max_p99_ms max_cpu_us_per_frame"; '#' comments
+static std::map<std::string, Baseline> load_baselines(const char* path)
+{
+    std::map<std::string, Baseline> out;
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        fprintf(stderr, "cannot open baselines %s\n", path);
+        return out;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+        char name[64];
+        Baseline b;
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%63s %lf %lf %lf %lf", name, &b.min_fps, &b.max_loss_pct, &b.max_p99_ms,
+                   &b.max_cpu_us_per_frame) == 5)
+        {
+            out[name] = b;
+        }
+    }
+    fclose(f);
+    return out;
+}
+
+// New limits from a measurement, with headroom for run-to-run noise on a shared machine
+static bool write_baselines(const char* path, const std::vector<std::pair<const Scenario*, Measurement>>& results)
+{
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+    fprintf(f, "# canlogger_bench baselines, written with --update.\n"
+               "# A scenario fails if it logs fewer frames/s, loses more, has a higher p99 storage latency\n"
+               "# or costs more CPU per frame than listed. Limits are the measured values with headroom:\n"
+               "# fps x0.7, loss +0.1 %%, p99 x2 (at least +20 ms), CPU x2.\n"
+               "# scenario  min_fps  max_loss_pct  max_p99_ms  max_cpu_us_per_frame\n");
+    for (const auto& [sc, m] : results)
+    {
+        fprintf(f, "%-13s %9.0f %6.2f %8.1f %8.2f\n", sc->name, std::floor(m.fps * 0.7), m.loss_pct + 0.1,
+                std::max(m.p99_ms * 2, m.p99_ms + 20), m.cpu_us_per_frame * 2);
+    }
+    fclose(f);
+    return true;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --baseline FILE        compare against FILE, exit 1 on regression\n"
+            "  --update FILE          write new baselines from this run\n"
+            "  --only NAME[,NAME]     run only these scenarios\n"
+            "  --out DIR              scratch directory for the logs (default bench_sd)\n"
+            "  --rx-queue N           simulated driver RX queue length (default 256, see test/README.md)\n"
+            "  --write-latency-us US  injected cost per storage write\n"
+            "  --write-mbps MB        storage bandwidth limit in MB/s\n"
+            "                         (both for scenarios on card \"none\"; see --list)\n"
+            "  --batching MODE        SD write batching: adaptive (default) or fixed\n"
+            "  --max-latency-ms MS    latency bound of adaptive batching\n"
+            "  --list                 list scenarios\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* baseline_path = nullptr;
+    const char* update_path = nullptr;
+    std::string only;
+    BenchOptions opt;
+    HostStorageConfig& storage = opt.storage;
+    storage.root = "bench_sd";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (arg == "--list")
+        {
+            for (const Scenario& sc : SCENARIOS) printf("%-13s %-6s %s\n", sc.name, sc.card, sc.what);
+            return 0;
+        }
+        if (!val)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        i++;
+        if (arg == "--baseline") baseline_path = val;
+        else if (arg == "--update") update_path = val;
+        else if (arg == "--only") only = "," + std::string(val) + ",";
+        else if (arg == "--out") storage.root = val;
+        else if (arg == "--rx-queue") opt.rx_queue = (unsigned)strtoul(val, nullptr, 10);
+        else if (arg == "--write-latency-us") storage.write_latency_us = (uint32_t)strtoul(val, nullptr, 10);
+        else if (arg == "--write-mbps") storage.write_bytes_per_s = atof(val) * 1e6;
+        else if (arg == "--batching" && (strcmp(val, "adaptive") == 0 || strcmp(val, "fixed") == 0))
+        {
+            opt.adaptive = strcmp(val, "adaptive") == 0;
+        }
+        else if (arg == "--max-latency-ms") opt.max_latency_ms = (uint32_t)strtoul(val, nullptr, 10);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    std::string cmd = "mkdir -p '" + storage.root + "'";
+    if (system(cmd.c_str()) != 0) return 1;
+
+    std::map<std::string, Baseline> baselines;
+    if (baseline_path)
+    {
+        baselines = load_baselines(baseline_path);
+        if (baselines.empty()) return 1;
+    }
+
+    printf("%-13s %9s %8s %7s %7s %7s %7s %9s %9s %7s %6s %7s  %s\n", "scenario", "frames/s", "loss%", "p50ms",
+           "p90ms", "p99ms", "maxms", "rxwait99", "cpu_us/f", "KB/wr", "wr%", "csw/s", "verdict");
+    std::vector<std::pair<const Scenario*, Measurement>> results;
+    int failures = 0;
+    for (const Scenario& sc : SCENARIOS)
+    {
+        if (!only.empty() && only.find("," + std::string(sc.name) + ",") == std::string::npos) continue;
+
+        Measurement m{};
+        if (!run_scenario(sc, opt, &m))
+        {
+            printf("%-13s run failed\n", sc.name);
+            failures++;
+            continue;
+        }
+        results.emplace_back(&sc, m);
+
+        std::string verdict = "-";
+        auto it = baselines.find(sc.name);
+        if (it != baselines.end())
+        {
+            const Baseline& b = it->second;
+            verdict.clear();
+            if (m.fps < b.min_fps) verdict += " fps";
+            if (m.loss_pct > b.max_loss_pct) verdict += " loss";
+            if (m.p99_ms > b.max_p99_ms) verdict += " latency";
+            if (m.cpu_us_per_frame > b.max_cpu_us_per_frame) verdict += " cpu";
+            if (verdict.empty()) verdict = "ok";
+            else
+            {
+                verdict = "REGRESSION:" + verdict;
+                failures++;
+            }
+        }
+        printf("%-13s %9.0f %8.3f %7.1f %7.1f %7.1f %7.1f %9.2f %9.2f %7.1f %6.1f %7.0f  %s\n", sc.name, m.fps,
+               m.loss_pct, m.p50_ms, m.p90_ms, m.p99_ms, m.max_ms, m.rx_wait_p99_ms, m.cpu_us_per_frame,
+               m.kb_per_write, m.write_pct, m.csw_per_s, verdict.c_str());
+        fflush(stdout);
+    }
+
+    if (update_path)
+    {
+        if (!write_baselines(update_path, results))
+        {
+            fprintf(stderr, "cannot write %s\n", update_path);
+            return 1;
+        }
+        printf("baselines written to %s\n", update_path);
+    }
+    return failures ? 1 : 0;
+}
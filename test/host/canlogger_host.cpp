@@ -0,0 +1,178 @@
+// Host build of the logging pipeline: same tasks and queues as on the target, fed from a candump
+// replay or a synthetic generator and writing to a local directory.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "host_run.h"
+#include "logging.h"
+#include "param_table.h"
+#include "trace.h"
+#include "trigger.h"
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --out DIR              log directory (default host_sd)\n"
+            "  --replay FILE          replay a candump log instead of synthetic traffic\n"
+            "  --profile NAME         synthetic profile: %s\n"
+            "  --rate FPS             frames per second; 0 = recorded timing (replay) or as fast as\n"
+            "                         the pipeline takes them (synthetic)\n"
+            "  --frames N             stop after N frames\n"
+            "  --duration S           stop after S seconds\n"
+            "  --bitrate BPS          nominal bus bitrate (default 500000), sets the full-load rate\n"
+            "  --rx-queue N           simulated driver RX queue length (default 128, as on the target)\n"
+            "  --write-latency-us US  injected cost per storage write\n"
+            "  --write-mbps MB        storage bandwidth limit in MB/s\n"
+            "  --stall MS:US          the card pauses US microseconds every MS milliseconds\n"
+            "  --batching MODE        SD write batching: adaptive (default) or fixed\n"
+            "  --max-latency-ms MS    latency bound of adaptive batching\n"
+            "  --no-fsync             skip fsync on sync\n"
+            "  --trace FILE           write a latency trace of sampled frames to FILE (see canlog_trace)\n"
+            "  --trace-every N        trace every Nth frame (default 64)\n"
+            "  --trigger SPEC         trigger capture, TRIGGER.CFG lines separated by ';'\n"
+            "  --params               print the CANaerospace parameter table at the end\n"
+            "  --verbose              show warning/info log output\n",
+            argv0, host_source_profiles());
+}
+
+int main(int argc, char** argv)
+{
+    HostSourceConfig source;
+    HostStorageConfig storage;
+    double duration_s = 0;
+    bool adaptive = true;
+    uint32_t max_latency_ms = 0;
+    const char* trace_path = nullptr;
+    uint32_t trace_every = 64;
+    const char* trigger_spec = nullptr;
+    bool params = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        auto need = [&]() -> const char*
+        {
+            if (!val)
+            {
+                usage(argv[0]);
+                exit(2);
+            }
+            i++;
+            return val;
+        };
+        if (arg == "--out") storage.root = need();
+        else if (arg == "--replay") source.replay_path = need();
+        else if (arg == "--profile") source.profile = need();
+        else if (arg == "--rate") source.rate = atof(need());
+        else if (arg == "--frames") source.max_frames = strtoull(need(), nullptr, 10);
+        else if (arg == "--duration") duration_s = atof(need());
+        else if (arg == "--bitrate") source.bitrate = (uint32_t)strtoul(need(), nullptr, 10);
+        else if (arg == "--rx-queue") source.rx_queue_len = (unsigned)strtoul(need(), nullptr, 10);
+        else if (arg == "--write-latency-us") storage.write_latency_us = (uint32_t)strtoul(need(), nullptr, 10);
+        else if (arg == "--write-mbps") storage.write_bytes_per_s = atof(need()) * 1e6;
+        else if (arg == "--stall")
+        {
+            const char* v = need();
+            if (sscanf(v, "%u:%u", &storage.stall_every_ms, &storage.stall_us) != 2)
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (arg == "--batching")
+        {
+            std::string mode = need();
+            if (mode != "adaptive" && mode != "fixed")
+            {
+                usage(argv[0]);
+                return 2;
+            }
+            adaptive = mode == "adaptive";
+        }
+        else if (arg == "--max-latency-ms") max_latency_ms = (uint32_t)strtoul(need(), nullptr, 10);
+        else if (arg == "--no-fsync") storage.fsync = false;
+        else if (arg == "--trace") trace_path = need();
+        else if (arg == "--trace-every") trace_every = (uint32_t)strtoul(need(), nullptr, 10);
+        else if (arg == "--trigger") trigger_spec = need();
+        else if (arg == "--params") params = true;
+        else if (arg == "--verbose") shim_log_verbose = true;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (source.max_frames == 0 && duration_s <= 0 && source.replay_path.empty())
+    {
+        fprintf(stderr, "synthetic traffic needs --frames or --duration\n");
+        return 2;
+    }
+
+    logging_configure_batching(adaptive, max_latency_ms);
+    if (trigger_spec && !logging_configure_trigger(trigger_spec))
+    {
+        fprintf(stderr, "bad trigger configuration\n");
+        return 2;
+    }
+    if (trace_path && !trace_start(trace_every))
+    {
+        fprintf(stderr, "trace ring allocation failed\n");
+        return 1;
+    }
+    HostRunResult r;
+    if (!host_run(source, storage, duration_s, &r)) return 1;
+    if (trace_path)
+    {
+        FILE* f = fopen(trace_path, "wb");
+        auto write = [](void* ctx, const void* data, size_t len) { return fwrite(data, 1, len, (FILE*)ctx) == len; };
+        if (!f || !trace_dump(write, f) || fclose(f) != 0)
+        {
+            perror(trace_path);
+            return 1;
+        }
+    }
+
+    printf("elapsed_s=%.3f generated=%llu missed_rx=%llu logged=%lu dropped_can=%lu dropped_sd=%lu "
+           "bytes=%llu writes=%llu max_write_us=%llu fps=%.0f cpu_us_per_frame=%.2f ctx_switches=%llu "
+           "proc_wakeups=%lu writer_wakeups=%lu\n",
+           r.elapsed_s, (unsigned long long)r.generated, (unsigned long long)r.missed_rx, r.logged,
+           r.dropped_can, r.dropped_sd, (unsigned long long)r.bytes, (unsigned long long)r.writes,
+           (unsigned long long)r.max_write_us, r.elapsed_s > 0 ? r.logged / r.elapsed_s : 0.0,
+           r.logged ? (double)r.task_cpu_us / r.logged : 0.0, (unsigned long long)r.ctx_switches, r.proc_wakeups,
+           r.writer_wakeups);
+    if (trigger_spec)
+    {
+        TriggerStatus ts;
+        trigger_get_status(&ts);
+        printf("trigger: triggers=%lu windows=%lu committed=%lu lost=%lu\n", ts.triggers, ts.windows,
+               ts.committed, ts.lost);
+    }
+    if (params)
+    {
+        // The decoder task may not have seen the last frames yet
+        param_table_poll();
+        ParamTableStats st;
+        param_table_stats(&st);
+        printf("params: %u decoded=%lu ignored=%lu lost=%lu\n", st.params, st.decoded, st.ignored, st.lost);
+        param_table_foreach([](const ParamEntry* e, void*)
+        {
+            double v[4];
+            unsigned n = canas_values(e->hdr.data_type, e->payload, v);
+            printf("%03X node %u %s service %u code %u value", e->id, e->hdr.node_id, canas_type_name(e->hdr.data_type),
+                   e->hdr.service_code, e->hdr.message_code);
+            for (unsigned i = 0; i < n; i++) printf(" %.9g", v[i]);
+            printf(" rate %.1f Hz count %lu\n", e->period_us ? 1e6 / e->period_us : 0.0, (unsigned long)e->count);
+        }, nullptr);
+    }
+    fflush(stdout);
+
+    // The capture tasks never return; leave without running static destructors under them
+    _exit(0);
+}
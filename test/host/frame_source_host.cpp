@@ -0,0 +1,320 @@
+// Host implementation of frame_source.h: candump replay or synthetic traffic
+
+#include "frame_source.h"
+#include "host_source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "canparse.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char* TAG = "HOST_SRC";
+
+// A frame together with the time it appears on the bus, relative to the source start
+struct TimedFrame
+{
+    SourceFrame frame;
+    int64_t due_us;
+};
+
+class Generator
+{
+public:
+    virtual ~Generator() = default;
+    virtual bool next(TimedFrame* out) = 0;
+};
+
+// Nominal frame length on the wire without stuff bits, as counted for bus load in logging.cpp
+static double wire_time_us(bool extended, uint8_t dlc, uint32_t bitrate)
+{
+    return ((extended ? 67.0 : 47.0) + 8.0 * dlc) * 1000000.0 / bitrate;
+}
+
+// Deterministic synthetic traffic. Every profile except "mixed" uses cangen -I i -D i sequential
+// 11-bit IDs with the frame index as payload, so the result can be checked with check_canlog.
+//   seq    cangen -I i -D i -L 4 at a fixed rate
+//   burst  bursts of BURST_LEN back-to-back 8-byte frames, spaced so the average is the given rate
+//   full   back-to-back 8-byte frames: 100% bus load at the configured bitrate, rate is ignored
+//   mixed  alternating 11-bit and pseudo-random 29-bit IDs with DLC 1..8 at a fixed rate
+class SyntheticGenerator : public Generator
+{
+public:
+    static constexpr int BURST_LEN = 32;
+
+    SyntheticGenerator(const std::string& profile, double rate, uint32_t bitrate)
+        : mode_(parse(profile)), period_us_(rate > 0 ? 1000000.0 / rate : 0.0), bitrate_(bitrate)
+    {
+    }
+
+    static bool known(const std::string& profile)
+    {
+        return parse(profile) != UNKNOWN;
+    }
+
+    bool next(TimedFrame* out) override
+    {
+        SourceFrame& fr = out->frame;
+        uint32_t v = (uint32_t)n_;
+        fr.id = (uint32_t)(n_ & 0x7FF);
+        fr.extended = false;
+        fr.dlc = mode_ == SEQ ? 4 : 8;
+        memset(fr.data, 0, sizeof(fr.data));
+        memcpy(fr.data, &v, 4);
+
+        if (mode_ == MIXED && (n_ & 1))
+        {
+            lcg_ = lcg_ * 1664525u + 1013904223u;
+            fr.id = lcg_ >> 3;  // 29 bits
+            fr.extended = true;
+        }
+        if (mode_ == MIXED) fr.dlc = (uint8_t)(1 + n_ % 8);
+
+        double wire = wire_time_us(fr.extended, fr.dlc, bitrate_);
+        if (mode_ == FULL)
+        {
+            out->due_us = (int64_t)bus_us_;
+        }
+        else if (mode_ == BURST)
+        {
+            // Bursts cannot be denser than the bus, so a too-high rate degrades to full load
+            double burst_period = std::max(BURST_LEN * period_us_, BURST_LEN * wire);
+            out->due_us = (int64_t)((n_ / BURST_LEN) * burst_period + (n_ % BURST_LEN) * wire);
+        }
+        else
+        {
+            out->due_us = (int64_t)(n_ * period_us_);
+        }
+        bus_us_ += wire;
+        n_++;
+        return true;
+    }
+
+private:
+    enum Mode { SEQ, BURST, FULL, MIXED, UNKNOWN };
+
+    static Mode parse(const std::string& profile)
+    {
+        if (profile == "seq") return SEQ;
+        if (profile == "burst") return BURST;
+        if (profile == "full") return FULL;
+        if (profile == "mixed") return MIXED;
+        return UNKNOWN;
+    }
+
+    Mode mode_;
+    double period_us_;
+    uint32_t bitrate_;
+    double bus_us_ = 0;
+    uint32_t lcg_ = 12345;
+    uint64_t n_ = 0;
+};
+
+// candump log replay, uniform rate or recorded timing
+class ReplayGenerator : public Generator
+{
+public:
+    ReplayGenerator(CanLogReader* reader, double rate)
+        : reader_(reader), period_us_(rate > 0 ? 1000000.0 / rate : 0.0)
+    {
+    }
+    ~ReplayGenerator() override
+    {
+        canlog_reader_close(reader_);
+        delete reader_;
+    }
+
+    bool next(TimedFrame* out) override
+    {
+        if (pos_ == batch_.count)
+        {
+            if (!canlog_reader_next(reader_, &batch_)) return false;
+            pos_ = 0;
+        }
+        SourceFrame& fr = out->frame;
+        fr.id = batch_.id[pos_];
+        fr.extended = batch_.flags[pos_] & CANPARSE_EXTENDED;
+        fr.dlc = batch_.dlc[pos_];
+        memcpy(fr.data, &batch_.data[pos_], 8);
+        int64_t ts = batch_.ts_us[pos_];
+        pos_++;
+
+        if (n_ == 0) first_ts_ = ts;
+        out->due_us = period_us_ > 0 ? (int64_t)(n_ * period_us_) : ts - first_ts_;
+        n_++;
+        return true;
+    }
+
+private:
+    CanLogReader* reader_;
+    FrameBatch batch_;
+    size_t pos_ = 0;
+    double period_us_;
+    int64_t first_ts_ = 0;
+    uint64_t n_ = 0;
+};
+
+static HostSourceConfig g_config;
+static std::unique_ptr<Generator> g_gen;
+static TimedFrame g_next;
+static bool g_have_next = false;
+static std::deque<TimedFrame> g_rxq;
+static int64_t g_start_us = 0;
+static std::atomic<uint64_t> g_generated{0};
+static std::atomic<uint64_t> g_missed{0};
+static std::atomic<uint32_t> g_pending{0};     // g_rxq.size() for other threads
+static std::atomic<bool> g_finished{false};
+static bool g_flood = false;
+static std::mutex g_wait_lock;
+static std::vector<uint32_t> g_wait_us;
+
+void host_source_configure(const HostSourceConfig& config)
+{
+    g_config = config;
+}
+
+const char* host_source_profiles()
+{
+    return "seq burst full mixed";
+}
+
+uint64_t host_source_generated()
+{
+    return g_generated.load();
+}
+
+uint64_t host_source_missed()
+{
+    return g_missed.load();
+}
+
+bool host_source_finished()
+{
+    return g_finished.load();
+}
+
+std::vector<uint32_t> host_source_rx_wait_us()
+{
+    std::lock_guard<std::mutex> lock(g_wait_lock);
+    return g_wait_us;
+}
+
+static bool advance()
+{
+    if (g_config.max_frames && g_generated.load() >= g_config.max_frames)
+    {
+        g_have_next = false;
+    }
+    else
+    {
+        g_have_next = g_gen->next(&g_next);
+    }
+    if (!g_have_next)
+    {
+        g_finished = true;
+        return false;
+    }
+    g_generated++;
+    return true;
+}
+
+bool frame_source_start()
+{
+    if (!g_config.replay_path.empty())
+    {
+        auto* reader = new CanLogReader();
+        if (!canlog_reader_open(g_config.replay_path.c_str(), reader))
+        {
+            ESP_LOGE(TAG, "cannot open %s", g_config.replay_path.c_str());
+            delete reader;
+            return false;
+        }
+        g_gen = std::make_unique<ReplayGenerator>(reader, g_config.rate);
+    }
+    else if (SyntheticGenerator::known(g_config.profile))
+    {
+        g_gen = std::make_unique<SyntheticGenerator>(g_config.profile, g_config.rate, g_config.bitrate);
+        // Without a rate every frame is due at once: the source then only fills the RX queue as
+        // fast as CAN_RX drains it, which measures the pipeline capacity instead of bus loss
+        g_flood = g_config.rate <= 0 && g_config.profile != "full";
+    }
+    else
+    {
+        ESP_LOGE(TAG, "unknown profile '%s' (have: %s)", g_config.profile.c_str(), host_source_profiles());
+        return false;
+    }
+    advance();
+    return true;
+}
+
+// Move every frame that is due by now into the simulated driver RX queue. Like the TWAI ISR, a frame
+// that finds the queue full is lost.
+static void deliver_due(int64_t now_us)
+{
+    while (g_have_next && g_next.due_us <= now_us)
+    {
+        if (g_rxq.size() < g_config.rx_queue_len) g_rxq.push_back(g_next);
+        else if (g_flood) break;
+        else g_missed++;
+        advance();
+    }
+    g_pending = (uint32_t)g_rxq.size();
+}
+
+// Called only from CAN_RX, so the generator state needs no locking
+bool frame_source_receive(SourceFrame* frame, uint32_t timeout_ms)
+{
+    const int64_t give_up = timeout_ms == FRAME_SOURCE_WAIT_FOREVER
+                                ? INT64_MAX
+                                : esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    // Traffic starts when CAN_RX first listens, not at bring-up, so task start-up is not counted as loss
+    if (g_start_us == 0) g_start_us = esp_timer_get_time();
+    while (true)
+    {
+        deliver_due(esp_timer_get_time() - g_start_us);
+        if (!g_rxq.empty())
+        {
+            const TimedFrame& tf = g_rxq.front();
+            *frame = tf.frame;
+            if (!g_flood)
+            {
+                std::lock_guard<std::mutex> lock(g_wait_lock);
+                g_wait_us.push_back((uint32_t)std::max<int64_t>(0, esp_timer_get_time() - g_start_us - tf.due_us));
+            }
+            g_rxq.pop_front();
+            g_pending = (uint32_t)g_rxq.size();
+            return true;
+        }
+
+        int64_t now = esp_timer_get_time();
+        int64_t wake = g_have_next ? g_start_us + g_next.due_us : give_up;
+        if (wake > give_up) wake = give_up;
+        if (now >= give_up) return false;
+        if (wake > now) std::this_thread::sleep_for(std::chrono::microseconds(std::min<int64_t>(wake - now, 100000)));
+    }
+}
+
+uint32_t frame_source_bitrate()
+{
+    return g_config.bitrate;
+}
+
+// The simulated controller never overruns or sees bus errors; only the RX queue can lose frames
+bool frame_source_status(SourceStatus* out)
+{
+    *out = SourceStatus{};
+    out->state = SOURCE_RUNNING;
+    out->rx_pending = g_pending.load();
+    out->rx_missed = (uint32_t)g_missed.load();
+    return true;
+}
@@ -0,0 +1,80 @@
+#include "host_run.h"
+
+#include <chrono>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "logging.h"
+
+static uint64_t process_ctx_switches()
+{
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return (uint64_t)ru.ru_nvcsw + (uint64_t)ru.ru_nivcsw;
+}
+
+bool host_run(const HostSourceConfig& source, const HostStorageConfig& storage, double duration_s,
+              HostRunResult* out)
+{
+    mkdir(storage.root.c_str(), 0755);
+    host_source_configure(source);
+    host_storage_configure(storage);
+
+    int64_t t0 = esp_timer_get_time();
+    uint64_t csw0 = process_ctx_switches();
+    if (!logging_start()) return false;
+
+    // Done once the source is finished and nothing moved for 100 ms
+    uint32_t last_bytes = 0;
+    int64_t last_progress = t0;
+    int stable_ticks = 0;
+    while (true)
+    {
+        logging_housekeeping();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        int64_t now = esp_timer_get_time();
+        LoggingStats st;
+        get_logging_stats(&st);
+        if (st.bytes_written != last_bytes) last_progress = now;
+
+        if (duration_s > 0 && now - t0 >= (int64_t)(duration_s * 1000000)) break;
+        if (!host_source_finished())
+        {
+            last_bytes = st.bytes_written;
+            continue;
+        }
+
+        bool idle = st.can_queue_used == 0 && st.sd_queue_used == 0 && st.batch_pending == 0 &&
+                    st.bytes_written == last_bytes;
+        last_bytes = st.bytes_written;
+        stable_ticks = idle ? stable_ticks + 1 : 0;
+        if (stable_ticks >= 10) break;
+    }
+    uint64_t csw1 = process_ctx_switches();
+    logging_flush();
+
+    LoggingStats st;
+    get_logging_stats(&st);
+    HostStorageStats io = host_storage_stats();
+    out->elapsed_s = (last_progress - t0) / 1e6;
+    out->generated = host_source_generated();
+    out->missed_rx = host_source_missed();
+    out->logged = st.frames;
+    out->dropped_can = st.dropped_can;
+    out->dropped_sd = st.dropped_sd;
+    out->bytes = io.bytes;
+    out->writes = io.writes;
+    out->write_us = io.write_us;
+    out->max_write_us = io.max_write_us;
+    uint64_t cpu = shim_tasks_cpu_us();
+    out->task_cpu_us = cpu > io.trace_cpu_us ? cpu - io.trace_cpu_us : 0;
+    out->ctx_switches = csw1 - csw0;
+    out->proc_wakeups = st.proc_wakeups;
+    out->writer_wakeups = st.writer_wakeups;
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+#include "host_source.h"
+#include "host_storage.h"
+
+struct HostRunResult
+{
+    double elapsed_s;       // start until the last frame reached storage
+    uint64_t generated;
+    uint64_t missed_rx;     // lost in the simulated driver RX queue
+    unsigned long logged;
+    unsigned long dropped_can;
+    unsigned long dropped_sd;
+    uint64_t bytes;
+    uint64_t writes;
+    uint64_t write_us;      // time spent in storage writes
+    uint64_t max_write_us;
+    uint64_t task_cpu_us;   // CPU of the capture tasks, latency tracing excluded
+    uint64_t ctx_switches;  // voluntary + involuntary context switches of the whole process
+    unsigned long proc_wakeups;
+    unsigned long writer_wakeups;
+};
+
+// Start the logging pipeline and run it until the source is exhausted and everything is written,
+// or for duration_s seconds if that is > 0. The capture tasks cannot be stopped, so this can be
+// called only once per process.
+bool host_run(const HostSourceConfig& source, const HostStorageConfig& storage, double duration_s,
+              HostRunResult* out);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Host frame source: replays a candump file or generates synthetic traffic with the given timing.
+// Frames that are due but not picked up by CAN_RX are held in a small queue like the TWAI driver's
+// RX queue; once it is full the oldest frames are counted as missed.
+struct HostSourceConfig
+{
+    std::string replay_path;      // candump file; empty = synthetic traffic
+    std::string profile = "seq";  // synthetic profile, see host_source_profiles()
+    double rate = 1000.0;         // frames per second; 0 = recorded timing (replay) or as fast as
+                                  // CAN_RX takes them (synthetic, no RX loss)
+    uint64_t max_frames = 0;      // stop after this many frames (0 = no limit)
+    uint32_t bitrate = 500000;
+    unsigned rx_queue_len = 128;  // CAN_DRIVER_RX_QUEUE_LEN in frame_source_twai.cpp
+};
+
+void host_source_configure(const HostSourceConfig& config);
+
+// Space-separated list of synthetic profile names
+const char* host_source_profiles();
+
+uint64_t host_source_generated();
+uint64_t host_source_missed();
+bool host_source_finished();
+
+// Time each frame waited between appearing on the bus and CAN_RX picking it up
+std::vector<uint32_t> host_source_rx_wait_us();
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Host storage backend: a plain directory, with optional injected write latency to mimic an SD card
+struct HostStorageConfig
+{
+    std::string root = "host_sd";
+    uint32_t write_latency_us = 0;   // fixed cost per write call
+    double write_bytes_per_s = 0;    // bandwidth limit, 0 = unlimited
+    bool fsync = true;               // make storage_sync() durable
+    bool trace_latency = false;      // time every written log line against its timestamp
+    uint32_t write_unit = 32 * 1024; // reported cluster size
+    uint32_t stall_every_ms = 0;     // a write this long after the previous stall also pays stall_us,
+    uint32_t stall_us = 0;           // like an SD card's internal garbage collection
+};
+
+void host_storage_configure(const HostStorageConfig& config);
+
+struct HostStorageStats
+{
+    uint64_t writes;
+    uint64_t bytes;
+    uint64_t write_us;      // time spent inside storage_write, including injected latency
+    uint64_t max_write_us;
+    uint64_t trace_cpu_us;  // CPU spent on latency tracing, to be left out of pipeline cost
+};
+
+HostStorageStats host_storage_stats();
+
+// With trace_latency: per log line, time from the frame timestamp until the write containing it completed
+std::vector<uint32_t> host_storage_latency_us();
@@ -0,0 +1,16 @@
+#pragma once
+
+// Host build: the subset of ESP-IDF error codes used by the logging pipeline
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+#define ESP_OK          0
+#define ESP_FAIL        -1
+#define ESP_ERR_NO_MEM  0x101
+
+inline const char* esp_err_to_name(esp_err_t err)
+{
+    return err == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
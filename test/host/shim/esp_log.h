@@ -0,0 +1,17 @@
+#pragma once
+
+// Host build: ESP_LOGx print to stderr; warning/info output is controlled by shim_log_verbose
+
+#include <cstdio>
+#include "esp_err.h"
+
+extern bool shim_log_verbose;
+long long shim_log_time_ms();
+
+#define SHIM_LOG(level, tag, fmt, ...) \
+    fprintf(stderr, level " (%lld) %s: " fmt "\n", shim_log_time_ms(), tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, fmt, ...) SHIM_LOG("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) do { if (shim_log_verbose) SHIM_LOG("W", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGI(tag, fmt, ...) do { if (shim_log_verbose) SHIM_LOG("I", tag, fmt, ##__VA_ARGS__); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { } while (0)
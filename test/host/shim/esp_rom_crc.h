@@ -0,0 +1,12 @@
+#pragma once
+
+// Host build: the ROM CRC routine from the host CRC library (same values)
+
+#include <cstdint>
+
+#include "crc32.h"
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len)
+{
+    return crc32_update(crc, buf, len);
+}
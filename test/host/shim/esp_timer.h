@@ -0,0 +1,7 @@
+#pragma once
+
+// Host build: monotonic microseconds since process start
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
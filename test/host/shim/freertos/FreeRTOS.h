@@ -0,0 +1,39 @@
+#pragma once
+
+// Host build: FreeRTOS types and macros on top of std::thread.
+// The tick rate matches CONFIG_FREERTOS_HZ of the firmware so tick rounding behaves the same.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define configTICK_RATE_HZ   100
+#define configMAX_PRIORITIES 25
+#define portTICK_PERIOD_MS   (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY        ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)    ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTRUE               1
+#define pdFALSE              0
+#define pdPASS               pdTRUE
+#define pdFAIL               pdFALSE
+#define tskNO_AFFINITY       0x7FFFFFFF
+
+typedef struct
+{
+    std::atomic_flag flag;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {ATOMIC_FLAG_INIT}
+#define portMUX_INITIALIZE(mux) ((mux)->flag.clear())
+
+void shim_enter_critical(portMUX_TYPE* mux);
+void shim_exit_critical(portMUX_TYPE* mux);
+
+#define taskENTER_CRITICAL(mux) shim_enter_critical(mux)
+#define taskEXIT_CRITICAL(mux)  shim_exit_critical(mux)
+#define portENTER_CRITICAL(mux) shim_enter_critical(mux)
+#define portEXIT_CRITICAL(mux)  shim_exit_critical(mux)
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host build: bounded copy-in/copy-out queues with FreeRTOS semantics
+
+#include "freertos/FreeRTOS.h"
+
+struct ShimQueue;
+typedef ShimQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue);
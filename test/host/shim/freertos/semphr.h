@@ -0,0 +1,12 @@
+#pragma once
+
+// Host build: mutexes only
+
+#include "freertos/FreeRTOS.h"
+
+struct ShimMutex;
+typedef ShimMutex* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex);
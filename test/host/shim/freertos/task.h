@@ -0,0 +1,29 @@
+#pragma once
+
+// Host build: tasks are detached std::threads; priorities map to nice values, core affinity is ignored
+
+#include "freertos/FreeRTOS.h"
+
+struct ShimTask;
+typedef ShimTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg, UBaseType_t priority,
+                       TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void taskYIELD();
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_woken);
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Host only: CPU time consumed so far by all tasks created with xTaskCreate (not the main thread)
+uint64_t shim_tasks_cpu_us();
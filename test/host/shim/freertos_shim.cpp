@@ -0,0 +1,304 @@
+// Host build: implementation of the FreeRTOS / ESP-IDF subset declared in this directory
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+bool shim_log_verbose = false;
+
+static const auto g_start = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_start).count();
+}
+
+long long shim_log_time_ms()
+{
+    return esp_timer_get_time() / 1000;
+}
+
+void shim_enter_critical(portMUX_TYPE* mux)
+{
+    while (mux->flag.test_and_set(std::memory_order_acquire))
+    {
+    }
+}
+
+void shim_exit_critical(portMUX_TYPE* mux)
+{
+    mux->flag.clear(std::memory_order_release);
+}
+
+// -----------------------------
+// Time
+// -----------------------------
+static std::chrono::steady_clock::time_point deadline(TickType_t ticks)
+{
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return (TickType_t)(esp_timer_get_time() / 1000 / portTICK_PERIOD_MS);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0)
+    {
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds((uint64_t)ticks * portTICK_PERIOD_MS));
+}
+
+void vTaskDelayUntil(TickType_t* previous_wake, TickType_t increment)
+{
+    *previous_wake += increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previous_wake - now) > 0) vTaskDelay(*previous_wake - now);
+}
+
+void taskYIELD()
+{
+    std::this_thread::yield();
+}
+
+// -----------------------------
+// Tasks
+// -----------------------------
+struct ShimTask
+{
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notify = 0;
+    clockid_t cpu_clock{};
+    bool running = false;
+};
+
+static thread_local ShimTask* t_current = nullptr;
+static std::mutex g_tasks_lock;
+static std::vector<ShimTask*> g_tasks;
+
+uint64_t shim_tasks_cpu_us()
+{
+    std::lock_guard<std::mutex> lock(g_tasks_lock);
+    uint64_t total = 0;
+    for (ShimTask* task : g_tasks)
+    {
+        timespec ts{};
+        if (task->running && clock_gettime(task->cpu_clock, &ts) == 0)
+        {
+            total += (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+        }
+    }
+    return total;
+}
+
+// Higher FreeRTOS priorities get a lower nice value, so on a loaded (or single core) host CAN_RX still
+// preempts the writer roughly like on the target. Failing to renice is harmless.
+static int nice_for_priority(UBaseType_t priority)
+{
+    return priority >= 5 ? 0 : (int)(5 - priority) * 3;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t, void* arg, UBaseType_t priority,
+                       TaskHandle_t* handle)
+{
+    auto* task = new ShimTask();
+    if (handle) *handle = task;
+    std::thread([fn, arg, task, priority, n = std::string(name)]()
+    {
+        pthread_setname_np(pthread_self(), n.substr(0, 15).c_str());
+        setpriority(PRIO_PROCESS, (id_t)gettid(), nice_for_priority(priority));
+        {
+            std::lock_guard<std::mutex> lock(g_tasks_lock);
+            task->running = pthread_getcpuclockid(pthread_self(), &task->cpu_clock) == 0;
+            g_tasks.push_back(task);
+        }
+        t_current = task;
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack_depth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t)
+{
+    return xTaskCreate(fn, name, stack_depth, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr || task == t_current)
+    {
+        if (t_current)
+        {
+            std::lock_guard<std::mutex> lock(g_tasks_lock);
+            t_current->running = false;
+        }
+        pthread_exit(nullptr);
+    }
+    // deleting another task is not supported off-target
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    return t_current;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    ShimTask* task = t_current;
+    if (!task) return 0;
+    std::unique_lock<std::mutex> lock(task->m);
+    if (ticks == portMAX_DELAY)
+    {
+        task->cv.wait(lock, [task] { return task->notify > 0; });
+    }
+    else
+    {
+        task->cv.wait_until(lock, deadline(ticks), [task] { return task->notify > 0; });
+    }
+    uint32_t value = task->notify;
+    if (value > 0) task->notify = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    if (!task) return pdFAIL;
+    {
+        std::lock_guard<std::mutex> lock(task->m);
+        task->notify++;
+    }
+    task->cv.notify_one();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higher_priority_woken)
+{
+    xTaskNotifyGive(task);
+    if (higher_priority_woken) *higher_priority_woken = pdFALSE;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t)
+{
+    return 0;
+}
+
+// -----------------------------
+// Queues
+// -----------------------------
+struct ShimQueue
+{
+    std::mutex m;
+    std::condition_variable not_empty;
+    std::condition_variable not_full;
+    std::vector<uint8_t> buf;
+    size_t item_size;
+    size_t length;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    auto* q = new ShimQueue();
+    q->buf.resize((size_t)length * item_size);
+    q->item_size = item_size;
+    q->length = length;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(q->m);
+    auto has_space = [q] { return q->count < q->length; };
+    if (ticks == portMAX_DELAY) q->not_full.wait(lock, has_space);
+    else if (!q->not_full.wait_until(lock, deadline(ticks), has_space)) return pdFALSE;
+
+    size_t tail = (q->head + q->count) % q->length;
+    memcpy(&q->buf[tail * q->item_size], item, q->item_size);
+    q->count++;
+    lock.unlock();
+    q->not_empty.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(q->m);
+    auto has_item = [q] { return q->count > 0; };
+    if (ticks == portMAX_DELAY) q->not_empty.wait(lock, has_item);
+    else if (!q->not_empty.wait_until(lock, deadline(ticks), has_item)) return pdFALSE;
+
+    memcpy(item, &q->buf[q->head * q->item_size], q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    lock.unlock();
+    q->not_full.notify_one();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> lock(q->m);
+    return q->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t q)
+{
+    std::lock_guard<std::mutex> lock(q->m);
+    return q->length - q->count;
+}
+
+// -----------------------------
+// Mutexes
+// -----------------------------
+struct ShimMutex
+{
+    std::timed_mutex m;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    return new ShimMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        mutex->m.lock();
+        return pdTRUE;
+    }
+    return mutex->m.try_lock_until(deadline(ticks)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    mutex->m.unlock();
+    return pdTRUE;
+}
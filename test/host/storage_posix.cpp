@@ -0,0 +1,125 @@
+// Host implementation of storage.h on a POSIX directory
+
+#include "storage.h"
+#include "host_storage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include "esp_timer.h"
+#include "logging.h"
+
+static HostStorageConfig g_config;
+static std::atomic<uint64_t> g_writes{0};
+static std::atomic<uint64_t> g_bytes{0};
+static std::atomic<uint64_t> g_write_us{0};
+static std::atomic<uint64_t> g_max_write_us{0};
+static std::atomic<uint64_t> g_trace_cpu_us{0};
+static std::mutex g_latency_lock;
+static std::vector<uint32_t> g_latency_us;
+static int64_t g_last_stall_us = 0;     // SD_Writer only
+
+void host_storage_configure(const HostStorageConfig& config)
+{
+    g_config = config;
+}
+
+HostStorageStats host_storage_stats()
+{
+    return {g_writes.load(), g_bytes.load(), g_write_us.load(), g_max_write_us.load(), g_trace_cpu_us.load()};
+}
+
+std::vector<uint32_t> host_storage_latency_us()
+{
+    std::lock_guard<std::mutex> lock(g_latency_lock);
+    return g_latency_us;
+}
+
+static uint64_t thread_cpu_us()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// Frame lines start with "(<seconds>.<micros>)"; header and marker lines are skipped
+static void trace_lines(const char* data, size_t len, int64_t now_us)
+{
+    uint64_t cpu0 = thread_cpu_us();
+    const char* p = data;
+    const char* end = data + len;
+    std::lock_guard<std::mutex> lock(g_latency_lock);
+    while (p < end)
+    {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        if (!nl) break;
+        if (*p == '(')
+        {
+            double ts = strtod(p + 1, nullptr);
+            int64_t ts_us = (int64_t)((ts - FICTIONAL_START_TIME) * 1000000.0 + 0.5);
+            g_latency_us.push_back((uint32_t)std::max<int64_t>(0, now_us - ts_us));
+        }
+        p = nl + 1;
+    }
+    g_trace_cpu_us += thread_cpu_us() - cpu0;
+}
+
+const char* storage_root()
+{
+    return g_config.root.c_str();
+}
+
+bool storage_info(uint64_t* total_bytes, uint64_t* free_bytes)
+{
+    struct statvfs st{};
+    if (statvfs(g_config.root.c_str(), &st) != 0) return false;
+    *total_bytes = (uint64_t)st.f_blocks * st.f_frsize;
+    *free_bytes = (uint64_t)st.f_bavail * st.f_frsize;
+    return true;
+}
+
+size_t storage_write(FILE* f, const void* data, size_t len)
+{
+    int64_t t0 = esp_timer_get_time();
+    size_t written = fwrite(data, 1, len, f);
+
+    int64_t delay_us = g_config.write_latency_us;
+    if (g_config.write_bytes_per_s > 0) delay_us += (int64_t)(len * 1000000.0 / g_config.write_bytes_per_s);
+    if (g_config.stall_every_ms && t0 - g_last_stall_us >= (int64_t)g_config.stall_every_ms * 1000)
+    {
+        delay_us += g_config.stall_us;
+        g_last_stall_us = t0;
+    }
+    if (delay_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+
+    int64_t t1 = esp_timer_get_time();
+    uint64_t took = (uint64_t)(t1 - t0);
+    if (g_config.trace_latency) trace_lines((const char*)data, written, t1);
+    g_writes++;
+    g_bytes += written;
+    g_write_us += took;
+    uint64_t prev = g_max_write_us.load();
+    while (took > prev && !g_max_write_us.compare_exchange_weak(prev, took))
+    {
+    }
+    return written;
+}
+
+size_t storage_write_unit()
+{
+    return g_config.write_unit;
+}
+
+void storage_sync(FILE* f)
+{
+    fflush(f);
+    if (g_config.fsync) fsync(fileno(f));
+}
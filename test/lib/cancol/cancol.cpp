@@ -0,0 +1,307 @@
+#include "cancol.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// -----------------------------
+// Encoding
+// -----------------------------
+static void put_varint(std::vector<uint8_t>* out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out->push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out->push_back((uint8_t)v);
+}
+
+static void put_i64(std::vector<uint8_t>* out, int64_t v)
+{
+    uint8_t b[8];
+    memcpy(b, &v, 8);
+    out->insert(out->end(), b, b + 8);
+}
+
+static void encode_u8(const std::vector<uint8_t>& values, CancolColumnMeta* meta, std::vector<uint8_t>* out)
+{
+    auto [lo, hi] = std::minmax_element(values.begin(), values.end());
+    meta->min = *lo;
+    meta->max = *hi;
+    if (meta->min == meta->max)
+    {
+        meta->encoding = CANCOL_ENC_CONSTANT;
+        return;
+    }
+    meta->encoding = CANCOL_ENC_PLAIN_U8;
+    *out = values;
+}
+
+static void encode_delta(const std::vector<int64_t>& ts, CancolColumnMeta* meta, std::vector<uint8_t>* out)
+{
+    auto [lo, hi] = std::minmax_element(ts.begin(), ts.end());
+    meta->min = *lo;
+    meta->max = *hi;
+    if (meta->min == meta->max)
+    {
+        meta->encoding = CANCOL_ENC_CONSTANT;
+        return;
+    }
+    meta->encoding = CANCOL_ENC_DELTA_VARINT;
+    out->reserve(8 + ts.size() * 2);
+    put_i64(out, ts[0]);
+    for (size_t i = 1; i < ts.size(); i++)
+    {
+        int64_t d = ts[i] - ts[i - 1];
+        put_varint(out, (uint64_t)((d << 1) ^ (d >> 63)));
+    }
+}
+
+void cancol_encode(const CancolIdFrames& frames, CancolEncodedChunk* out)
+{
+    out->meta.id = frames.id;
+    out->meta.flags = frames.flags;
+    out->meta.count = frames.ts_us.size();
+    encode_delta(frames.ts_us, &out->meta.columns[CANCOL_TS], &out->bytes[CANCOL_TS]);
+    encode_delta(frames.seq, &out->meta.columns[CANCOL_SEQ], &out->bytes[CANCOL_SEQ]);
+    encode_u8(frames.dlc, &out->meta.columns[CANCOL_DLC], &out->bytes[CANCOL_DLC]);
+
+    std::vector<uint8_t> column(frames.data.size());
+    for (int b = 0; b < 8; b++)
+    {
+        for (size_t i = 0; i < frames.data.size(); i++) column[i] = (uint8_t)(frames.data[i] >> (8 * b));
+        encode_u8(column, &out->meta.columns[CANCOL_B0 + b], &out->bytes[CANCOL_B0 + b]);
+    }
+}
+
+// -----------------------------
+// Writer
+// -----------------------------
+static bool write_all(CancolWriter* w, const void* data, size_t len)
+{
+    if (len == 0) return true;
+    if (fwrite(data, 1, len, w->f) != len) return false;
+    w->offset += len;
+    return true;
+}
+
+bool cancol_writer_open(const char* path, uint32_t window_s, CancolWriter* w)
+{
+    w->f = fopen(path, "wb");
+    if (!w->f) return false;
+    setvbuf(w->f, nullptr, _IOFBF, 1 << 20);
+    w->offset = 0;
+    w->window_s = window_s;
+    w->row_groups.clear();
+    return write_all(w, CANCOL_MAGIC, 8);
+}
+
+bool cancol_write_row_group(CancolWriter* w, std::vector<CancolEncodedChunk>& chunks)
+{
+    CancolRowGroupMeta rg;
+    rg.t_min_us = INT64_MAX;
+    rg.t_max_us = INT64_MIN;
+    rg.frames = 0;
+    for (CancolEncodedChunk& c : chunks)
+    {
+        for (int col = 0; col < CANCOL_COLUMNS; col++)
+        {
+            c.meta.columns[col].offset = w->offset;
+            c.meta.columns[col].size = (uint32_t)c.bytes[col].size();
+            if (!write_all(w, c.bytes[col].data(), c.bytes[col].size())) return false;
+        }
+        rg.t_min_us = std::min(rg.t_min_us, c.meta.columns[CANCOL_TS].min);
+        rg.t_max_us = std::max(rg.t_max_us, c.meta.columns[CANCOL_TS].max);
+        rg.frames += c.meta.count;
+        rg.chunks.push_back(c.meta);
+    }
+    if (!rg.chunks.empty()) w->row_groups.push_back(std::move(rg));
+    return true;
+}
+
+bool cancol_writer_close(CancolWriter* w)
+{
+    std::vector<uint8_t> footer;
+    auto put = [&footer](const void* p, size_t n)
+    {
+        footer.insert(footer.end(), (const uint8_t*)p, (const uint8_t*)p + n);
+    };
+    const uint8_t pad[3] = {0, 0, 0};
+    uint32_t version = CANCOL_VERSION;
+    uint32_t groups = (uint32_t)w->row_groups.size();
+    put(&version, 4);
+    put(&w->window_s, 4);
+    put(&groups, 4);
+    for (const CancolRowGroupMeta& rg : w->row_groups)
+    {
+        uint32_t chunks = (uint32_t)rg.chunks.size();
+        put(&rg.t_min_us, 8);
+        put(&rg.t_max_us, 8);
+        put(&rg.frames, 8);
+        put(&chunks, 4);
+        for (const CancolChunkMeta& c : rg.chunks)
+        {
+            put(&c.id, 4);
+            put(&c.flags, 1);
+            put(pad, 3);
+            put(&c.count, 8);
+            for (const CancolColumnMeta& col : c.columns)
+            {
+                put(&col.offset, 8);
+                put(&col.size, 4);
+                put(&col.encoding, 1);
+                put(pad, 3);
+                put(&col.min, 8);
+                put(&col.max, 8);
+            }
+        }
+    }
+    uint64_t footer_size = footer.size();
+    bool ok = write_all(w, footer.data(), footer.size()) && write_all(w, &footer_size, 8) &&
+              write_all(w, CANCOL_MAGIC, 8);
+    ok = fclose(w->f) == 0 && ok;
+    w->f = nullptr;
+    return ok;
+}
+
+// -----------------------------
+// Reader
+// -----------------------------
+struct FooterReader
+{
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    template <typename T> T get()
+    {
+        T v{};
+        if (end - p < (std::ptrdiff_t)sizeof(T))
+        {
+            ok = false;
+            return v;
+        }
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return v;
+    }
+    void skip(size_t n)
+    {
+        if ((size_t)(end - p) < n) ok = false;
+        else p += n;
+    }
+};
+
+bool cancol_open(const char* path, CancolFile* file)
+{
+    file->f = fopen(path, "rb");
+    if (!file->f) return false;
+
+    char magic[8];
+    uint64_t footer_size = 0;
+    if (fread(magic, 1, 8, file->f) != 8 || memcmp(magic, CANCOL_MAGIC, 8) != 0 ||
+        fseeko(file->f, -16, SEEK_END) != 0 || fread(&footer_size, 8, 1, file->f) != 1 ||
+        fread(magic, 1, 8, file->f) != 8 || memcmp(magic, CANCOL_MAGIC, 8) != 0 ||
+        fseeko(file->f, -16 - (off_t)footer_size, SEEK_END) != 0)
+    {
+        cancol_close(file);
+        return false;
+    }
+    std::vector<uint8_t> footer(footer_size);
+    if (fread(footer.data(), 1, footer_size, file->f) != footer_size)
+    {
+        cancol_close(file);
+        return false;
+    }
+
+    FooterReader r{footer.data(), footer.data() + footer.size()};
+    uint32_t version = r.get<uint32_t>();
+    file->window_s = r.get<uint32_t>();
+    uint32_t groups = r.get<uint32_t>();
+    for (uint32_t g = 0; r.ok && g < groups; g++)
+    {
+        CancolRowGroupMeta rg;
+        rg.t_min_us = r.get<int64_t>();
+        rg.t_max_us = r.get<int64_t>();
+        rg.frames = r.get<uint64_t>();
+        uint32_t chunks = r.get<uint32_t>();
+        for (uint32_t c = 0; r.ok && c < chunks; c++)
+        {
+            CancolChunkMeta m{};
+            m.id = r.get<uint32_t>();
+            m.flags = r.get<uint8_t>();
+            r.skip(3);
+            m.count = r.get<uint64_t>();
+            for (CancolColumnMeta& col : m.columns)
+            {
+                col.offset = r.get<uint64_t>();
+                col.size = r.get<uint32_t>();
+                col.encoding = r.get<uint8_t>();
+                r.skip(3);
+                col.min = r.get<int64_t>();
+                col.max = r.get<int64_t>();
+            }
+            rg.chunks.push_back(m);
+        }
+        file->row_groups.push_back(std::move(rg));
+    }
+    if (!r.ok || version != CANCOL_VERSION)
+    {
+        cancol_close(file);
+        return false;
+    }
+    return true;
+}
+
+void cancol_close(CancolFile* file)
+{
+    if (file->f) fclose(file->f);
+    *file = CancolFile{};
+}
+
+bool cancol_read_column(CancolFile* file, const CancolChunkMeta& chunk, int column, std::vector<int64_t>* out)
+{
+    const CancolColumnMeta& col = chunk.columns[column];
+    out->assign(chunk.count, col.min);
+    if (col.encoding == CANCOL_ENC_CONSTANT) return true;
+
+    std::vector<uint8_t> buf(col.size);
+    if (fseeko(file->f, (off_t)col.offset, SEEK_SET) != 0 ||
+        fread(buf.data(), 1, buf.size(), file->f) != buf.size())
+    {
+        return false;
+    }
+    file->bytes_read += buf.size();
+
+    if (col.encoding == CANCOL_ENC_PLAIN_U8)
+    {
+        if (buf.size() != chunk.count) return false;
+        for (size_t i = 0; i < buf.size(); i++) (*out)[i] = buf[i];
+        return true;
+    }
+    if (col.encoding == CANCOL_ENC_DELTA_VARINT)
+    {
+        if (buf.size() < 8 || chunk.count == 0) return false;
+        int64_t v;
+        memcpy(&v, buf.data(), 8);
+        (*out)[0] = v;
+        size_t pos = 8;
+        for (size_t i = 1; i < chunk.count; i++)
+        {
+            uint64_t z = 0;
+            int shift = 0;
+            while (pos < buf.size() && shift < 64)
+            {
+                uint8_t b = buf[pos++];
+                z |= (uint64_t)(b & 0x7F) << shift;
+                shift += 7;
+                if (!(b & 0x80)) break;
+            }
+            v += (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+            (*out)[i] = v;
+        }
+        return pos == buf.size();
+    }
+    return false;
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+// CANCOL: a small columnar file format for CAN logs.
+//
+// Arrow/Parquet would pull in a large dependency for what the logs need, so the layout follows the
+// Parquet idea with just the parts we use: the file is cut into row groups of one time window each;
+// inside a row group every CAN ID has its own column chunk set (timestamp, position in the log, DLC,
+// payload bytes 0..7),
+// and the footer carries offsets and min/max statistics of every column chunk. A query reads the
+// footer and then only the column chunks of the IDs and time windows it needs.
+//
+// File layout, little endian:
+//
+//     "CANCOL1\0"                       magic
+//     column chunk data ...             encoded columns, in footer order
+//     footer                            see below
+//     uint64 footer_size
+//     "CANCOL1\0"                       magic
+//
+// Footer:
+//
+//     uint32 version (1)  uint32 window_s  uint32 row_groups
+//     per row group:
+//         int64 t_min_us  int64 t_max_us  uint64 frames  uint32 chunks
+//         per ID chunk (ascending ID):
+//             uint32 id  uint8 flags (CANCOL_EXTENDED)  uint8 pad[3]  uint64 count
+//             per column (CANCOL_COLUMNS, order of CancolColumn):
+//                 uint64 offset  uint32 size  uint8 encoding  uint8 pad[3]  int64 min  int64 max
+//
+// Encodings:
+//     CANCOL_ENC_CONSTANT      no data, every value equals min (== max)
+//     CANCOL_ENC_PLAIN_U8      one byte per value (DLC, payload bytes)
+//     CANCOL_ENC_DELTA_VARINT  first value as int64, then zigzag LEB128 deltas (timestamps, sequence)
+//
+// The sequence column holds each frame's index within its row group, so a reader can restore the
+// original log order, including timestamps that step back.
+// Payload bytes beyond a frame's DLC are stored as 0 and count in the statistics.
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define CANCOL_MAGIC        "CANCOL1"   // 8 bytes with the terminating NUL
+#define CANCOL_VERSION      1
+#define CANCOL_EXTENDED     0x01
+
+enum CancolColumn
+{
+    CANCOL_TS = 0,
+    CANCOL_SEQ,     // index of the frame within its row group
+    CANCOL_DLC,
+    CANCOL_B0,  // payload byte 0; bytes 1..7 follow
+    CANCOL_COLUMNS = CANCOL_B0 + 8,
+};
+
+enum CancolEncoding
+{
+    CANCOL_ENC_CONSTANT = 0,
+    CANCOL_ENC_PLAIN_U8 = 1,
+    CANCOL_ENC_DELTA_VARINT = 2,
+};
+
+struct CancolColumnMeta
+{
+    uint64_t offset;
+    uint32_t size;
+    uint8_t encoding;
+    int64_t min;
+    int64_t max;
+};
+
+struct CancolChunkMeta
+{
+    uint32_t id;
+    uint8_t flags;
+    uint64_t count;
+    CancolColumnMeta columns[CANCOL_COLUMNS];
+};
+
+struct CancolRowGroupMeta
+{
+    int64_t t_min_us;
+    int64_t t_max_us;
+    uint64_t frames;
+    std::vector<CancolChunkMeta> chunks;
+};
+
+// Frames of one ID within a row group, before encoding
+struct CancolIdFrames
+{
+    uint32_t id = 0;
+    uint8_t flags = 0;
+    std::vector<int64_t> ts_us;
+    std::vector<int64_t> seq;
+    std::vector<uint8_t> dlc;
+    std::vector<uint64_t> data;
+};
+
+// Encoded column chunk set of one ID, ready to be written
+struct CancolEncodedChunk
+{
+    CancolChunkMeta meta{};
+    std::vector<uint8_t> bytes[CANCOL_COLUMNS];
+};
+
+// Thread safe: encoding does not touch the file
+void cancol_encode(const CancolIdFrames& frames, CancolEncodedChunk* out);
+
+// -----------------------------
+// Writer
+// -----------------------------
+struct CancolWriter
+{
+    FILE* f = nullptr;
+    uint64_t offset = 0;
+    uint32_t window_s = 0;
+    std::vector<CancolRowGroupMeta> row_groups;
+};
+
+bool cancol_writer_open(const char* path, uint32_t window_s, CancolWriter* w);
+// Chunks in ascending ID order
+bool cancol_write_row_group(CancolWriter* w, std::vector<CancolEncodedChunk>& chunks);
+bool cancol_writer_close(CancolWriter* w);
+
+// -----------------------------
+// Reader
+// -----------------------------
+struct CancolFile
+{
+    FILE* f = nullptr;
+    uint32_t window_s = 0;
+    std::vector<CancolRowGroupMeta> row_groups;
+    uint64_t bytes_read = 0;     // column data read so far
+};
+
+bool cancol_open(const char* path, CancolFile* file);
+void cancol_close(CancolFile* file);
+
+// Decode one column of a chunk; values are widened to int64
+bool cancol_read_column(CancolFile* file, const CancolChunkMeta& chunk, int column, std::vector<int64_t>* out);
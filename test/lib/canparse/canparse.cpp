@@ -0,0 +1,440 @@
+#include "canparse.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define CANPARSE_X86 1
+#include <immintrin.h>
+#endif
+
+FrameBatch::FrameBatch(size_t capacity)
+    : ts_us(capacity), id(capacity), dlc(capacity), flags(capacity), data(capacity), line(capacity)
+{
+}
+
+// -----------------------------
+// Scalar parser
+// -----------------------------
+static inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static inline bool is_word(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// "(<sec>[.<frac>]) <iface> <hexid>#<hexdata>"; the payload is decoded as far as it is valid
+static bool parse_payload_scalar(const char* p, const char* line_end, uint8_t* dlc, uint8_t* flags,
+                                 uint64_t* data)
+{
+    uint64_t d = 0;
+    int n = 0;
+    while (p + 1 < line_end && n < 8)
+    {
+        int hi = hex_value(p[0]);
+        int lo = hex_value(p[1]);
+        if (hi < 0 || lo < 0) break;
+        d |= (uint64_t)(hi << 4 | lo) << (8 * n);
+        n++;
+        p += 2;
+    }
+    while (p < line_end && is_blank(*p)) p++;
+    if (p != line_end) *flags |= CANPARSE_BAD_DATA;
+    *dlc = (uint8_t)n;
+    *data = d;
+    return true;
+}
+
+bool canparse_line(const char* p, const char* line_end, int64_t* ts_us, uint32_t* id, uint8_t* dlc,
+                   uint8_t* flags, uint64_t* data)
+{
+    while (p < line_end && is_blank(*p)) p++;
+    if (p >= line_end || *p != '(') return false;
+    p++;
+
+    int64_t sec = 0;
+    int64_t frac = 0;
+    int frac_digits = 0;
+    bool dot = false;
+    bool digits = false;
+    for (; p < line_end && *p != ')'; p++)
+    {
+        if (*p == '.' && !dot)
+        {
+            dot = true;
+        }
+        else if (*p >= '0' && *p <= '9')
+        {
+            digits = true;
+            if (!dot) sec = sec * 10 + (*p - '0');
+            else if (frac_digits < 6)
+            {
+                frac = frac * 10 + (*p - '0');
+                frac_digits++;
+            }
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (p >= line_end || !digits) return false;
+    p++;
+    for (; frac_digits < 6; frac_digits++) frac *= 10;
+
+    const char* q = p;
+    while (p < line_end && is_blank(*p)) p++;
+    if (p == q) return false;
+    q = p;
+    while (p < line_end && is_word(*p)) p++;
+    if (p == q) return false;
+    q = p;
+    while (p < line_end && is_blank(*p)) p++;
+    if (p == q) return false;
+
+    uint32_t v = 0;
+    int n = 0;
+    int h;
+    while (p < line_end && (h = hex_value(*p)) >= 0)
+    {
+        if (++n > 8) return false;
+        v = (v << 4) | (uint32_t)h;
+        p++;
+    }
+    if (n == 0 || p >= line_end || *p != '#') return false;
+
+    *ts_us = sec * 1000000 + frac;
+    *id = v;
+    *flags = n > 3 ? CANPARSE_EXTENDED : 0;
+    return parse_payload_scalar(p + 1, line_end, dlc, flags, data);
+}
+
+static inline bool emit_scalar(const char* p, const char* line_end, FrameBatch* b, uint64_t line)
+{
+    size_t i = b->count;
+    if (!canparse_line(p, line_end, &b->ts_us[i], &b->id[i], &b->dlc[i], &b->flags[i], &b->data[i]))
+    {
+        return false;
+    }
+    b->line[i] = line;
+    b->count++;
+    return true;
+}
+
+// Line ends one byte at a time (memchr is vectorised by libc, but called per line)
+static size_t next_scalar(ParseCursor* c, FrameBatch* b)
+{
+    size_t before = b->count;
+    while (c->pos < c->end && b->count < b->capacity())
+    {
+        const char* nl = (const char*)memchr(c->pos, '\n', c->end - c->pos);
+        const char* le = nl ? nl : c->end;
+        c->line++;
+        if (!emit_scalar(c->pos, le, b, c->line)) c->other_lines++;
+        c->pos = nl ? nl + 1 : c->end;
+    }
+    return b->count - before;
+}
+
+#ifdef CANPARSE_X86
+// -----------------------------
+// SIMD field decoding (SSE4.1)
+// -----------------------------
+
+// 16 ASCII digits -> integer; false if any lane is not a digit
+__attribute__((target("sse4.1"))) static inline bool digits16(__m128i v, uint64_t* out)
+{
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d)) != 0xFFFF) return false;
+    __m128i t1 = _mm_maddubs_epi16(d, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+    __m128i t2 = _mm_madd_epi16(t1, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    __m128i t3 = _mm_packus_epi32(t2, t2);
+    __m128i t4 = _mm_madd_epi16(t3, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    uint64_t hi = (uint32_t)_mm_cvtsi128_si32(t4);
+    uint64_t lo = (uint32_t)_mm_extract_epi32(t4, 1);
+    *out = hi * 100000000ULL + lo;
+    return true;
+}
+
+// Up to 16 hex digits at p (16 readable bytes) -> bytes; returns the number of hex digits
+__attribute__((target("sse4.1"))) static inline int hex16(const char* p, uint64_t* out)
+{
+    __m128i c = _mm_loadu_si128((const __m128i*)p);
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                     _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                     _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha));
+    int n = __builtin_ctz(~mask | 0x10000u);
+
+    __m128i nib = _mm_blendv_epi8(_mm_sub_epi8(lower, _mm_set1_epi8('a' - 10)),
+                                  _mm_sub_epi8(c, _mm_set1_epi8('0')), is_digit);
+    __m128i pairs = _mm_maddubs_epi16(nib, _mm_setr_epi8(16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1, 16, 1));
+    uint64_t bytes = (uint64_t)_mm_cvtsi128_si64(_mm_packus_epi16(pairs, pairs));
+    int nbytes = n / 2;
+    *out = nbytes >= 8 ? bytes : bytes & ((1ULL << (8 * nbytes)) - 1);
+    return n;
+}
+
+// Fast path for the logger's own layout; falls back to the scalar parser for anything else.
+// Needs 64 readable bytes from p.
+__attribute__((target("sse4.1"))) static inline bool emit_sse(const char* p, const char* line_end, FrameBatch* b,
+                                                              uint64_t line)
+{
+    if (line_end - p < 21 || p[0] != '(' || p[11] != '.' || p[18] != ')' || p[19] != ' ')
+    {
+        return emit_scalar(p, line_end, b, line);
+    }
+
+    // "(SSSSSSSSSS.FFFFFF)": 10 + 6 digits; drop the '.' and append the last fraction digit
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + 1));
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 11, 12, 13, 14, 15, -1));
+    v = _mm_insert_epi8(v, p[17], 15);
+    uint64_t ts;
+    if (!digits16(v, &ts)) return emit_scalar(p, line_end, b, line);
+
+    const char* q = p + 20;
+    const char* iface = q;
+    while (q < line_end && is_word(*q)) q++;
+    if (q == iface || q >= line_end || *q != ' ') return emit_scalar(p, line_end, b, line);
+    q++;
+
+    uint32_t id = 0;
+    int n = 0;
+    int h;
+    while (n <= 8 && (h = hex_value(q[n])) >= 0)
+    {
+        id = (id << 4) | (uint32_t)h;
+        n++;
+    }
+    if (n == 0 || n > 8 || q + n >= line_end || q[n] != '#') return emit_scalar(p, line_end, b, line);
+    q += n + 1;
+
+    uint64_t data;
+    int m = hex16(q, &data);
+    if (m == 16 && q + 16 < line_end && hex_value(q[16]) >= 0) m = 17;
+    if ((m & 1) || m > 16 || q + m != line_end) return emit_scalar(p, line_end, b, line);
+
+    size_t i = b->count++;
+    b->ts_us[i] = (int64_t)ts;
+    b->id[i] = id;
+    b->dlc[i] = (uint8_t)(m / 2);
+    b->flags[i] = n > 3 ? CANPARSE_EXTENDED : 0;
+    b->data[i] = data;
+    b->line[i] = line;
+    return true;
+}
+
+// -----------------------------
+// Line scanning: 64-byte blocks turned into a bitmap of '\n' positions
+// -----------------------------
+__attribute__((target("sse4.1"))) static inline uint64_t newlines_sse(const char* p)
+{
+    __m128i nl = _mm_set1_epi8('\n');
+    uint64_t m0 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), nl));
+    uint64_t m1 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 16)), nl));
+    uint64_t m2 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 32)), nl));
+    uint64_t m3 = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 48)), nl));
+    return m0 | m1 << 16 | m2 << 32 | m3 << 48;
+}
+
+__attribute__((target("avx2"))) static inline uint64_t newlines_avx2(const char* p)
+{
+    __m256i nl = _mm256_set1_epi8('\n');
+    uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)p), nl));
+    uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(p + 32)), nl));
+    return lo | hi << 32;
+}
+
+// Walk the buffer in 64-byte blocks while at least 64 + 64 bytes remain, so field decoding of a line
+// ending in the block can read ahead; the tail and the line still open go through the scalar loop.
+#define CANPARSE_NEXT_SIMD(NAME, TARGET, SCAN)                                                           \
+    __attribute__((target(TARGET))) static size_t NAME(ParseCursor* c, FrameBatch* b)                    \
+    {                                                                                                    \
+        size_t before = b->count;                                                                        \
+        const char* line_start = c->pos;                                                                 \
+        const char* block = c->pos;                                                                      \
+        while (c->end - block >= 128 && b->count < b->capacity())                                        \
+        {                                                                                                \
+            uint64_t bits = SCAN(block);                                                                 \
+            while (bits && b->count < b->capacity())                                                     \
+            {                                                                                            \
+                const char* le = block + __builtin_ctzll(bits);                                          \
+                bits &= bits - 1;                                                                        \
+                c->line++;                                                                               \
+                if (!emit_sse(line_start, le, b, c->line)) c->other_lines++;                             \
+                line_start = le + 1;                                                                     \
+            }                                                                                            \
+            if (bits) break; /* batch full inside this block */                                          \
+            block += 64;                                                                                 \
+        }                                                                                                \
+        c->pos = line_start;                                                                             \
+        return b->count - before + next_scalar(c, b);                                                    \
+    }
+
+CANPARSE_NEXT_SIMD(next_sse, "sse4.1", newlines_sse)
+CANPARSE_NEXT_SIMD(next_avx2, "avx2", newlines_avx2)
+#endif
+
+// -----------------------------
+// Dispatch
+// -----------------------------
+typedef size_t (*NextFn)(ParseCursor*, FrameBatch*);
+
+static NextFn g_next = nullptr;
+static const char* g_name = "scalar";
+
+bool canparse_select(CanParseImpl impl)
+{
+#ifdef CANPARSE_X86
+    __builtin_cpu_init();
+    bool sse = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+    if (impl == CANPARSE_AUTO) impl = avx2 ? CANPARSE_AVX2 : sse ? CANPARSE_SSE : CANPARSE_SCALAR;
+    if (impl == CANPARSE_AVX2)
+    {
+        if (!avx2) return false;
+        g_next = next_avx2;
+        g_name = "avx2";
+        return true;
+    }
+    if (impl == CANPARSE_SSE)
+    {
+        if (!sse) return false;
+        g_next = next_sse;
+        g_name = "sse4.1";
+        return true;
+    }
+#else
+    if (impl == CANPARSE_AVX2 || impl == CANPARSE_SSE) return false;
+#endif
+    g_next = next_scalar;
+    g_name = "scalar";
+    return true;
+}
+
+const char* canparse_impl_name()
+{
+    if (!g_next) canparse_select(CANPARSE_AUTO);
+    return g_name;
+}
+
+size_t canparse_next(ParseCursor* cursor, FrameBatch* batch)
+{
+    if (!g_next) canparse_select(CANPARSE_AUTO);
+    return g_next(cursor, batch);
+}
+
+// -----------------------------
+// Memory-mapped files
+// -----------------------------
+bool canlog_open(const char* path, CanLogFile* file)
+{
+    file->fd = open(path, O_RDONLY);
+    if (file->fd < 0) return false;
+    struct stat st{};
+    if (fstat(file->fd, &st) != 0)
+    {
+        canlog_close(file);
+        return false;
+    }
+    file->size = (size_t)st.st_size;
+    file->data = "";
+    if (file->size > 0)
+    {
+        void* m = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+        if (m == MAP_FAILED)
+        {
+            canlog_close(file);
+            return false;
+        }
+        madvise(m, file->size, MADV_SEQUENTIAL);
+        file->data = (const char*)m;
+    }
+    return true;
+}
+
+void canlog_close(CanLogFile* file)
+{
+    if (file->size > 0 && file->data) munmap((void*)file->data, file->size);
+    if (file->fd >= 0) close(file->fd);
+    *file = CanLogFile{};
+}
+
+std::vector<ParseCursor> canlog_split(const CanLogFile& file, size_t n)
+{
+    std::vector<ParseCursor> out;
+    const char* end = file.data + file.size;
+    const char* cut = file.data;
+    n = std::max<size_t>(1, n);
+    for (size_t i = 0; i < n && cut < end; i++)
+    {
+        const char* target = file.data + file.size / n * (i + 1);
+        const char* next = end;
+        if (i + 1 < n && target > cut && target < end)
+        {
+            const char* nl = (const char*)memchr(target, '\n', end - target);
+            if (nl) next = nl + 1;
+        }
+        else if (i + 1 < n)
+        {
+            continue;
+        }
+        out.emplace_back(cut, next);
+        cut = next;
+    }
+    if (out.empty()) out.emplace_back(file.data, end);
+    return out;
+}
+
+void canlog_release(const CanLogFile& file, const char* pos)
+{
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t upto = (size_t)(pos - file.data) / page * page;
+    if (upto > 0) madvise((void*)file.data, upto, MADV_DONTNEED);
+}
+
+bool canlog_reader_open(const char* path, CanLogReader* reader)
+{
+    if (!canlog_open(path, &reader->file)) return false;
+    reader->cursor = ParseCursor(reader->file.data, reader->file.data + reader->file.size);
+    reader->released = reader->file.data;
+    return true;
+}
+
+bool canlog_reader_next(CanLogReader* reader, FrameBatch* batch)
+{
+    batch->clear();
+    while (batch->count == 0 && reader->cursor.pos < reader->cursor.end)
+    {
+        canparse_next(&reader->cursor, batch);
+    }
+    // Release in steps of 16 MB to keep madvise calls rare
+    if (reader->cursor.pos - reader->released >= (16 << 20))
+    {
+        canlog_release(reader->file, reader->cursor.pos);
+        reader->released = reader->cursor.pos;
+    }
+    return batch->count > 0;
+}
+
+void canlog_reader_close(CanLogReader* reader)
+{
+    canlog_close(&reader->file);
+}
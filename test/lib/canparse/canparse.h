@@ -0,0 +1,97 @@
+#pragma once
+
+// Parser for candump-style log lines as written by the logger:
+//
+//     (1755839937.312293) can 7FF#FF070000
+//
+// Lines are decoded into a struct-of-arrays FrameBatch. The hot path finds line ends 32/16 bytes at a
+// time (AVX2/SSE2) and decodes the fixed "(SSSSSSSSSS.FFFFFF)" timestamp and the hex payload with
+// SSE4.1; anything off that layout (other timestamp widths, leading blanks, CRLF...) goes through the
+// scalar parser, which accepts the same lines as the old Python checker. The implementation is picked
+// at run time from the CPU features.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// FrameBatch::flags
+#define CANPARSE_EXTENDED   0x01    // identifier written with more than 3 hex digits (29-bit)
+#define CANPARSE_BAD_DATA   0x02    // payload is not 0..8 complete hex bytes up to the line end
+
+struct FrameBatch
+{
+    size_t count = 0;
+    std::vector<int64_t> ts_us;     // timestamp in microseconds (log time base)
+    std::vector<uint32_t> id;       // identifier as written, error-frame flag bits included
+    std::vector<uint8_t> dlc;
+    std::vector<uint8_t> flags;
+    std::vector<uint64_t> data;     // payload, byte 0 in the lowest byte
+    std::vector<uint64_t> line;     // 1-based line number within the parsed range
+
+    explicit FrameBatch(size_t capacity = 4096);
+    size_t capacity() const { return ts_us.size(); }
+    void clear() { count = 0; }
+};
+
+// Position in a buffer; canparse_next() advances it line by line
+struct ParseCursor
+{
+    const char* pos;
+    const char* end;
+    uint64_t line = 0;          // lines consumed so far (frames and others)
+    uint64_t other_lines = 0;   // lines that are not frames: '*' markers, '#' comments, garbage
+
+    ParseCursor(const char* begin, const char* end_) : pos(begin), end(end_) {}
+};
+
+enum CanParseImpl
+{
+    CANPARSE_AUTO,
+    CANPARSE_SCALAR,
+    CANPARSE_SSE,   // SSE2 line scan + SSE4.1 field decode
+    CANPARSE_AVX2,  // AVX2 line scan + SSE4.1 field decode
+};
+
+// Force an implementation (benchmarks, tests); false if the CPU lacks it
+bool canparse_select(CanParseImpl impl);
+const char* canparse_impl_name();
+
+// Append frames from complete lines at the cursor until the batch is full or the buffer ends.
+// A last line without '\n' is parsed too. Returns the number of frames appended.
+size_t canparse_next(ParseCursor* cursor, FrameBatch* batch);
+
+// Parse a single line [p, line_end) with the scalar parser
+bool canparse_line(const char* p, const char* line_end, int64_t* ts_us, uint32_t* id, uint8_t* dlc,
+                   uint8_t* flags, uint64_t* data);
+
+// -----------------------------
+// Memory-mapped log files
+// -----------------------------
+struct CanLogFile
+{
+    int fd = -1;
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+bool canlog_open(const char* path, CanLogFile* file);
+void canlog_close(CanLogFile* file);
+
+// Split into n ranges cut after a newline, for parallel parsing
+std::vector<ParseCursor> canlog_split(const CanLogFile& file, size_t n);
+
+// Drop the pages before pos from memory; keeps a sequential reader over a huge file at bounded RSS
+void canlog_release(const CanLogFile& file, const char* pos);
+
+// Streaming reader: mapped file, batches in order, pages released behind the cursor
+struct CanLogReader
+{
+    CanLogFile file;
+    ParseCursor cursor{nullptr, nullptr};
+    const char* released = nullptr;
+};
+
+bool canlog_reader_open(const char* path, CanLogReader* reader);
+// Next batch; false at end of file
+bool canlog_reader_next(CanLogReader* reader, FrameBatch* batch);
+void canlog_reader_close(CanLogReader* reader);
@@ -0,0 +1,293 @@
+// canparse benchmark and self-check.
+//
+//   canparse_bench [--lines N] [FILE]   time sscanf vs. scalar / SSE4.1 / AVX2 on FILE or a generated log
+//   canparse_bench --check              compare all implementations on a log full of odd lines
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "canparse.h"
+
+// -----------------------------
+// Test data
+// -----------------------------
+struct Expected
+{
+    uint64_t line;
+    int64_t ts_us;
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t flags;
+    uint64_t data;
+};
+
+static uint32_t rnd()
+{
+    static uint32_t s = 2463534242u;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    return s;
+}
+
+static void append_frame(std::string* out, std::vector<Expected>* exp, uint64_t line, int64_t ts_us, uint32_t id,
+                         bool ext, int dlc, uint64_t data, const char* ts_fmt, bool lower, const char* eol)
+{
+    char buf[128];
+    int n = ts_fmt ? snprintf(buf, sizeof(buf), ts_fmt, (long long)(ts_us / 1000000), (long long)(ts_us % 1000000 / 1000))
+                   : snprintf(buf, sizeof(buf), "(%lld.%06lld)", (long long)(ts_us / 1000000), (long long)(ts_us % 1000000));
+    n += snprintf(buf + n, sizeof(buf) - n, ext ? (lower ? " can0 %08x#" : " can %08X#") : (lower ? " vcan %03x#" : " can %03X#"),
+                  id);
+    for (int i = 0; i < dlc; i++) n += snprintf(buf + n, sizeof(buf) - n, lower ? "%02x" : "%02X", (unsigned)(data >> (8 * i)) & 0xFF);
+    out->append(buf, n);
+    out->append(eol);
+    if (exp)
+    {
+        int64_t ts = ts_fmt ? ts_us / 1000 * 1000 : ts_us;
+        exp->push_back({line, ts, id, (uint8_t)dlc, (uint8_t)(ext ? CANPARSE_EXTENDED : 0),
+                        dlc == 8 ? data : data & ((1ULL << (8 * dlc)) - 1)});
+    }
+}
+
+// The logger's own lines, as in a real recording
+static std::string make_log(size_t lines, std::vector<Expected>* exp)
+{
+    std::string out;
+    out.reserve(lines * 40);
+    out += "* CAN Bus Log Started\n";
+    int64_t ts = 1755839937312293LL;
+    for (size_t i = 0; i < lines; i++)
+    {
+        ts += 400 + rnd() % 200;
+        uint64_t data = (uint64_t)rnd() << 32 | rnd();
+        append_frame(&out, exp, i + 2, ts, (uint32_t)(i & 0x7FF), false, 4, data, nullptr, false, "\n");
+    }
+    return out;
+}
+
+// Everything the parsers have to agree on: off-layout frames and lines that are not frames
+static std::string make_odd_log(size_t lines, std::vector<Expected>* exp)
+{
+    std::string out;
+    int64_t ts = 1755839937000000LL;
+    uint64_t line = 0;
+    for (size_t i = 0; i < lines; i++)
+    {
+        ts += rnd() % 5000;
+        uint64_t data = (uint64_t)rnd() << 32 | rnd();
+        uint32_t r = rnd() % 20;
+        line++;
+        switch (r)
+        {
+        case 0: out += "* marker line\n"; break;
+        case 1: out += "# comment\n"; break;
+        case 2: out += "garbage (123.456) can 123#00\n"; break;
+        case 3: out += "\n"; break;
+        case 4: append_frame(&out, exp, line, ts, rnd() & 0x1FFFFFFF, true, rnd() % 9, data, nullptr, false, "\n"); break;
+        case 5: append_frame(&out, exp, line, ts, rnd() & 0x7FF, false, rnd() % 9, data, nullptr, true, "\n"); break;
+        case 6: append_frame(&out, exp, line, ts, rnd() & 0x7FF, false, 8, data, nullptr, false, "\r\n"); break;
+        case 7: append_frame(&out, exp, line, ts, rnd() & 0x7FF, false, 2, data, "(%lld.%03lld)", false, "\n"); break;
+        case 8:
+            out += "  ";
+            append_frame(&out, exp, line, ts, rnd() & 0x7FF, false, 3, data, nullptr, false, "\n");
+            break;
+        case 9: append_frame(&out, exp, line, ts, rnd() & 0x7FF, false, 0, data, nullptr, false, "\n"); break;
+        case 10:
+        {
+            // odd payload: a frame with the bad-data flag
+            char buf[64];
+            snprintf(buf, sizeof(buf), "(%lld.%06lld) can 1AB#ABC\n", (long long)(ts / 1000000), (long long)(ts % 1000000));
+            out += buf;
+            exp->push_back({line, ts, 0x1AB, 1, CANPARSE_BAD_DATA, 0xAB});
+            break;
+        }
+        case 11: out += "(1755839937.000000) can 123456789#00\n"; break;   // identifier too long
+        case 12: out += "(1755839937.0000x0) can 123#00\n"; break;
+        default: append_frame(&out, exp, line, ts, (uint32_t)(i & 0x7FF), false, 4, data, nullptr, false, "\n"); break;
+        }
+    }
+    // last line without newline
+    line++;
+    append_frame(&out, exp, line, ts + 1, 0x42, false, 1, 0x99, nullptr, false, "");
+    return out;
+}
+
+// -----------------------------
+// Naive reference parser
+// -----------------------------
+static size_t parse_sscanf(const char* data, size_t size, FrameBatch* b)
+{
+    size_t frames = 0;
+    const char* p = data;
+    const char* end = data + size;
+    char line[256];
+    while (p < end)
+    {
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        size_t len = (size_t)((nl ? nl : end) - p);
+        if (len >= sizeof(line)) len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = '\0';
+        p = nl ? nl + 1 : end;
+
+        double ts;
+        char iface[32];
+        unsigned id;
+        char payload[64];
+        payload[0] = '\0';
+        if (sscanf(line, " (%lf) %31s %x#%63s", &ts, iface, &id, payload) < 3) continue;
+        uint64_t d = 0;
+        int dlc = 0;
+        for (; dlc < 8 && payload[2 * dlc] && payload[2 * dlc + 1]; dlc++)
+        {
+            unsigned byte;
+            if (sscanf(payload + 2 * dlc, "%2x", &byte) != 1) break;
+            d |= (uint64_t)byte << (8 * dlc);
+        }
+        size_t i = frames % b->capacity();
+        b->ts_us[i] = (int64_t)(ts * 1e6 + 0.5);
+        b->id[i] = id;
+        b->dlc[i] = (uint8_t)dlc;
+        b->data[i] = d;
+        frames++;
+    }
+    return frames;
+}
+
+static size_t parse_all(const std::string& log, FrameBatch* b, std::vector<Expected>* out, uint64_t* other)
+{
+    ParseCursor c(log.data(), log.data() + log.size());
+    size_t frames = 0;
+    while (c.pos < c.end)
+    {
+        b->clear();
+        canparse_next(&c, b);
+        frames += b->count;
+        if (out)
+        {
+            for (size_t i = 0; i < b->count; i++)
+            {
+                out->push_back({b->line[i], b->ts_us[i], b->id[i], b->dlc[i], b->flags[i], b->data[i]});
+            }
+        }
+    }
+    if (other) *other = c.other_lines;
+    return frames;
+}
+
+// -----------------------------
+// Modes
+// -----------------------------
+static const CanParseImpl IMPLS[] = {CANPARSE_SCALAR, CANPARSE_SSE, CANPARSE_AVX2};
+
+static int check()
+{
+    std::vector<Expected> expected;
+    std::string log = make_odd_log(200000, &expected);
+    int failures = 0;
+    for (CanParseImpl impl : IMPLS)
+    {
+        if (!canparse_select(impl)) continue;
+        for (size_t cap : {(size_t)4096, (size_t)7, (size_t)1})
+        {
+            FrameBatch b(cap);
+            std::vector<Expected> got;
+            uint64_t other = 0;
+            parse_all(log, &b, &got, &other);
+            bool ok = got.size() == expected.size();
+            size_t bad = 0;
+            for (size_t i = 0; ok && i < got.size(); i++)
+            {
+                const Expected& e = expected[i];
+                const Expected& g = got[i];
+                if (e.line != g.line || e.ts_us != g.ts_us || e.id != g.id || e.dlc != g.dlc || e.flags != g.flags ||
+                    e.data != g.data)
+                {
+                    ok = false;
+                    bad = i;
+                }
+            }
+            printf("%-7s batch %4zu: %zu frames, %" PRIu64 " other lines  %s\n", canparse_impl_name(), cap, got.size(),
+                   other, ok ? "ok" : "MISMATCH");
+            if (!ok)
+            {
+                failures++;
+                if (bad < got.size())
+                {
+                    printf("  first mismatch at line %" PRIu64 " (expected line %" PRIu64 ")\n", got[bad].line,
+                           expected[bad].line);
+                }
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+template <typename F> static double best_of(int runs, F fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < runs; r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return best;
+}
+
+static int bench(const std::string& log)
+{
+    FrameBatch b;
+    double mb = log.size() / 1e6;
+    size_t frames = 0;
+    double t_ref = best_of(3, [&] { frames = parse_sscanf(log.data(), log.size(), &b); });
+    printf("%-8s %10s %10s %12s %8s\n", "parser", "MB/s", "Mframes/s", "frames", "speedup");
+    printf("%-8s %10.0f %10.2f %12zu %8.1f\n", "sscanf", mb / t_ref, frames / t_ref / 1e6, frames, 1.0);
+    for (CanParseImpl impl : IMPLS)
+    {
+        if (!canparse_select(impl)) continue;
+        double t = best_of(5, [&] { frames = parse_all(log, &b, nullptr, nullptr); });
+        printf("%-8s %10.0f %10.2f %12zu %8.1f\n", canparse_impl_name(), mb / t, frames / t / 1e6, frames, t_ref / t);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    size_t lines = 2000000;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--check") == 0) return check();
+        if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) lines = strtoull(argv[++i], nullptr, 10);
+        else if (argv[i][0] != '-') path = argv[i];
+        else
+        {
+            fprintf(stderr, "usage: %s [--check] [--lines N] [FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::string log;
+    if (path)
+    {
+        CanLogFile f;
+        if (!canlog_open(path, &f))
+        {
+            perror(path);
+            return 2;
+        }
+        log.assign(f.data, f.size);
+        canlog_close(&f);
+    }
+    else
+    {
+        log = make_log(lines, nullptr);
+    }
+    return bench(log);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// CRC-32 as in zlib, gzip and PNG (reflected polynomial 0xEDB88320, initial value and final XOR
+// 0xFFFFFFFF), eight bytes per step from eight lookup tables (slice-by-8, ~2 GB/s per core).
+// crc32_update(0, ...) starts a checksum; passing the previous result continues it, the convention of
+// zlib's crc32() and of the ESP32 ROM's esp_rom_crc32_le(), so host and logger values compare directly.
+
+#include <cstddef>
+#include <cstdint>
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t len);
@@ -0,0 +1,47 @@
+#!/bin/bash
+
+# Incremental offload from the logger (connect to its SoftAP first): fetches the files of the card that
+# are new or have changed since the last run into DIR. Of a log that has grown, only the part after the
+# last block that still matches the local copy is fetched (block CRCs, see src/logger/block_crc.h).
+# Needs canlog_crc from the host build in PATH, or its path in CANLOG_CRC.
+
+if [ -z "$2" ]; then
+    echo "Usage: $0 <logger_ip> <dir>"
+    exit 1
+fi
+
+HOST="$1"
+DIR="$2"
+CRC_TOOL="${CANLOG_CRC:-canlog_crc}"
+mkdir -p "$DIR" || exit 1
+MANIFEST=$(curl -sf "http://$HOST/api/manifest") || { echo "cannot fetch http://$HOST/api/manifest"; exit 1; }
+
+# One file per line: {"name":"CAN00012.LOG","size":123,...}
+echo "$MANIFEST" | sed -n 's/.*"name":"\([^"]*\)","size":\([0-9]*\).*/\1 \2/p' | while read -r NAME SIZE; do
+    LOCAL="$DIR/$NAME"
+    HAVE=$(stat -c %s "$LOCAL" 2>/dev/null || echo 0)
+    [ -e "$LOCAL" ] && [ "$HAVE" = "$SIZE" ] && continue
+
+    # Keep a log copy up to the first block that is missing or differs, by the current block CRCs
+    OFFSET=0
+    case "$NAME" in
+        *.LOG)
+            BASE="${NAME%.*}"
+            if [ "$HAVE" -gt 0 ] && curl -sf -o "$DIR/$BASE.CRC" "http://$HOST/download?file=$BASE.CRC"; then
+                OFFSET=$("$CRC_TOOL" --resume "$LOCAL" "$DIR/$BASE.CRC") || OFFSET=0
+            fi
+            ;;
+    esac
+
+    if [ "$OFFSET" -gt 0 ]; then
+        truncate -s "$OFFSET" "$LOCAL"
+        # The logger refuses ranges it cannot seek to (past 2 GB) with 416: fetch the file whole then
+        if ! curl -sf -r "$OFFSET-" "http://$HOST/download?file=$NAME" >> "$LOCAL"; then
+            OFFSET=0
+            curl -sf -o "$LOCAL" "http://$HOST/download?file=$NAME" || echo "$NAME: failed"
+        fi
+    else
+        curl -sf -o "$LOCAL" "http://$HOST/download?file=$NAME" || echo "$NAME: failed"
+    fi
+    echo "$NAME: from byte $OFFSET, now $(stat -c %s "$LOCAL" 2>/dev/null || echo 0) bytes"
+done
@@ -0,0 +1,154 @@
+// Reads a downsampled companion file (CANxxxxx.AGG, see src/logger/downsample.h) as CSV, one row per
+// ID and bucket, ready for plotting. --bucket merges the logger's buckets into longer ones, so a
+// six-hour recording can be previewed at e.g. one point per minute.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "downsample.h"
+
+struct Range
+{
+    uint32_t lo, hi;
+};
+
+// "123,200-2FF,18FEF100", hex
+static bool parse_ids(const char* s, std::vector<Range>* out)
+{
+    while (*s)
+    {
+        char* end;
+        uint32_t lo = (uint32_t)strtoul(s, &end, 16);
+        if (end == s) return false;
+        uint32_t hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = (uint32_t)strtoul(s, &end, 16);
+            if (end == s) return false;
+        }
+        out->push_back({lo, hi});
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return true;
+}
+
+static bool id_selected(const std::vector<Range>& ids, uint32_t id)
+{
+    if (ids.empty()) return true;
+    for (const Range& r : ids)
+    {
+        if (id >= r.lo && id <= r.hi) return true;
+    }
+    return false;
+}
+
+struct Agg
+{
+    uint64_t count = 0;
+    double sum = 0;
+    float min = INFINITY;
+    float max = -INFINITY;
+    float last = 0;
+    bool canas = false;
+};
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--ids LIST] [--bucket S] FILE.AGG\n"
+            "  --ids LIST   hex IDs and ranges, e.g. 123,200-2FF,18FEF100\n"
+            "  --bucket S   merge into buckets of S seconds (a multiple of the file's bucket)\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Range> ids;
+    double bucket_s = 0;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ids") == 0 && i + 1 < argc)
+        {
+            if (!parse_ids(argv[++i], &ids))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--bucket") == 0 && i + 1 < argc) bucket_s = atof(argv[++i]);
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return 1;
+    }
+    DownsampleHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, DOWNSAMPLE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != DOWNSAMPLE_VERSION)
+    {
+        fprintf(stderr, "%s: not a downsampled companion file\n", path);
+        return 1;
+    }
+    const int64_t bucket_us = bucket_s > 0 ? (int64_t)(bucket_s * 1e6 + 0.5) : (int64_t)h.bucket_ms * 1000;
+
+    // Output buckets in time order, IDs in order of first appearance within each
+    std::map<int64_t, std::vector<std::pair<uint32_t, Agg>>> out;
+    DownsampleRecord r;
+    size_t records = 0;
+    while (fread(&r, sizeof(r), 1, f) == 1)
+    {
+        records++;
+        const uint32_t id = r.id_flags & ~DOWNSAMPLE_CANAS;
+        if (!id_selected(ids, id) || r.count == 0) continue;
+        auto& row = out[r.start_us / bucket_us * bucket_us];
+        auto it = std::find_if(row.begin(), row.end(), [id](const auto& e) { return e.first == id; });
+        if (it == row.end())
+        {
+            row.emplace_back(id, Agg{});
+            it = row.end() - 1;
+        }
+        Agg& a = it->second;
+        a.count += r.count;
+        a.sum += (double)r.mean * r.count;
+        a.min = std::min(a.min, r.min);
+        a.max = std::max(a.max, r.max);
+        a.last = r.last;
+        a.canas = r.id_flags & DOWNSAMPLE_CANAS;
+    }
+    fclose(f);
+
+    printf("# %zu records, %lu ms buckets in the file\n", records, (unsigned long)h.bucket_ms);
+    printf("time,id,value,count,min,max,mean,last\n");
+    for (const auto& [start, row] : out)
+    {
+        for (const auto& [id, a] : row)
+        {
+            printf("%" PRId64 ".%06" PRId64 ",%03" PRIX32 ",%s,%" PRIu64 ",%.9g,%.9g,%.9g,%.9g\n", start / 1000000,
+                   start % 1000000, id, a.canas ? "canas" : "raw", a.count, a.min, a.max, a.sum / a.count, a.last);
+        }
+    }
+    return 0;
+}
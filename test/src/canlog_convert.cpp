@@ -0,0 +1,298 @@
+// Converts logger output (CANxxxxx.LOG text, or /export?format=bin records) into a CANCOL columnar
+// file (see lib/cancol/cancol.h) with one row group per time window.
+//
+// Inputs are cut into line-aligned chunks that worker threads parse in parallel (lib/canparse); the
+// main thread takes the parsed chunks in order, sorts frames into per-ID columns of the current window
+// and hands each finished row group to the workers for encoding. At most a few chunks and one window
+// are held in memory, independent of the input size.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cancol.h"
+#include "canparse.h"
+
+#define CHUNK_BYTES   (16u << 20)
+#define EXPORT_RECORD 24    // /export?format=bin record, see wifi_web.cpp
+
+struct Task
+{
+    const CanLogFile* file;
+    const char* begin;
+    const char* end;
+    bool binary;
+};
+
+struct Parsed
+{
+    std::vector<FrameBatch> batches;
+    uint64_t other_lines = 0;
+    bool ready = false;
+};
+
+static void parse_task(const Task& t, Parsed* out)
+{
+    if (t.binary)
+    {
+        FrameBatch b;
+        for (const char* p = t.begin; p + EXPORT_RECORD <= t.end; p += EXPORT_RECORD)
+        {
+            if (b.count == b.capacity())
+            {
+                out->batches.push_back(std::move(b));
+                b = FrameBatch();
+            }
+            uint64_t ts;
+            uint32_t id;
+            memcpy(&ts, p, 8);
+            memcpy(&id, p + 8, 4);
+            size_t i = b.count++;
+            b.ts_us[i] = (int64_t)ts;
+            b.id[i] = id;
+            b.dlc[i] = std::min<uint8_t>((uint8_t)p[12], 8);
+            b.flags[i] = id > 0x7FF ? CANPARSE_EXTENDED : 0;
+            b.data[i] = 0;
+            memcpy(&b.data[i], p + 13, b.dlc[i]);
+            b.line[i] = 0;
+        }
+        if (b.count) out->batches.push_back(std::move(b));
+        return;
+    }
+
+    ParseCursor c(t.begin, t.end);
+    while (c.pos < c.end)
+    {
+        FrameBatch b;
+        canparse_next(&c, &b);
+        if (b.count) out->batches.push_back(std::move(b));
+    }
+    out->other_lines = c.other_lines;
+}
+
+// Runs fn(i) for i in [0, n) on up to `threads` threads
+template <typename F> static void parallel_for(size_t n, unsigned threads, F fn)
+{
+    std::atomic_size_t next{0};
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<size_t>(threads, n); t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t i;
+            while ((i = next++) < n) fn(i);
+        });
+    }
+    for (auto& th : pool) th.join();
+}
+
+class RowGroupBuilder
+{
+public:
+    RowGroupBuilder(CancolWriter* w, int64_t window_us, unsigned threads)
+        : w_(w), window_us_(window_us), threads_(threads)
+    {
+    }
+
+    bool add(const FrameBatch& b)
+    {
+        for (size_t i = 0; i < b.count; i++)
+        {
+            // Windows are aligned to the epoch; a frame that steps back stays in the current group
+            int64_t window = b.ts_us[i] / window_us_;
+            if (window > window_ && !ids_.empty())
+            {
+                if (!flush()) return false;
+            }
+            window_ = std::max(window_, window);
+
+            CancolIdFrames& f = ids_[b.id[i]];
+            f.id = b.id[i];
+            f.flags = (b.flags[i] & CANPARSE_EXTENDED) ? CANCOL_EXTENDED : 0;
+            f.ts_us.push_back(b.ts_us[i]);
+            f.seq.push_back(seq_++);
+            f.dlc.push_back(b.dlc[i]);
+            f.data.push_back(b.data[i]);
+            frames_++;
+        }
+        return true;
+    }
+
+    bool flush()
+    {
+        if (ids_.empty()) return true;
+        std::vector<CancolIdFrames*> order;
+        for (auto& [id, f] : ids_) order.push_back(&f);
+        std::sort(order.begin(), order.end(), [](auto* a, auto* b) { return a->id < b->id; });
+
+        std::vector<CancolEncodedChunk> chunks(order.size());
+        parallel_for(order.size(), threads_, [&](size_t i) { cancol_encode(*order[i], &chunks[i]); });
+        ids_.clear();
+        seq_ = 0;
+        row_groups_++;
+        return cancol_write_row_group(w_, chunks);
+    }
+
+    uint64_t frames() const { return frames_; }
+    uint64_t row_groups() const { return row_groups_; }
+
+private:
+    CancolWriter* w_;
+    int64_t window_us_;
+    unsigned threads_;
+    int64_t window_ = INT64_MIN;
+    std::unordered_map<uint32_t, CancolIdFrames> ids_;
+    int64_t seq_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t row_groups_ = 0;
+};
+
+static bool is_binary(const char* path)
+{
+    const char* dot = strrchr(path, '.');
+    return dot && strcasecmp(dot, ".bin") == 0;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-w window_s] [-j threads] -o OUT.col INPUT...\n"
+            "  INPUT      CANxxxxx.LOG text logs or /export?format=bin files (*.bin), in time order\n"
+            "  -w S       row group time window in seconds (default 60)\n"
+            "  -j N       worker threads (default: all cores)\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path = nullptr;
+    uint32_t window_s = 60;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<const char*> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) window_s = (uint32_t)std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = (unsigned)std::max(1, atoi(argv[++i]));
+        else if (argv[i][0] != '-') inputs.push_back(argv[i]);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!out_path || inputs.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<CanLogFile> files(inputs.size());
+    std::vector<Task> tasks;
+    uint64_t in_bytes = 0;
+    for (size_t k = 0; k < inputs.size(); k++)
+    {
+        if (!canlog_open(inputs[k], &files[k]))
+        {
+            perror(inputs[k]);
+            return 1;
+        }
+        const CanLogFile& f = files[k];
+        in_bytes += f.size;
+        bool binary = is_binary(inputs[k]);
+        if (binary)
+        {
+            size_t per_chunk = CHUNK_BYTES / EXPORT_RECORD * EXPORT_RECORD;
+            for (size_t off = 0; off < f.size; off += per_chunk)
+            {
+                tasks.push_back({&f, f.data + off, f.data + std::min(f.size, off + per_chunk), true});
+            }
+        }
+        else
+        {
+            for (const ParseCursor& c : canlog_split(f, f.size / CHUNK_BYTES + 1))
+            {
+                tasks.push_back({&f, c.pos, c.end, false});
+            }
+        }
+    }
+
+    CancolWriter writer;
+    if (!cancol_writer_open(out_path, window_s, &writer))
+    {
+        perror(out_path);
+        return 1;
+    }
+
+    // Parse ahead on worker threads, at most 2 chunks per thread in flight
+    std::vector<Parsed> parsed(tasks.size());
+    std::mutex lock;
+    std::condition_variable cv;
+    size_t consumed = 0;
+    std::atomic_size_t next{0};
+    const size_t max_ahead = 2 * threads;
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<size_t>(threads, tasks.size()); t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t i;
+            while ((i = next++) < tasks.size())
+            {
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    cv.wait(l, [&] { return i < consumed + max_ahead; });
+                }
+                parse_task(tasks[i], &parsed[i]);
+                std::lock_guard<std::mutex> l(lock);
+                parsed[i].ready = true;
+                cv.notify_all();
+            }
+        });
+    }
+
+    RowGroupBuilder builder(&writer, (int64_t)window_s * 1000000, threads);
+    uint64_t other_lines = 0;
+    bool ok = true;
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        {
+            std::unique_lock<std::mutex> l(lock);
+            cv.wait(l, [&] { return parsed[i].ready; });
+        }
+        for (const FrameBatch& b : parsed[i].batches) ok = ok && builder.add(b);
+        other_lines += parsed[i].other_lines;
+        parsed[i] = Parsed();
+        canlog_release(*tasks[i].file, tasks[i].end);
+        std::lock_guard<std::mutex> l(lock);
+        consumed = i + 1;
+        cv.notify_all();
+    }
+    for (auto& th : pool) th.join();
+    ok = ok && builder.flush();
+    ok = cancol_writer_close(&writer) && ok;
+    uint64_t out_bytes = writer.offset;
+    for (CanLogFile& f : files) canlog_close(&f);
+    if (!ok)
+    {
+        fprintf(stderr, "write to %s failed\n", out_path);
+        return 1;
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    printf("%llu frames, %llu other lines, %llu row groups of %u s: %.1f MB -> %.1f MB in %.2f s (%.0f MB/s, %s)\n",
+           (unsigned long long)builder.frames(), (unsigned long long)other_lines,
+           (unsigned long long)builder.row_groups(), window_s, in_bytes / 1e6, out_bytes / 1e6, s,
+           s > 0 ? in_bytes / 1e6 / s : 0.0, canparse_impl_name());
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Checks a log against its block CRC companion file (CANxxxxx.CRC, see src/logger/block_crc.h): which
+// blocks match, which differ and how much of the log is not covered. --resume prints only the offset
+// from which a partial or outdated copy has to be fetched again (test/src/canlog-sync.sh).
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "block_crc.h"
+#include "crc32.h"
+
+#define READ_BYTES  (1 << 20)
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--resume] [-q] FILE.LOG [FILE.CRC]\n"
+            "  --resume   print the offset of the first block the log lacks or that differs\n"
+            "  -q         summary only\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    bool resume = false;
+    bool quiet = false;
+    const char* log_path = nullptr;
+    std::string crc_path;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--resume") == 0) resume = true;
+        else if (strcmp(argv[i], "-q") == 0) quiet = true;
+        else if (argv[i][0] != '-' && !log_path) log_path = argv[i];
+        else if (argv[i][0] != '-' && crc_path.empty()) crc_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!log_path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    if (crc_path.empty())
+    {
+        // CANxxxxx.LOG -> CANxxxxx.CRC
+        crc_path = log_path;
+        size_t dot = crc_path.find_last_of('.');
+        size_t slash = crc_path.find_last_of('/');
+        if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) crc_path.resize(dot);
+        crc_path += ".CRC";
+    }
+
+    FILE* cf = fopen(crc_path.c_str(), "rb");
+    if (!cf)
+    {
+        perror(crc_path.c_str());
+        return 2;
+    }
+    BlockCrcHeader h;
+    if (fread(&h, sizeof(h), 1, cf) != 1 || memcmp(h.magic, BLOCK_CRC_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != BLOCK_CRC_VERSION || h.block_bytes == 0)
+    {
+        fprintf(stderr, "%s: not a block CRC file\n", crc_path.c_str());
+        return 2;
+    }
+    std::vector<BlockCrcRecord> recs;
+    BlockCrcRecord r;
+    while (fread(&r, sizeof(r), 1, cf) == 1) recs.push_back(r);
+    fclose(cf);
+
+    // A missing log is an empty copy: everything is to be fetched
+    FILE* lf = fopen(log_path, "rb");
+    uint64_t log_size = 0;
+    if (lf && fseek(lf, 0, SEEK_END) == 0) log_size = (uint64_t)ftell(lf);
+    if (lf) rewind(lf);
+
+    std::vector<uint8_t> buf(READ_BYTES);
+    uint64_t offset = 0;        // start of the current block
+    uint64_t resume_at = UINT64_MAX;
+    uint32_t file_crc = 0;
+    size_t ok = 0, bad = 0, missing = 0;
+    for (size_t i = 0; i < recs.size(); i++)
+    {
+        const BlockCrcRecord& rec = recs[i];
+        uint32_t crc = 0;
+        uint64_t got = 0;
+        while (lf && got < rec.bytes)
+        {
+            size_t want = (size_t)std::min<uint64_t>(rec.bytes - got, buf.size());
+            size_t n = fread(buf.data(), 1, want, lf);
+            if (n == 0) break;
+            crc = crc32_update(crc, buf.data(), n);
+            file_crc = crc32_update(file_crc, buf.data(), n);
+            got += n;
+        }
+        if (got < rec.bytes)
+        {
+            missing++;
+            if (!quiet && !resume && missing == 1)
+            {
+                printf("block %zu at %" PRIu64 ": log ends after %" PRIu64 " of %" PRIu32 " bytes\n", i, offset, got,
+                       rec.bytes);
+            }
+        }
+        else if (crc != rec.crc || file_crc != rec.file_crc)
+        {
+            bad++;
+            if (!quiet && !resume)
+            {
+                printf("block %zu at %" PRIu64 ": crc %08" PRIx32 ", expected %08" PRIx32 "\n", i, offset, crc,
+                       rec.crc);
+            }
+            // A damaged block also spoils the file CRC of all later ones: continue from the record
+            file_crc = rec.file_crc;
+        }
+        else
+        {
+            ok++;
+        }
+        if (got < rec.bytes || crc != rec.crc)
+        {
+            if (resume_at == UINT64_MAX) resume_at = offset;
+        }
+        offset += rec.bytes;
+    }
+    if (lf) fclose(lf);
+    const uint64_t hashed = offset;
+    if (resume_at == UINT64_MAX) resume_at = hashed;
+
+    if (resume)
+    {
+        printf("%" PRIu64 "\n", resume_at);
+        return 0;
+    }
+    printf("%zu blocks: %zu ok, %zu bad, %zu missing; %" PRIu64 " of %" PRIu64 " log bytes hashed (%s)\n",
+           recs.size(), ok, bad, missing, std::min(hashed, log_size), log_size,
+           log_size > hashed ? "tail not hashed" : "complete");
+    return bad || missing ? 1 : 0;
+}
@@ -0,0 +1,268 @@
+// Merges any number of candump logs (several loggers, several CANxxxxx.LOG sessions) into one
+// time-ordered candump stream.
+//
+// Every input is streamed by a CanLogReader (lib/canparse) one batch at a time; a binary heap keyed by
+// (timestamp, input index) picks the next frame, so memory is k batches however long the logs are and
+// the merge runs at parse/write speed. Each input can carry its own channel tag, written in place of
+// the interface name, and a clock offset added to its timestamps (the logger has no RTC, so every
+// session starts at the same fictional time).
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "canparse.h"
+
+#define OUT_BUFFER  (1u << 20)
+
+struct Input
+{
+    std::string path;
+    std::string tag = "can";
+    int64_t offset_us = 0;
+    CanLogReader reader;
+    FrameBatch batch;
+    size_t pos = 0;
+    int64_t last_ts = INT64_MIN;
+    uint64_t frames = 0;
+    uint64_t steps_back = 0;    // timestamps that go back within this input
+
+    bool refill()
+    {
+        batch.clear();
+        pos = 0;
+        while (canlog_reader_next(&reader, &batch))
+        {
+            if (batch.count) return true;
+        }
+        return false;
+    }
+    int64_t ts() const { return batch.ts_us[pos] + offset_us; }
+};
+
+// "[TAG=]PATH[@OFFSET_S]", offset in seconds with sign, e.g. can1=CAN00003.LOG@+86400.25
+static bool parse_input(const char* arg, Input* in)
+{
+    std::string s = arg;
+    size_t eq = s.find('=');
+    if (eq != std::string::npos)
+    {
+        in->tag = s.substr(0, eq);
+        s = s.substr(eq + 1);
+        if (in->tag.empty() || in->tag.find_first_of(" \t#()") != std::string::npos) return false;
+    }
+    size_t at = s.rfind('@');
+    if (at != std::string::npos)
+    {
+        char* end;
+        double off = strtod(s.c_str() + at + 1, &end);
+        if (*end || end == s.c_str() + at + 1) return false;
+        in->offset_us = (int64_t)(off * 1e6 + (off < 0 ? -0.5 : 0.5));
+        s = s.substr(0, at);
+    }
+    in->path = s;
+    return !s.empty();
+}
+
+// -----------------------------
+// Output
+// -----------------------------
+class Writer
+{
+public:
+    explicit Writer(FILE* f) : f_(f) { buf_.resize(OUT_BUFFER); }
+
+    void frame(int64_t ts, const std::string& tag, uint32_t id, uint8_t flags, uint8_t dlc, uint64_t data)
+    {
+        if (len_ + 64 + tag.size() > buf_.size()) flush();
+        char* p = buf_.data() + len_;
+        char* start = p;
+        int64_t s = ts / 1000000;
+        int64_t us = ts % 1000000;
+        if (us < 0)
+        {
+            s--;
+            us += 1000000;
+        }
+        // Consecutive frames mostly share the second; format it only when it changes
+        if (s != sec_)
+        {
+            sec_ = s;
+            sec_len_ = snprintf(sec_text_, sizeof(sec_text_), "(%" PRId64 ".", s);
+        }
+        memcpy(p, sec_text_, sec_len_);
+        p += sec_len_;
+        for (int d = 5; d >= 0; d--)
+        {
+            p[d] = (char)('0' + us % 10);
+            us /= 10;
+        }
+        p += 6;
+        *p++ = ')';
+        *p++ = ' ';
+        memcpy(p, tag.data(), tag.size());
+        p += tag.size();
+        *p++ = ' ';
+        int digits = (flags & CANPARSE_EXTENDED) ? 8 : 3;
+        for (int d = digits - 1; d >= 0; d--) *p++ = HEX[(id >> (4 * d)) & 0xF];
+        *p++ = '#';
+        for (int b = 0; b < dlc && b < 8; b++)
+        {
+            uint8_t v = (uint8_t)(data >> (8 * b));
+            *p++ = HEX[v >> 4];
+            *p++ = HEX[v & 0xF];
+        }
+        *p++ = '\n';
+        len_ += (size_t)(p - start);
+    }
+
+    bool flush()
+    {
+        if (len_ && fwrite(buf_.data(), 1, len_, f_) != len_) ok_ = false;
+        bytes_ += len_;
+        len_ = 0;
+        return ok_;
+    }
+
+    uint64_t bytes() const { return bytes_ + len_; }
+
+private:
+    static constexpr const char* HEX = "0123456789ABCDEF";
+    FILE* f_;
+    std::vector<char> buf_;
+    size_t len_ = 0;
+    uint64_t bytes_ = 0;
+    bool ok_ = true;
+    int64_t sec_ = INT64_MIN;
+    char sec_text_[32];
+    int sec_len_ = 0;
+};
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-o OUT] [-q] INPUT...\n"
+            "  INPUT   [TAG=]PATH[@OFFSET_S]\n"
+            "          TAG replaces the interface name in the output (default \"can\"),\n"
+            "          OFFSET_S is added to every timestamp of this input (e.g. @+3600, @-0.25)\n"
+            "  -o OUT  write to OUT instead of stdout\n"
+            "  -q      no statistics on stderr\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path = nullptr;
+    bool quiet = false;
+    std::vector<Input> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (strcmp(argv[i], "-q") == 0) quiet = true;
+        else if (argv[i][0] != '-')
+        {
+            inputs.emplace_back();
+            if (!parse_input(argv[i], &inputs.back()))
+            {
+                fprintf(stderr, "bad input '%s'\n", argv[i]);
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (inputs.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    FILE* out = out_path ? fopen(out_path, "wb") : stdout;
+    if (!out)
+    {
+        perror(out_path);
+        return 1;
+    }
+    Writer writer(out);
+
+    // Min-heap of input indices; ties go to the input listed first, so the merge is deterministic
+    auto later = [&inputs](size_t a, size_t b)
+    {
+        int64_t ta = inputs[a].ts();
+        int64_t tb = inputs[b].ts();
+        return ta != tb ? ta > tb : a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+
+    uint64_t in_bytes = 0;
+    for (size_t k = 0; k < inputs.size(); k++)
+    {
+        Input& in = inputs[k];
+        if (!canlog_reader_open(in.path.c_str(), &in.reader))
+        {
+            perror(in.path.c_str());
+            return 1;
+        }
+        in_bytes += in.reader.file.size;
+        if (in.refill()) heap.push(k);
+    }
+
+    uint64_t frames = 0;
+    while (!heap.empty())
+    {
+        size_t k = heap.top();
+        heap.pop();
+        Input& in = inputs[k];
+        const FrameBatch& b = in.batch;
+        // Drain this input while it stays ahead of every other one; saves heap operations on long runs
+        int64_t limit = heap.empty() ? INT64_MAX : inputs[heap.top()].ts();
+        do
+        {
+            int64_t ts = in.ts();
+            if (ts < in.last_ts) in.steps_back++;
+            in.last_ts = ts;
+            writer.frame(ts, in.tag, b.id[in.pos], b.flags[in.pos], b.dlc[in.pos], b.data[in.pos]);
+            in.frames++;
+            frames++;
+            if (++in.pos == b.count && !in.refill())
+            {
+                in.pos = SIZE_MAX;
+                break;
+            }
+        } while (in.ts() < limit || (in.ts() == limit && !heap.empty() && k < heap.top()));
+        if (in.pos != SIZE_MAX) heap.push(k);
+    }
+
+    bool ok = writer.flush();
+    if (out_path) ok = fclose(out) == 0 && ok;
+    else ok = fflush(out) == 0 && ok;
+    for (Input& in : inputs) canlog_reader_close(&in.reader);
+    if (!ok)
+    {
+        fprintf(stderr, "write to %s failed\n", out_path ? out_path : "stdout");
+        return 1;
+    }
+
+    if (!quiet)
+    {
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        for (const Input& in : inputs)
+        {
+            fprintf(stderr, "%-6s %+.6f s  %10" PRIu64 " frames  %6" PRIu64 " steps back  %s\n", in.tag.c_str(),
+                    in.offset_us / 1e6, in.frames, in.steps_back, in.path.c_str());
+        }
+        fprintf(stderr, "%" PRIu64 " frames from %zu inputs: %.1f MB -> %.1f MB in %.2f s (%.0f MB/s)\n", frames,
+                inputs.size(), in_bytes / 1e6, writer.bytes() / 1e6, s, s > 0 ? in_bytes / 1e6 / s : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,194 @@
+// Reads frames back from a CANCOL file (see lib/cancol/cancol.h) as candump lines, in log order.
+// Row groups outside the time range and column chunks of other IDs are skipped using the footer,
+// so only the selected data is read from disk.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cancol.h"
+
+struct Range
+{
+    uint32_t lo, hi;
+};
+
+// "123,200-2FF,18FEF100", hex
+static bool parse_ids(const char* s, std::vector<Range>* out)
+{
+    while (*s)
+    {
+        char* end;
+        uint32_t lo = (uint32_t)strtoul(s, &end, 16);
+        if (end == s) return false;
+        uint32_t hi = lo;
+        if (*end == '-')
+        {
+            s = end + 1;
+            hi = (uint32_t)strtoul(s, &end, 16);
+            if (end == s) return false;
+        }
+        out->push_back({lo, hi});
+        s = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return false;
+    }
+    return true;
+}
+
+static bool id_selected(const std::vector<Range>& ids, uint32_t id)
+{
+    if (ids.empty()) return true;
+    for (const Range& r : ids)
+    {
+        if (id >= r.lo && id <= r.hi) return true;
+    }
+    return false;
+}
+
+struct Row
+{
+    int64_t ts;
+    int64_t seq;
+    uint32_t id;
+    uint8_t flags;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--ids LIST] [--from S] [--to S] [--summary] FILE.col\n"
+            "  --ids LIST   hex IDs and ranges, e.g. 123,200-2FF,18FEF100\n"
+            "  --from/--to  unix seconds (log time base), inclusive\n"
+            "  --summary    print row groups and column statistics instead of frames\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<Range> ids;
+    int64_t from = INT64_MIN;
+    int64_t to = INT64_MAX;
+    bool summary = false;
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ids") == 0 && i + 1 < argc)
+        {
+            if (!parse_ids(argv[++i], &ids))
+            {
+                usage(argv[0]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--from") == 0 && i + 1 < argc) from = (int64_t)(atof(argv[++i]) * 1e6);
+        else if (strcmp(argv[i], "--to") == 0 && i + 1 < argc) to = (int64_t)(atof(argv[++i]) * 1e6);
+        else if (strcmp(argv[i], "--summary") == 0) summary = true;
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    CancolFile file;
+    if (!cancol_open(path, &file))
+    {
+        fprintf(stderr, "%s: not a CANCOL file\n", path);
+        return 1;
+    }
+
+    if (summary)
+    {
+        printf("%zu row groups, window %u s\n", file.row_groups.size(), file.window_s);
+        for (const CancolRowGroupMeta& rg : file.row_groups)
+        {
+            printf("(%.6f .. %.6f) %" PRIu64 " frames, %zu IDs\n", rg.t_min_us / 1e6, rg.t_max_us / 1e6, rg.frames,
+                   rg.chunks.size());
+            for (const CancolChunkMeta& c : rg.chunks)
+            {
+                if (!id_selected(ids, c.id)) continue;
+                printf("  %03X %8" PRIu64 " frames  dlc %" PRId64 "..%" PRId64 "  bytes", c.id, c.count,
+                       c.columns[CANCOL_DLC].min, c.columns[CANCOL_DLC].max);
+                for (int b = 0; b < 8; b++)
+                {
+                    const CancolColumnMeta& col = c.columns[CANCOL_B0 + b];
+                    printf(" %02" PRIX64 "-%02" PRIX64, (uint64_t)col.min, (uint64_t)col.max);
+                }
+                printf("\n");
+            }
+        }
+        cancol_close(&file);
+        return 0;
+    }
+
+    uint64_t frames = 0;
+    uint64_t groups_read = 0;
+    std::vector<int64_t> col;
+    for (const CancolRowGroupMeta& rg : file.row_groups)
+    {
+        if (rg.t_max_us < from || rg.t_min_us > to) continue;
+        groups_read++;
+
+        std::vector<Row> rows;
+        for (const CancolChunkMeta& c : rg.chunks)
+        {
+            if (!id_selected(ids, c.id)) continue;
+            if (c.columns[CANCOL_TS].max < from || c.columns[CANCOL_TS].min > to) continue;
+
+            size_t base = rows.size();
+            rows.resize(base + c.count);
+            if (!cancol_read_column(&file, c, CANCOL_TS, &col)) goto corrupt;
+            for (size_t i = 0; i < c.count; i++)
+            {
+                rows[base + i].ts = col[i];
+                rows[base + i].id = c.id;
+                rows[base + i].flags = c.flags;
+            }
+            if (!cancol_read_column(&file, c, CANCOL_SEQ, &col)) goto corrupt;
+            for (size_t i = 0; i < c.count; i++) rows[base + i].seq = col[i];
+            if (!cancol_read_column(&file, c, CANCOL_DLC, &col)) goto corrupt;
+            for (size_t i = 0; i < c.count; i++) rows[base + i].dlc = (uint8_t)col[i];
+            // Payload columns are read only as far as the longest frame of this ID
+            for (int b = 0; b < std::min<int64_t>(8, c.columns[CANCOL_DLC].max); b++)
+            {
+                if (!cancol_read_column(&file, c, CANCOL_B0 + b, &col)) goto corrupt;
+                for (size_t i = 0; i < c.count; i++) rows[base + i].data[b] = (uint8_t)col[i];
+            }
+        }
+
+        // Back into log order
+        std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.seq < b.seq; });
+        for (const Row& r : rows)
+        {
+            if (r.ts < from || r.ts > to) continue;
+            char line[64];
+            int n = snprintf(line, sizeof(line), "(%" PRId64 ".%06" PRId64 ") can %0*X#", r.ts / 1000000,
+                             r.ts % 1000000, (r.flags & CANCOL_EXTENDED) ? 8 : 3, r.id);
+            for (int b = 0; b < r.dlc && b < 8; b++) n += snprintf(line + n, sizeof(line) - n, "%02X", r.data[b]);
+            line[n++] = '\n';
+            fwrite(line, 1, n, stdout);
+            frames++;
+        }
+    }
+    fprintf(stderr, "%" PRIu64 " frames from %" PRIu64 " of %zu row groups, %.1f kB of column data read\n", frames,
+            groups_read, file.row_groups.size(), file.bytes_read / 1e3);
+    cancol_close(&file);
+    return 0;
+
+corrupt:
+    fprintf(stderr, "%s: corrupt column data\n", path);
+    cancol_close(&file);
+    return 1;
+}
@@ -0,0 +1,261 @@
+// Turns a latency trace (GET /api/trace, or canlogger_host --trace) into a Chrome/Perfetto trace and
+// a per-stage latency summary.
+//
+// Every traced frame becomes an async track with one slice per stage it went through; the SD stages
+// are resolved from sdQueue byte positions (see src/logger/trace.h). The summary gives p50/p99/max per
+// stage and, for the slowest 1 % of frames until written, which stage their time went to.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trace.h"
+
+// Slices of a frame's life, each ending at the stage of the same index + 1
+static const char* SEGMENTS[TRACE_STAGES - 1] = {
+    "rx",           // RX -> CANQ_PUSH
+    "canQueue",     // CANQ_PUSH -> CANQ_POP
+    "format",       // CANQ_POP -> FORMAT
+    "sdQueue push", // FORMAT -> SDQ_PUSH
+    "sdQueue",      // SDQ_PUSH -> SDQ_POP
+    "batch+write",  // SDQ_POP -> WRITE
+    "sync",         // WRITE -> SYNC
+};
+
+struct FrameTrace
+{
+    uint32_t key;
+    int64_t t[TRACE_STAGES];
+    bool has[TRACE_STAGES] = {};
+    int64_t pos = 0;        // end of its line in sdQueue, relative to the first traced line
+};
+
+struct PosEvent
+{
+    int64_t pos;
+    int64_t t;
+};
+
+static int64_t percentile(std::vector<int64_t>& v, double p)
+{
+    if (v.empty()) return 0;
+    size_t k = std::min(v.size() - 1, (size_t)(p * (v.size() - 1) + 0.5));
+    std::nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+// First SD event at or past a line's end: that is when the line got there
+static const PosEvent* reached(const std::vector<PosEvent>& events, int64_t pos)
+{
+    auto it = std::lower_bound(events.begin(), events.end(), pos,
+                               [](const PosEvent& e, int64_t p) { return e.pos < p; });
+    return it == events.end() ? nullptr : &*it;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-o trace.json] TRACE.bin\n"
+            "  TRACE.bin  dump from GET /api/trace or canlogger_host --trace\n"
+            "  -o FILE    write a Chrome/Perfetto trace (open in ui.perfetto.dev or chrome://tracing)\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    const char* out_path = nullptr;
+    const char* in_path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_path = argv[++i];
+        else if (argv[i][0] != '-' && !in_path) in_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!in_path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    FILE* f = fopen(in_path, "rb");
+    if (!f)
+    {
+        perror(in_path);
+        return 1;
+    }
+    TraceDumpHeader h;
+    if (fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, TRACE_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s: not a trace dump\n", in_path);
+        return 1;
+    }
+    std::vector<TraceEvent> events(h.count);
+    if (fread(events.data(), sizeof(TraceEvent), h.count, f) != h.count)
+    {
+        fprintf(stderr, "%s: truncated\n", in_path);
+        return 1;
+    }
+    fclose(f);
+
+    // Times and positions are 32-bit and wrap; events are in claim order, close enough to time order
+    // for the difference to the previous one to unwrap them
+    std::vector<FrameTrace> frames;
+    std::unordered_map<uint32_t, size_t> by_key;
+    std::vector<PosEvent> taken, written, synced;
+    int64_t t = 0;
+    uint32_t t_prev = events.empty() ? 0 : events[0].t_us;
+    bool have_pos = false;
+    uint32_t pos_ref = 0;
+    for (const TraceEvent& e : events)
+    {
+        t += (int32_t)(e.t_us - t_prev);
+        t_prev = e.t_us;
+        if (e.stage >= TRACE_STAGES) continue;
+        if (e.stage >= TRACE_SDQ_PUSH && !have_pos)
+        {
+            have_pos = true;
+            pos_ref = e.pos;
+        }
+        int64_t pos = (int32_t)(e.pos - pos_ref);
+        switch (e.stage)
+        {
+        case TRACE_SDQ_POP: taken.push_back({pos, t}); continue;
+        case TRACE_WRITE: written.push_back({pos, t}); continue;
+        case TRACE_SYNC: synced.push_back({pos, t}); continue;
+        default: break;
+        }
+        auto [it, added] = by_key.try_emplace(e.frame, frames.size());
+        if (added)
+        {
+            frames.emplace_back();
+            frames.back().key = e.frame;
+        }
+        FrameTrace& fr = frames[it->second];
+        fr.t[e.stage] = t;
+        fr.has[e.stage] = true;
+        if (e.stage == TRACE_SDQ_PUSH) fr.pos = pos;
+    }
+
+    const std::vector<PosEvent>* sd_events[3] = {&taken, &written, &synced};
+    for (FrameTrace& fr : frames)
+    {
+        if (!fr.has[TRACE_SDQ_PUSH]) continue;
+        for (int s = 0; s < 3; s++)
+        {
+            const PosEvent* e = reached(*sd_events[s], fr.pos);
+            if (!e) break;
+            fr.t[TRACE_SDQ_POP + s] = e->t;
+            fr.has[TRACE_SDQ_POP + s] = true;
+        }
+    }
+
+    // Summary
+    std::vector<int64_t> seg[TRACE_STAGES - 1];
+    std::vector<std::pair<int64_t, const FrameTrace*>> to_write;
+    size_t complete = 0;
+    for (const FrameTrace& fr : frames)
+    {
+        for (int s = 0; s + 1 < TRACE_STAGES; s++)
+        {
+            if (fr.has[s] && fr.has[s + 1]) seg[s].push_back(fr.t[s + 1] - fr.t[s]);
+        }
+        bool all = true;
+        for (int s = 0; s <= TRACE_WRITE; s++) all = all && fr.has[s];
+        if (all) to_write.push_back({fr.t[TRACE_WRITE] - fr.t[TRACE_RX], &fr});
+        complete += all && fr.has[TRACE_SYNC];
+    }
+    printf("%zu events, %zu frames traced, %zu written, %zu through sync\n", events.size(), frames.size(),
+           to_write.size(), complete);
+    printf("%-14s %8s %10s %10s %10s\n", "stage", "frames", "p50 us", "p99 us", "max us");
+    for (int s = 0; s + 1 < TRACE_STAGES; s++)
+    {
+        size_t n = seg[s].size();
+        int64_t p50 = percentile(seg[s], 0.5), p99 = percentile(seg[s], 0.99);
+        int64_t max = n ? *std::max_element(seg[s].begin(), seg[s].end()) : 0;
+        printf("%-14s %8zu %10" PRId64 " %10" PRId64 " %10" PRId64 "\n", SEGMENTS[s], n, p50, p99, max);
+    }
+    if (!to_write.empty())
+    {
+        std::vector<int64_t> e2e;
+        for (auto& [us, fr] : to_write) e2e.push_back(us);
+        printf("%-14s %8zu %10" PRId64 " %10" PRId64 " %10" PRId64 "\n", "rx -> written", e2e.size(),
+               percentile(e2e, 0.5), percentile(e2e, 0.99), *std::max_element(e2e.begin(), e2e.end()));
+
+        // Where the slowest 1 % spent their time
+        std::sort(to_write.begin(), to_write.end(), [](auto& a, auto& b) { return a.first > b.first; });
+        size_t tail = std::max<size_t>(1, to_write.size() / 100);
+        double share[TRACE_WRITE] = {};
+        double total = 0;
+        for (size_t i = 0; i < tail; i++)
+        {
+            const FrameTrace& fr = *to_write[i].second;
+            for (int s = 0; s < TRACE_WRITE; s++) share[s] += fr.t[s + 1] - fr.t[s];
+            total += to_write[i].first;
+        }
+        printf("slowest %zu frames until written (from %.1f ms):", tail, to_write[tail - 1].first / 1000.0);
+        for (int s = 0; s < TRACE_WRITE; s++)
+        {
+            if (total > 0) printf(" %s %.0f%%", SEGMENTS[s], 100.0 * share[s] / total);
+        }
+        printf("\n");
+    }
+
+    if (!out_path) return 0;
+    FILE* out = fopen(out_path, "w");
+    if (!out)
+    {
+        perror(out_path);
+        return 1;
+    }
+    // One async track per frame, stages as nested slices; SD_Writer writes and syncs as instants
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"canlogger\"}},\n");
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"SD_Writer\"}}");
+    for (const FrameTrace& fr : frames)
+    {
+        int first = 0, last = TRACE_STAGES - 1;
+        while (first < TRACE_STAGES && !fr.has[first]) first++;
+        while (last > first && !fr.has[last]) last--;
+        if (first >= last) continue;
+        fprintf(out, ",\n{\"ph\":\"b\",\"cat\":\"frame\",\"name\":\"frame %08" PRIx32 "\",\"id\":\"%08" PRIx32
+                     "\",\"pid\":1,\"tid\":0,\"ts\":%" PRId64 "}",
+                fr.key, fr.key, fr.t[first]);
+        for (int s = first; s < last; s++)
+        {
+            if (!fr.has[s] || !fr.has[s + 1]) continue;
+            fprintf(out,
+                    ",\n{\"ph\":\"b\",\"cat\":\"frame\",\"name\":\"%s\",\"id\":\"%08" PRIx32 "\",\"pid\":1,\"tid\":0,"
+                    "\"ts\":%" PRId64 "},\n{\"ph\":\"e\",\"cat\":\"frame\",\"name\":\"%s\",\"id\":\"%08" PRIx32
+                    "\",\"pid\":1,\"tid\":0,\"ts\":%" PRId64 "}",
+                    SEGMENTS[s], fr.key, fr.t[s], SEGMENTS[s], fr.key, fr.t[s + 1]);
+        }
+        fprintf(out, ",\n{\"ph\":\"e\",\"cat\":\"frame\",\"name\":\"frame %08" PRIx32 "\",\"id\":\"%08" PRIx32
+                     "\",\"pid\":1,\"tid\":0,\"ts\":%" PRId64 "}",
+                fr.key, fr.key, fr.t[last]);
+    }
+    for (const PosEvent& e : written)
+    {
+        fprintf(out, ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"write\",\"pid\":1,\"tid\":1,\"ts\":%" PRId64 "}", e.t);
+    }
+    for (const PosEvent& e : synced)
+    {
+        fprintf(out, ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"sync\",\"pid\":1,\"tid\":1,\"ts\":%" PRId64 "}", e.t);
+    }
+    fprintf(out, "\n]}\n");
+    if (fclose(out) != 0)
+    {
+        perror(out_path);
+        return 1;
+    }
+    return 0;
+}
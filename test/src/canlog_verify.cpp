@@ -0,0 +1,209 @@
+// Checks the integrity records the logger writes into its logs: after each block of whole lines (up to
+// LOG_BLOCK_BYTES, 16 KB, see src/logger/logging.cpp) a comment line
+//
+//     * BLOCK <seq> <bytes> <crc32>
+//
+// with the block's length and CRC32. Any log can be checked this way, without the cangen pattern that
+// check_canlog needs, and a damaged block is reported with its byte and line range so the rest of the
+// log can still be used. The file is mapped, the records are found in one pass and the blocks are
+// hashed in parallel (lib/crc32), which keeps up with the disk.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "canparse.h"
+#include "crc32.h"
+
+#define RECORD_PREFIX   "* BLOCK "
+
+struct Block
+{
+    uint64_t start;         // first data byte
+    uint64_t end;           // start of the record line
+    uint64_t rec_end;       // past the record line
+    uint32_t seq = 0;
+    uint32_t bytes = 0;
+    uint32_t crc = 0;
+    bool parsed = false;    // record line readable
+    uint32_t actual_crc = 0;
+    uint64_t lines = 0;     // data lines plus the record line
+};
+
+static bool parse_record(const char* p, const char* end, Block* b)
+{
+    char text[64];
+    size_t n = std::min<size_t>(end - p, sizeof(text) - 1);
+    memcpy(text, p, n);
+    text[n] = '\0';
+    unsigned long seq, bytes, crc;
+    int used = 0;
+    if (sscanf(text, RECORD_PREFIX "%lu %lu %8lx%n", &seq, &bytes, &crc, &used) != 3 || text[used] != '\n')
+    {
+        return false;
+    }
+    b->seq = (uint32_t)seq;
+    b->bytes = (uint32_t)bytes;
+    b->crc = (uint32_t)crc;
+    return true;
+}
+
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [-q] [-j threads] <logfile>\n"
+            "  -q          summary only\n"
+            "  -j N        worker threads (default: all cores)\n",
+            argv0);
+}
+
+int main(int argc, char** argv)
+{
+    bool quiet = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0) quiet = true;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    CanLogFile file;
+    if (!canlog_open(path, &file))
+    {
+        perror(path);
+        return 2;
+    }
+    const auto t0 = std::chrono::steady_clock::now();
+
+    // Record lines: "* BLOCK " at the start of a line, complete with its newline
+    const char* data = file.data;
+    const char* end = file.data + file.size;
+    const size_t prefix_len = strlen(RECORD_PREFIX);
+    std::vector<Block> blocks;
+    uint64_t start = 0;
+    const char* p = data;
+    while (p < end)
+    {
+        const char* rec = (p == data && file.size >= prefix_len && memcmp(p, RECORD_PREFIX, prefix_len) == 0)
+                              ? p
+                              : (const char*)memmem(p, end - p, "\n" RECORD_PREFIX, prefix_len + 1);
+        if (!rec) break;
+        if (rec != p || *rec == '\n') rec++;
+        const char* nl = (const char*)memchr(rec, '\n', end - rec);
+        if (!nl) break;     // torn last line: part of the tail
+        Block b;
+        b.start = start;
+        b.end = rec - data;
+        b.rec_end = nl + 1 - data;
+        b.parsed = parse_record(rec, nl + 1, &b);
+        blocks.push_back(b);
+        start = b.rec_end;
+        p = nl;             // the newline may start the next record
+    }
+    const uint64_t tail = file.size - start;
+
+    // Hash and count lines in parallel
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < std::min<size_t>(threads, std::max<size_t>(1, blocks.size())); t++)
+    {
+        pool.emplace_back([&]() {
+            size_t i;
+            while ((i = next.fetch_add(1)) < blocks.size())
+            {
+                Block& b = blocks[i];
+                b.actual_crc = crc32_update(0, data + b.start, b.end - b.start);
+                b.lines = std::count(data + b.start, data + b.rec_end, '\n');
+            }
+        });
+    }
+    for (auto& th : pool) th.join();
+
+    size_t ok = 0, damaged = 0;
+    uint64_t missing = 0;
+    uint64_t line = 1;          // first line of the current block
+    uint32_t expected = 0;
+    for (const Block& b : blocks)
+    {
+        const char* why = nullptr;
+        char buf[96];
+        if (!b.parsed)
+        {
+            why = "unreadable block record";
+        }
+        else
+        {
+            if (b.seq != expected)
+            {
+                if (b.seq > expected)
+                {
+                    missing += b.seq - expected;
+                    if (!quiet)
+                    {
+                        printf("before byte %" PRIu64 " (line %" PRIu64 "): blocks %" PRIu32 "..%" PRIu32 " missing\n",
+                               b.start, line, expected, b.seq - 1);
+                    }
+                }
+                else if (!quiet)
+                {
+                    printf("byte %" PRIu64 " (line %" PRIu64 "): block %" PRIu32 " out of sequence, expected %" PRIu32
+                           "\n", b.start, line, b.seq, expected);
+                }
+            }
+            expected = b.seq + 1;
+            if (b.end - b.start != b.bytes)
+            {
+                snprintf(buf, sizeof(buf), "%" PRIu64 " bytes, record says %" PRIu32, b.end - b.start, b.bytes);
+                why = buf;
+            }
+            else if (b.actual_crc != b.crc)
+            {
+                snprintf(buf, sizeof(buf), "crc %08" PRIX32 ", record says %08" PRIX32, b.actual_crc, b.crc);
+                why = buf;
+            }
+        }
+        if (why)
+        {
+            damaged++;
+            if (!quiet)
+            {
+                printf("block %" PRIu32 ": bytes %" PRIu64 "-%" PRIu64 ", lines %" PRIu64 "-%" PRIu64 ": %s\n", b.seq,
+                       b.start, b.end, line, line + b.lines - 1, why);
+            }
+        }
+        else
+        {
+            ok++;
+        }
+        line += b.lines;
+    }
+
+    const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (blocks.empty()) printf("%s: no block records (written before integrity records?)\n", path);
+    printf("%zu blocks: %zu ok, %zu damaged, %" PRIu64 " missing; %" PRIu64 " bytes after the last record\n",
+           blocks.size(), ok, damaged, missing, tail);
+    if (!quiet)
+    {
+        printf("%.1f MB in %.3f s (%.0f MB/s)\n", file.size / 1e6, secs, file.size / 1e6 / std::max(secs, 1e-9));
+    }
+    canlog_close(&file);
+    return damaged || missing ? 1 : 0;
+}
@@ -0,0 +1,335 @@
+// Validates candump-style logs recorded from 'cangen can0 -D i -I i -L 4 -g 10'.
+//
+// Same checks as the former check_canlog.py (sequential IDs with wrap at 0x7FF, missing and corrupted
+// frames, average rate) plus timestamp monotonicity and an inter-arrival histogram. The file is mapped
+// and split into chunks at line boundaries that are parsed (lib/canparse) and checked in parallel; each
+// chunk starts from its own first frame and the chunks are stitched together afterwards, so the result
+// is identical to a single sequential pass. Error frames written by the logger (CAN_ERR_FLAG, see
+// src/logger/bus_health.h) are counted separately and do not take part in the sequence check.
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "canparse.h"
+
+#define ID_MASK      0x7FF
+#define CAN_ERR_FLAG 0x20000000u
+#define HIST_BUCKETS 24     // inter-arrival histogram: [0], [1], [2,4), ... [2^22,2^23) us, larger
+
+struct Frame
+{
+    int64_t ts_us;
+    uint32_t id;
+};
+
+struct Issue
+{
+    uint64_t line;          // chunk-local until stitched
+    enum Kind { SKIPPED, CORRUPTED, BACKWARDS } kind;
+    uint32_t value;         // skipped frames, or the bad ID
+    uint32_t expected;      // expected ID for CORRUPTED
+    int64_t back_us;        // step back for BACKWARDS
+};
+
+struct ChunkResult
+{
+    ParseCursor cursor{nullptr, nullptr};
+    uint64_t lines = 0;
+    uint64_t logged = 0;
+    uint64_t error_frames = 0;
+    uint64_t expected = 0;
+    uint64_t missing = 0;
+    uint64_t corrupted = 0;
+    uint64_t backwards = 0;
+    int64_t max_back_us = 0;
+    bool have_frame = false;
+    uint64_t first_line = 0;
+    Frame first{};
+    Frame last{};
+    uint64_t hist[HIST_BUCKETS] = {};
+    int64_t min_dt_us = INT64_MAX;
+    int64_t max_dt_us = 0;
+    std::vector<Issue> issues;
+};
+
+// -----------------------------
+// Checks
+// -----------------------------
+static inline int hist_bucket(int64_t dt_us)
+{
+    if (dt_us <= 0) return 0;
+    int b = 64 - __builtin_clzll((uint64_t)dt_us);  // 1 -> 1, 2..3 -> 2, ...
+    return std::min(b, HIST_BUCKETS - 1);
+}
+
+// One step of the sequence check from prev to cur. Returns the number of frames cur accounts for in
+// "expected" (1, or the gap + 1 when frames were skipped).
+static uint64_t check_step(const Frame& prev, const Frame& cur, uint64_t line, ChunkResult* r)
+{
+    uint64_t expected = 1;
+    uint32_t expected_id = (prev.id + 1) & ID_MASK;
+    if (cur.id != expected_id)
+    {
+        uint32_t diff = (cur.id - prev.id) & ID_MASK;
+        if (diff > 1)
+        {
+            r->missing += diff - 1;
+            expected = diff;
+            r->issues.push_back({line, Issue::SKIPPED, diff - 1, 0, 0});
+        }
+        else
+        {
+            r->corrupted++;
+            r->issues.push_back({line, Issue::CORRUPTED, cur.id, expected_id, 0});
+        }
+    }
+
+    int64_t dt = cur.ts_us - prev.ts_us;
+    if (dt < 0)
+    {
+        r->backwards++;
+        r->max_back_us = std::max(r->max_back_us, -dt);
+        r->issues.push_back({line, Issue::BACKWARDS, 0, 0, -dt});
+    }
+    else
+    {
+        r->hist[hist_bucket(dt)]++;
+        r->min_dt_us = std::min(r->min_dt_us, dt);
+        r->max_dt_us = std::max(r->max_dt_us, dt);
+    }
+    return expected;
+}
+
+static void check_chunk(ChunkResult* r)
+{
+    FrameBatch batch;
+    Frame prev{};
+    while (canparse_next(&r->cursor, &batch) > 0 || r->cursor.pos < r->cursor.end)
+    {
+        for (size_t i = 0; i < batch.count; i++)
+        {
+            if (batch.id[i] & CAN_ERR_FLAG)
+            {
+                r->error_frames++;
+                continue;
+            }
+            Frame cur{batch.ts_us[i], batch.id[i]};
+            r->logged++;
+            if (!r->have_frame)
+            {
+                r->have_frame = true;
+                r->first_line = batch.line[i];
+                r->first = cur;
+                r->expected = 1;
+            }
+            else
+            {
+                r->expected += check_step(prev, cur, batch.line[i], r);
+            }
+            prev = cur;
+        }
+        batch.clear();
+    }
+    r->last = prev;
+    r->lines = r->cursor.line;
+}
+
+// -----------------------------
+// Main
+// -----------------------------
+static void usage(const char* argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [-q] [-j threads] <logfile>\n"
+            "  -q          summary only, no per-line issues\n"
+            "  -j N        worker threads (default: all cores)\n",
+            argv0);
+}
+
+static void format_us(int64_t us, char* out, size_t size)
+{
+    if (us < 1000) snprintf(out, size, "%" PRId64 " us", us);
+    else if (us < 1000000) snprintf(out, size, "%.1f ms", us / 1000.0);
+    else snprintf(out, size, "%.1f s", us / 1000000.0);
+}
+
+int main(int argc, char** argv)
+{
+    bool quiet = false;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    const char* path = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0) quiet = true;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) threads = std::max(1, atoi(argv[++i]));
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    CanLogFile file;
+    if (!canlog_open(path, &file))
+    {
+        perror(path);
+        return 2;
+    }
+
+    // Chunks of at least 1 MB
+    size_t nchunks = std::max<size_t>(1, std::min<size_t>(threads * 4, file.size / (1 << 20)));
+    std::vector<ParseCursor> ranges = canlog_split(file, nchunks);
+    std::vector<ChunkResult> chunks(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) chunks[i].cursor = ranges[i];
+
+    std::vector<std::thread> pool;
+    std::atomic_size_t next{0};
+    for (unsigned t = 0; t < std::min<size_t>(threads, chunks.size()); t++)
+    {
+        pool.emplace_back([&]()
+        {
+            size_t i;
+            while ((i = next++) < chunks.size()) check_chunk(&chunks[i]);
+        });
+    }
+    for (auto& t : pool) t.join();
+
+    // Stitch: re-evaluate the first frame of each chunk against the last frame before it
+    ChunkResult total;
+    ChunkResult seam;
+    bool have_prev = false;
+    Frame prev{};
+    Frame first{};
+    uint64_t line_base = 0;
+    std::vector<Issue> issues;
+    for (ChunkResult& c : chunks)
+    {
+        total.logged += c.logged;
+        total.error_frames += c.error_frames;
+        total.missing += c.missing;
+        total.corrupted += c.corrupted;
+        total.backwards += c.backwards;
+        total.max_back_us = std::max(total.max_back_us, c.max_back_us);
+        total.min_dt_us = std::min(total.min_dt_us, c.min_dt_us);
+        total.max_dt_us = std::max(total.max_dt_us, c.max_dt_us);
+        for (int b = 0; b < HIST_BUCKETS; b++) total.hist[b] += c.hist[b];
+
+        if (c.have_frame)
+        {
+            if (!have_prev)
+            {
+                first = c.first;
+                total.expected += c.expected;
+            }
+            else
+            {
+                // The chunk counted its first frame as a fresh start; replace that with the real step
+                total.expected += c.expected - 1 + check_step(prev, c.first, line_base + c.first_line, &seam);
+                issues.insert(issues.end(), seam.issues.begin(), seam.issues.end());
+                seam.issues.clear();
+            }
+            prev = c.last;
+            have_prev = true;
+        }
+        for (Issue is : c.issues)
+        {
+            is.line += line_base;
+            issues.push_back(is);
+        }
+        line_base += c.lines;
+    }
+    Frame last = prev;
+    total.missing += seam.missing;
+    total.corrupted += seam.corrupted;
+    total.backwards += seam.backwards;
+    total.max_back_us = std::max(total.max_back_us, seam.max_back_us);
+    total.min_dt_us = std::min(total.min_dt_us, seam.min_dt_us);
+    total.max_dt_us = std::max(total.max_dt_us, seam.max_dt_us);
+    for (int b = 0; b < HIST_BUCKETS; b++) total.hist[b] += seam.hist[b];
+
+    if (!quiet)
+    {
+        for (const Issue& is : issues)
+        {
+            switch (is.kind)
+            {
+            case Issue::SKIPPED:
+                printf("Line %" PRIu64 ": Skipped %u frame(s) before this line\n", is.line, is.value);
+                break;
+            case Issue::CORRUPTED:
+                printf("Line %" PRIu64 ": Corrupted ID %03X, expected %03X\n", is.line, is.value, is.expected);
+                break;
+            case Issue::BACKWARDS:
+                printf("Line %" PRIu64 ": Timestamp goes back by %.6f s\n", is.line, is.back_us / 1e6);
+                break;
+            }
+        }
+    }
+
+    printf("\n===== SUMMARY =====\n");
+    printf("Total frames logged   : %" PRIu64 "\n", total.logged);
+    printf("Total frames expected : %" PRIu64 "\n", total.expected);
+    printf("Missing frames        : %" PRIu64 "\n", total.missing);
+    printf("Corrupted frames      : %" PRIu64 "\n", total.corrupted);
+    if (total.error_frames) printf("Error frames          : %" PRIu64 "\n", total.error_frames);
+    if (total.logged > 1 && have_prev)
+    {
+        double duration = (last.ts_us - first.ts_us) / 1e6;
+        if (duration > 0) printf("Average rate          : %.2f messages/sec\n", total.logged / duration);
+        else printf("Average rate          : n/a (duration too short)\n");
+    }
+    printf("Timestamps backwards  : %" PRIu64, total.backwards);
+    if (total.backwards) printf(" (largest step back %.6f s)", total.max_back_us / 1e6);
+    printf("\n");
+
+    if (total.logged > 1 && total.min_dt_us != INT64_MAX)
+    {
+        char lo[32], hi[32];
+        format_us(total.min_dt_us, lo, sizeof(lo));
+        format_us(total.max_dt_us, hi, sizeof(hi));
+        printf("\n===== INTER-ARRIVAL (min %s, max %s) =====\n", lo, hi);
+        uint64_t peak = *std::max_element(total.hist, total.hist + HIST_BUCKETS);
+        for (int b = 0; b < HIST_BUCKETS; b++)
+        {
+            if (!total.hist[b]) continue;
+            char from[32], to[32];
+            int64_t low = b == 0 ? 0 : (int64_t)1 << (b - 1);
+            format_us(low, from, sizeof(from));
+            if (b == 0) to[0] = '\0';
+            else if (b == HIST_BUCKETS - 1) snprintf(to, sizeof(to), "and more");
+            else format_us(((int64_t)1 << b) - 1, to, sizeof(to));
+            int bar = (int)(40 * total.hist[b] / peak);
+            printf("%10s %-10s %12" PRIu64 " %s\n", from, to, total.hist[b], std::string(std::max(bar, 1), '#').c_str());
+        }
+    }
+
+    bool ok = total.corrupted == 0 && total.missing == 0;
+    if (ok)
+    {
+        printf("✅ CAN ID sequence is correct, no frames missing\n");
+    }
+    else
+    {
+        double loss_pct = total.expected ? 100.0 * total.missing / total.expected : 0;
+        printf("❌ Issues detected — %" PRIu64 " missing, %" PRIu64 " corrupted (%.2f%% data loss)\n", total.missing,
+               total.corrupted, loss_pct);
+    }
+    if (total.backwards) printf("❌ Timestamps not monotonic — %" PRIu64 " step(s) back\n", total.backwards);
+
+    canlog_close(&file);
+    return ok && total.backwards == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# Aggregate download throughput and file listing latency of the logger's web server with 1..N
+# parallel downloads (connect to the logger's SoftAP first).
+
+if [ -z "$2" ]; then
+    echo "Usage: $0 <logger_ip> <file on the card> [max parallel downloads, default 4]"
+    exit 1
+fi
+
+HOST="$1"
+FILE="$2"
+MAX="${3:-4}"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+echo "downloads  aggregate MB/s  listing p50 ms  listing max ms  listing errors"
+for N in $(seq 1 "$MAX"); do
+    rm -f "$TMP"/*
+    START=$(date +%s.%N)
+    PIDS=""
+    for i in $(seq 1 "$N"); do
+        curl -s -o /dev/null -w "%{http_code} %{size_download}\n" \
+            "http://$HOST/download?file=$FILE" > "$TMP/dl$i" &
+        PIDS="$PIDS $!"
+    done
+
+    # Poll the listing while the downloads run
+    while kill -0 $PIDS 2>/dev/null; do
+        curl -s -o /dev/null -m 10 -w "%{http_code} %{time_total}\n" "http://$HOST/" >> "$TMP/list"
+        sleep 0.5
+    done
+    wait
+    END=$(date +%s.%N)
+
+    BYTES=$(cat "$TMP"/dl* | awk '$1 == 200 { sum += $2 } END { print sum + 0 }')
+    MBPS=$(echo "$BYTES $START $END" | awk '{ printf "%.2f", $1 / ($3 - $2) / 1e6 }')
+    LIST=$(awk '$1 == 200 { print $2 * 1000 }' "$TMP/list" | sort -n)
+    COUNT=$(echo "$LIST" | grep -c .)
+    P50=$(echo "$LIST" | awk -v n="$COUNT" 'NR == int((n + 1) / 2) { printf "%.0f", $1 }')
+    PMAX=$(echo "$LIST" | tail -1 | awk '{ printf "%.0f", $1 }')
+    ERRORS=$(awk '$1 != 200' "$TMP/list" | wc -l)
+    printf "%9d  %14s  %14s  %14s  %14d\n" "$N" "$MBPS" "${P50:--}" "${PMAX:--}" "$ERRORS"
+done